@@ -0,0 +1,77 @@
+// Benchmark of the hot-path API with the N-API addon against the koffi binding
+//
+// Usage: node benchmarks/binding.js [calls]
+//
+// Each binding runs in its own process since only one server can be created per process, and PCAS_BINDING=koffi
+// forces the koffi binding. The addon must be built from wrapper/binding.gyp, otherwise both runs use koffi.
+
+const { fork } = require('child_process');
+
+
+const DEFAULT_CALLS = 100000;
+const WAVEFORM_COUNT = 1000;
+
+
+// Average time in nanoseconds of one call of func
+function measure(calls, func) {
+    let start = process.hrtime.bigint();
+    for(let i = 0; i < calls; i++) {
+        func(i);
+    }
+    return Number(process.hrtime.bigint() - start) / calls;
+}
+
+
+// Measure the hot-path API with the binding selected by the environment and report the result to the parent
+function runChild(calls) {
+    const PCAS = require('..');
+
+    PCAS.createServer([
+        { name: 'bench:scalar', type: 'double' },
+        { name: 'bench:waveform', type: 'double', count: WAVEFORM_COUNT, deadband: 'always' }
+    ]);
+
+    const array = Array.from({ length: WAVEFORM_COUNT }, (_, i) => i);
+    const typed = Float64Array.from(array);
+
+    const result = {
+        binding: PCAS.getBinding(),
+        setScalar: measure(calls, (i) => PCAS.setParam('bench:scalar', i)),
+        getScalar: measure(calls, () => PCAS.getParam('bench:scalar')),
+        setStatus: measure(calls, (i) => PCAS.setParamStatus('bench:scalar', 0, i & 1)),
+        updatePVs: measure(calls, (i) => { PCAS.setParam('bench:scalar', i); PCAS.updatePVs(); }),
+        setWaveform: measure(calls / 100, (i) => { array[0] = i; PCAS.setParam('bench:waveform', array); }),
+        setTyped: measure(calls / 100, (i) => { typed[0] = i; PCAS.setParam('bench:waveform', typed); }),
+        getWaveform: measure(calls / 100, () => PCAS.getParam('bench:waveform')),
+    };
+
+    process.send(result);
+    process.exit(0);
+}
+
+
+function runParent(calls) {
+    const names = ['setScalar', 'getScalar', 'setStatus', 'updatePVs', 'setWaveform', 'setTyped', 'getWaveform'];
+    console.log('binding'.padEnd(8), ...names.map((name) => `${name} (ns)`.padStart(18)));
+
+    const bindings = ['napi', 'koffi'];
+    let index = 0;
+    const next = () => {
+        if(index >= bindings.length) return;
+        const env = Object.assign({}, process.env, { PCAS_BINDING: bindings[index++] });
+        const child = fork(__filename, ['--child', String(calls)], { env });
+        child.on('message', (result) => {
+            console.log(result.binding.padEnd(8), ...names.map((name) => result[name].toFixed(0).padStart(18)));
+        });
+        child.on('exit', next);
+    };
+    next();
+}
+
+
+if(process.argv[2] === '--child') {
+    runChild(Number(process.argv[3]));
+} else {
+    const calls = Number(process.argv[2]);
+    runParent(calls > 0 ? calls : DEFAULT_CALLS);
+}
@@ -0,0 +1,65 @@
+// Loopback load test of a server from createServer() with the Channel Access client in wrapper/pcasLoad.cpp
+//
+// Usage: node benchmarks/load.js [channels] [monitors] [rate] [seconds]
+//
+// The server updates every PV at rate Hz with setParams() and updatePVs(), and pcasLoad subscribes to each PV
+// monitors times and reports the events per second, the coalesced updates and the p50, p99 and p999 latency.
+// pcasLoad is built from wrapper/binding.gyp, PCAS_LOAD may point to another build of it.
+
+const path = require('path');
+const { spawn } = require('child_process');
+
+
+const DEFAULT_CHANNELS = 1000;
+const DEFAULT_MONITORS = 1;
+const DEFAULT_RATE = 10;
+const DEFAULT_SECONDS = 10;
+const PREFIX = 'load:pv';
+
+
+// Server and client only talk over loopback, set before the server is created
+process.env.EPICS_CAS_INTF_ADDR_LIST = process.env.EPICS_CAS_INTF_ADDR_LIST || '127.0.0.1';
+process.env.EPICS_CA_ADDR_LIST = process.env.EPICS_CA_ADDR_LIST || '127.0.0.1';
+process.env.EPICS_CA_AUTO_ADDR_LIST = process.env.EPICS_CA_AUTO_ADDR_LIST || 'NO';
+
+const PCAS = require('..');
+
+
+function positive(arg, fallback) {
+    const value = Number(arg);
+    return value > 0 ? value : fallback;
+}
+
+const channels = positive(process.argv[2], DEFAULT_CHANNELS);
+const monitors = positive(process.argv[3], DEFAULT_MONITORS);
+const rate = positive(process.argv[4], DEFAULT_RATE);
+const seconds = positive(process.argv[5], DEFAULT_SECONDS);
+
+const pvList = [];
+for(let i = 0; i < channels; i++) {
+    pvList.push({ name: `${PREFIX}${i}`, type: 'double' });
+}
+PCAS.createServer(pvList);
+
+// Every update carries the sequence number, so pcasLoad counts the updates a monitor missed
+let seq = 0;
+const params = pvList.map((pv) => ({ name: pv.name, value: 0 }));
+const timer = setInterval(() => {
+    seq++;
+    for(const param of params) {
+        param.value = seq;
+    }
+    PCAS.setParams(params, true);
+}, 1000 / rate);
+
+const binary = process.env.PCAS_LOAD || path.join(__dirname, '..', 'wrapper', 'build', 'Release', 'pcasLoad');
+const child = spawn(binary, ['-n', PREFIX, '-c', String(channels), '-m', String(monitors), '-d', String(seconds)], { stdio: 'inherit' });
+child.on('error', (err) => {
+    console.log(`Cannot run ${binary}: ${err.message}`);
+    process.exit(1);
+});
+child.on('exit', (code) => {
+    clearInterval(timer);
+    console.log(`server sent ${seq} updates per PV at ${rate} Hz`);
+    process.exit(code === null ? 1 : code);
+});
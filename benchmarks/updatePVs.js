@@ -0,0 +1,86 @@
+// Benchmark of updatePVs() against the number of PVs in one server
+//
+// Usage: node benchmarks/updatePVs.js [count ...]
+//
+// Each PV count runs in its own process since only one server can be created per process.
+// Only changed PVs are visited, so the idle and sparse costs should stay flat as the PV count grows,
+// and the cost per changed PV should stay flat when every PV changed.
+
+const { fork } = require('child_process');
+
+
+const DEFAULT_COUNTS = [1000, 5000, 10000, 50000];
+const REPEAT = 20;
+const SPARSE = 3;
+
+
+// Measure updatePVs() with a server holding count PVs and report the result to the parent
+function runChild(count) {
+    const PCAS = require('..');
+
+    const pvList = [];
+    for(let i = 0; i < count; i++) {
+        pvList.push({ name: `bench:pv${i}`, type: 'double' });
+    }
+    PCAS.createServer(pvList);
+
+    // Nothing changed
+    let start = process.hrtime.bigint();
+    for(let i = 0; i < REPEAT; i++) {
+        PCAS.updatePVs();
+    }
+    let idle = Number(process.hrtime.bigint() - start) / REPEAT;
+
+    // A few PVs changed
+    let sparse = 0;
+    for(let i = 0; i < REPEAT; i++) {
+        PCAS.setParams(pvList.slice(0, SPARSE).map((pv, index) => ({ name: pv.name, value: i + index })), false);
+        start = process.hrtime.bigint();
+        PCAS.updatePVs();
+        sparse += Number(process.hrtime.bigint() - start);
+    }
+    sparse /= REPEAT;
+
+    // Every PV changed
+    let changed = 0;
+    for(let i = 0; i < REPEAT; i++) {
+        PCAS.setParams(pvList.map((pv, index) => ({ name: pv.name, value: i + index })), false);
+        start = process.hrtime.bigint();
+        PCAS.updatePVs();
+        changed += Number(process.hrtime.bigint() - start);
+    }
+    changed /= REPEAT;
+
+    process.send({ count, idle, sparse, changed });
+    process.exit(0);
+}
+
+
+function runParent(counts) {
+    console.log('count'.padStart(10), 'idle (ms)'.padStart(12), `${SPARSE} changed (ms)`.padStart(16), 'changed (ms)'.padStart(14), 'ns/PV'.padStart(10));
+
+    let index = 0;
+    const next = () => {
+        if(index >= counts.length) return;
+        const child = fork(__filename, ['--child', String(counts[index++])]);
+        child.on('message', (result) => {
+            console.log(
+                String(result.count).padStart(10),
+                (result.idle / 1e6).toFixed(3).padStart(12),
+                (result.sparse / 1e6).toFixed(3).padStart(16),
+                (result.changed / 1e6).toFixed(3).padStart(14),
+                (result.changed / result.count).toFixed(1).padStart(10)
+            );
+        });
+        child.on('exit', next);
+    };
+    next();
+}
+
+
+if(process.argv[2] === '--child') {
+    runChild(Number(process.argv[3]));
+} else {
+    const counts = process.argv.slice(2).map(Number).filter((n) => n > 0);
+    runParent(counts.length ? counts : DEFAULT_COUNTS);
+}
@@ -0,0 +1,77 @@
+// Benchmark of setParam() and getParam() on waveform PVs with plain arrays and typed arrays
+//
+// Usage: node benchmarks/waveform.js [count ...]
+//
+// Each element count runs in its own process since only one server can be created per process.
+// The typed array paths pass the memory of the array to C++ directly, so they should be much faster
+// than the plain array paths, which marshal and decode every element.
+
+const { fork } = require('child_process');
+
+
+const DEFAULT_COUNTS = [1000, 10000, 100000];
+const REPEAT = 200;
+
+
+// Average time in nanoseconds of one call of func
+function measure(func) {
+    let start = process.hrtime.bigint();
+    for(let i = 0; i < REPEAT; i++) {
+        func(i);
+    }
+    return Number(process.hrtime.bigint() - start) / REPEAT;
+}
+
+
+// Measure the set and get paths with a waveform of count elements and report the result to the parent
+function runChild(count) {
+    const PCAS = require('..');
+
+    const name = 'bench:waveform';
+    PCAS.createServer([{ name: name, type: 'double', count: count, deadband: 'always' }]);
+
+    const array = Array.from({ length: count }, (_, i) => i);
+    const typed = Float64Array.from(array);
+
+    const result = {
+        count,
+        setArray: measure((i) => { array[0] = i; PCAS.setParam(name, array); }),
+        setTyped: measure((i) => { typed[0] = i; PCAS.setParam(name, typed); }),
+        getArray: measure(() => PCAS.getParam(name)),
+        getTyped: measure(() => PCAS.getParamInto(name, typed)),
+    };
+
+    process.send(result);
+    process.exit(0);
+}
+
+
+function runParent(counts) {
+    console.log('count'.padStart(10), 'set array (us)'.padStart(16), 'set typed (us)'.padStart(16),
+        'get array (us)'.padStart(16), 'get typed (us)'.padStart(16));
+
+    let index = 0;
+    const next = () => {
+        if(index >= counts.length) return;
+        const child = fork(__filename, ['--child', String(counts[index++])]);
+        child.on('message', (result) => {
+            console.log(
+                String(result.count).padStart(10),
+                (result.setArray / 1e3).toFixed(1).padStart(16),
+                (result.setTyped / 1e3).toFixed(1).padStart(16),
+                (result.getArray / 1e3).toFixed(1).padStart(16),
+                (result.getTyped / 1e3).toFixed(1).padStart(16)
+            );
+        });
+        child.on('exit', next);
+    };
+    next();
+}
+
+
+if(process.argv[2] === '--child') {
+    runChild(Number(process.argv[3]));
+} else {
+    const counts = process.argv.slice(2).map(Number).filter((n) => n > 0);
+    runParent(counts.length ? counts : DEFAULT_COUNTS);
+}
@@ -0,0 +1,26 @@
+const PCAS = require('node-epics-pcas');
+
+const pvList = [
+    { name: 'test:dummy01', type: 'double', count: 1, soft: false, readTimeout: 1 },
+    { name: 'test:dummy02', type: 'double', count: 5, soft: false, maxReads: 1 },
+];
+
+// Simulate a device which takes 50 ms to respond
+function readDevice(name) {
+    return new Promise((resolve) => {
+        setTimeout(() => {
+            if(name === 'test:dummy02') {
+                resolve([Math.random(), Math.random(), Math.random(), Math.random(), Math.random()]);
+            } else {
+                resolve(Math.random() * 100);
+            }
+        }, 50);
+    });
+}
+
+// Client reads are completed when the promise resolves, other clients are served in the meantime
+async function read(name) {
+    return await readDevice(name);
+}
+
+PCAS.createServer(pvList, read, null);
@@ -0,0 +1,21 @@
+const PCAS = require('node-epics-pcas');
+
+const pvList = [
+    { name: 'test:dummy01', type: 'int', count: 1, scan: 1, soft: false },
+    { name: 'test:dummy02', type: 'float', count: 1, scan: 1, soft: false },
+    { name: 'test:dummy03', type: 'double', count: 1, scan: 1, soft: false },
+    { name: 'test:dummy04', type: 'double', count: 5, scan: 1, soft: false },
+];
+
+// Called once per scan tick for all PVs with the same scan period
+function groupRead(requests) {
+    for(let request of requests) {
+        if(request.name === 'test:dummy04') {
+            request.value = [Math.random(), Math.random(), Math.random(), Math.random(), Math.random()];
+        } else {
+            request.value = Math.random() * 100;
+        }
+    }
+}
+
+PCAS.createServer(pvList, null, null, { groupRead });
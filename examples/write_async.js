@@ -0,0 +1,27 @@
+const PCAS = require('node-epics-pcas');
+
+const pvList = [
+    { name: 'test:dummy01', type: 'double', count: 1, soft: false, maxWrites: 1, writeQueue: 4 },
+    { name: 'test:dummy02', type: 'int', count: 1, soft: false, writeTimeout: 1 },
+];
+
+// Simulate a device which takes 100 ms to apply a setting
+function writeDevice(name, value) {
+    return new Promise((resolve, reject) => {
+        setTimeout(() => {
+            if(value < 0) {
+                reject(new Error(`negative value ${value} is rejected by the device`));
+            } else {
+                resolve();
+            }
+        }, 100);
+    });
+}
+
+// caput -c returns when the promise settles, a rejected write raises a WRITE alarm
+async function write(name, value) {
+    await writeDevice(name, value);
+    console.log(`${name} is set to ${value}`);
+}
+
+PCAS.createServer(pvList, null, write);
@@ -30,13 +30,86 @@ if(!LIBPCAS_PATH) {
 const libpcas = koffi.load(LIBPCAS_PATH);
 
 
+// Bind a function added to wrapper/wrapper.cpp after the baseline API on its first call, so a shared library built
+// from an older wrapper can still be loaded, and calling the missing function names the rebuild instead of failing in require()
+function bindFunc(name, result, args) {
+    let func = null;
+    return function() {
+        if(func === null) {
+            try {
+                func = libpcas.func(name, result, args);
+            } catch(error) {
+                throw new Error(`${name}() is missing from ${LIBPCAS_PATH}, rebuild the PCAS shared library from wrapper/wrapper.cpp as described in wrapper/README`);
+            }
+        }
+        return func.apply(null, arguments);
+    };
+}
+
+
+// Optional N-API addon built from wrapper/napi.cpp, which serves the hot path and the read and write callbacks without koffi
+// It is loaded from the directory of the shared library, and PCAS_BINDING=koffi forces the koffi binding
+let native = null;
+if(process.env.PCAS_BINDING !== 'koffi') {
+    try {
+        native = require(path.join(path.dirname(LIBPCAS_PATH), 'pcas.node'));
+    } catch(error) {
+        native = null;
+    }
+}
+
+
 // EPICS maximum string size
 const MAX_STRING_SIZE = 40;
 
 
+// Default number of threads serving the scan scheduler
+const DEFAULT_SCAN_WORKERS = 2;
+
+
+// Default period in seconds of the statistics PVs
+const DEFAULT_STATS_PERIOD = 1;
+
+
+// Default timeout in seconds of asynchronous reads and writes
+const DEFAULT_READ_TIMEOUT = 5;
+const DEFAULT_WRITE_TIMEOUT = 5;
+
+
+// Default number of writes in progress and queued writes for each PV
+const DEFAULT_MAX_WRITES = 1;
+const DEFAULT_WRITE_QUEUE = 16;
+
+
+// Change detection modes of array PVs, the values match DeadbandMode in wrapper.h
+const DeadbandMode = {
+    always: 0,
+    exact: 1,
+    absolute: 2,
+    relative: 3
+};
+
+
+// Kinds of requests queued by C++, the values match RequestKind in wrapper.h
+const RequestKind = {
+    read: 0,
+    write: 1,
+    scan: 2
+};
+
+
+// Number of requests handled in one call of the drain
+const REQUEST_BATCH = 256;
+
+
 // Global function pointer
 let driverReadFunc = null;
 let driverWriteFunc = null;
+let driverGroupReadFunc = null;
+
+
+// Type and count of each PV, which are cached to avoid querying C++ on every update
+const pvInfoMap = new Map();
 
 
 // PV definition structure
@@ -58,6 +131,13 @@ const pvDef = koffi.struct('pvDef', {
     mdel: 'double',
     adel: 'double',
     soft: 'bool',
+    maxReads: 'int',
+    readTimeout: 'double',
+    maxWrites: 'int',
+    writeQueue: 'int',
+    writeTimeout: 'double',
+    deadband: 'int',
+    maxRate: 'double',
     value: 'void *'
 });
 
@@ -70,28 +150,154 @@ const SimpleValue = koffi.struct('SimpleValue', {
 });
 
 
+// Parameter descriptor for batch update
+const SimpleParam = koffi.struct('SimpleParam', {
+    name: 'char *',
+    offset: 'int'
+});
+
+
+// Counters of name resolution for client searches
+const SearchStats = koffi.struct('SearchStats', {
+    hits: 'uint64',
+    misses: 'uint64',
+    filterRejects: 'uint64',
+    names: 'int',
+    indexSize: 'int',
+    filterBits: 'int'
+});
+
+
+// Statistics of the scan scheduler
+const ScanStats = koffi.struct('ScanStats', {
+    groups: 'int',
+    workers: 'int',
+    ticks: 'uint64',
+    missed: 'uint64',
+    timeouts: 'uint64',
+    maxLag: 'double'
+});
+
+
+// Statistics of the buffer pool
+const PoolStats = koffi.struct('PoolStats', {
+    allocs: 'uint64',
+    frees: 'uint64',
+    hits: 'uint64',
+    misses: 'uint64',
+    bytesInUse: 'uint64',
+    bytesCached: 'uint64'
+});
+
+
+// Descriptor of a slot region
+const SlotInfo = koffi.struct('SlotInfo', {
+    values: 'void *',
+    seqs: 'void *',
+    count: 'int',
+    elementSize: 'int'
+});
+
+
+// Counters of update events of a PV
+const PostStats = koffi.struct('PostStats', {
+    posted: 'uint64',
+    coalesced: 'uint64'
+});
+
+
+// Descriptor of a PV read in a scan group
+const SimpleRead = koffi.struct('SimpleRead', {
+    name: 'char *',
+    handle: 'int',
+    value: 'SimpleValue'
+});
+
+
+// Descriptor of a request drained from the request queue
+const RequestInfo = koffi.struct('RequestInfo', {
+    kind: 'int',
+    id: 'int',
+    name: 'char *',
+    value: 'SimpleValue',
+    reads: 'void *',
+    count: 'int'
+});
+
+
+// Statistics of the request queue
+const RequestStats = koffi.struct('RequestStats', {
+    depth: 'int',
+    maxDepth: 'int',
+    enqueued: 'uint64',
+    drained: 'uint64',
+    batches: 'uint64',
+    maxBatch: 'int',
+    meanWait: 'double',
+    maxWait: 'double'
+});
+
+
+// Descriptors of one drained batch, which are reused by every drain
+const requestBatch = koffi.alloc('RequestInfo', REQUEST_BATCH);
+
+
 // Callback prototype to be called by C++
-const ReadCallback = koffi.proto('ReadCallback', 'void', ['char *', koffi.out('void *')]);
-const WriteCallback = koffi.proto('WriteCallback', 'void', ['char *', 'void *']);
+const WakeupCallback = koffi.proto('WakeupCallback', 'void', []);
 
 
 // Functions provided by C++ to create the PCAS server
 const _createServer = libpcas.func('createServer', 'void', ['pvDef *', 'int']);
 const _createDriver = libpcas.func('createDriver', 'void', []);
-const _installCallback = libpcas.func('installCallback', 'void', [koffi.pointer(ReadCallback), koffi.pointer(WriteCallback)]);
-const _installReadCallback = libpcas.func('installReadCallback', 'void', [koffi.pointer(ReadCallback)]);
-const _installWriteCallback = libpcas.func('installWriteCallback', 'void', [koffi.pointer(WriteCallback)]);
+const _addPVs = bindFunc('addPVs', 'int', ['pvDef *', 'int']);
+const _removePVs = bindFunc('removePVs', 'int', ['const char **', 'int']);
+const _createStatsPVs = bindFunc('createStatsPVs', 'void', ['char *', 'double']);
+const _installWakeupCallback = bindFunc('installWakeupCallback', 'void', [koffi.pointer(WakeupCallback), 'int']);
+const _drainRequests = bindFunc('drainRequests', 'int', ['void *', 'int']);
+const _getRequestStats = bindFunc('getRequestStats', 'void', [koffi.out('RequestStats *')]);
+const _completeRead = bindFunc('completeRead', 'int', ['int', 'SimpleValue *', 'int', 'int']);
+const _completeWrite = bindFunc('completeWrite', 'int', ['int', 'int', 'int']);
+const _completeScan = bindFunc('completeScan', 'int', ['int', 'int', 'int']);
 const _createScanThread = libpcas.func('createScanThread', 'void', []);
+const _createScanScheduler = bindFunc('createScanScheduler', 'void', ['int']);
+const _getScanStats = bindFunc('getScanStats', 'void', [koffi.out('ScanStats *')]);
+const _setScanTimeout = bindFunc('setScanTimeout', 'void', ['double']);
 const _serverProcess = libpcas.func('serverProcess', 'void', ['double']);
 const _setDebugLevel = libpcas.func('setDebugLevel', 'void', ['int']);
+const _setLogLevel = bindFunc('setLogLevel', 'int', ['char *', 'int']);
+const _setLogOutput = bindFunc('setLogOutput', 'void', ['char *']);
+const _getSearchStats = bindFunc('getSearchStats', 'void', [koffi.out('SearchStats *')]);
+const _getPoolStats = bindFunc('getPoolStats', 'void', [koffi.out('PoolStats *')]);
+const _getPostStats = bindFunc('getPostStats', 'void', ['char *', koffi.out('PostStats *')]);
 
 
 // Functions provided by C++ to exchange data with the parameter library in C++
 const _getParam = libpcas.func('getParam', 'void', ['char *', koffi.out('SimpleValue *')]);
 const _setParam = libpcas.func('setParam', 'void', ['char *', 'SimpleValue *']);
+const _setParams = bindFunc('setParams', 'int', ['SimpleParam *', 'int', 'void *', 'int']);
 const _setParamStatus = libpcas.func('setParamStatus', 'void', ['char *', 'int', 'int']);
 const _updatePVs = libpcas.func('updatePVs', 'void', []);
+const _setAutoUpdate = bindFunc('setAutoUpdate', 'void', ['double']);
 const _getSimpleValue = libpcas.func('getSimpleValue', 'void', ['char *', koffi.out('SimpleValue *')]);
+const _releaseParam = bindFunc('releaseParam', 'void', ['void *']);
+const _getParamBuffer = bindFunc('getParamBuffer', 'int', ['char *', 'void *', 'int']);
+const _setParamBuffer = bindFunc('setParamBuffer', 'int', ['char *', 'void *', 'int']);
+
+
+// Functions provided by C++ to access scalar data in the parameter library by PV handle
+const _getHandle = bindFunc('getHandle', 'int', ['char *']);
+const _setParamDoubleH = bindFunc('setParamDoubleH', 'void', ['int', 'double']);
+const _setParamInt32H = bindFunc('setParamInt32H', 'void', ['int', 'int']);
+const _getParamDoubleH = bindFunc('getParamDoubleH', 'double', ['int']);
+const _getParamInt32H = bindFunc('getParamInt32H', 'int', ['int']);
+const _setParamStatusH = bindFunc('setParamStatusH', 'void', ['int', 'int', 'int']);
+
+
+// Functions provided by C++ to write value slots directly and commit them to the parameter library
+const _getSlotInfo = bindFunc('getSlotInfo', 'void', ['int', koffi.out('SlotInfo *')]);
+const _getSlot = bindFunc('getSlot', 'int', ['int', koffi.out(koffi.pointer('int'))]);
+const _commit = bindFunc('commit', 'int', ['int *', 'int']);
+const _commitAll = bindFunc('commitAll', 'int', []);
 
 
 // Convert string array to Node.js buffer
@@ -116,6 +322,72 @@ function bufferToStringArray(buffer, count) {
 }
 
 
+// Get the size in bytes of a single element for the PV type
+function getElementSize(type) {
+    switch(type) {
+        case aitEnum.aitEnumInt32:
+            return 4;
+        case aitEnum.aitEnumFloat32:
+            return 4;
+        case aitEnum.aitEnumFloat64:
+            return 8;
+        case aitEnum.aitEnumString:
+            return MAX_STRING_SIZE;
+        case aitEnum.aitEnumEnum16:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+
+// Check if the memory of a typed array can be passed to C++ as the value of a PV type
+// A Buffer or Uint8Array holds raw bytes of any type, other typed arrays must match the element type
+function isTypedArrayOf(type, data) {
+    if(data instanceof Uint8Array) return true;
+    switch(type) {
+        case aitEnum.aitEnumInt32:
+        case aitEnum.aitEnumEnum16:
+            return data instanceof Int32Array;
+        case aitEnum.aitEnumFloat32:
+            return data instanceof Float32Array;
+        case aitEnum.aitEnumFloat64:
+            return data instanceof Float64Array;
+        default:
+            return false;
+    }
+}
+
+
+// Pack data into the buffer at offset according to the PV type
+function packValue(buffer, offset, type, data) {
+    // The memory of a typed array is already laid out in the PV type
+    if(ArrayBuffer.isView(data)) {
+        buffer.set(new Uint8Array(data.buffer, data.byteOffset, data.byteLength), offset);
+        return;
+    }
+    for(let i = 0; i < data.length; i++) {
+        switch(type) {
+            case aitEnum.aitEnumInt32:
+                buffer.writeInt32LE(data[i], offset + i * 4);
+                break;
+            case aitEnum.aitEnumFloat32:
+                buffer.writeFloatLE(data[i], offset + i * 4);
+                break;
+            case aitEnum.aitEnumFloat64:
+                buffer.writeDoubleLE(data[i], offset + i * 8);
+                break;
+            case aitEnum.aitEnumString:
+                buffer.write(data[i], offset + i * MAX_STRING_SIZE, MAX_STRING_SIZE);
+                break;
+            case aitEnum.aitEnumEnum16:
+                buffer.writeInt32LE(data[i], offset + i * 4);
+                break;
+        }
+    }
+}
+
+
 // Convert PV data type to PCAS architecture­-independent type
 function convertPVTypeToAitType(pvType) {
     let aitType;
@@ -146,7 +418,9 @@ function convertPVTypeToAitType(pvType) {
 function validatePVField(pvList) {
     const availableFields = ['name', 'type', 'count', 'scan', 'enums', 'states',
                             'prec', 'unit', 'hilim', 'lolim', 'high', 'low',
-                            'hihi', 'lolo', 'mdel', 'adel', 'soft', 'value'];
+                            'hihi', 'lolo', 'mdel', 'adel', 'soft', 'maxReads',
+                            'readTimeout', 'maxWrites', 'writeQueue', 'writeTimeout',
+                            'deadband', 'maxRate', 'value'];
 
     for(let pv of pvList) {
         if(pv.name === undefined) {
@@ -212,6 +486,27 @@ function validatePVField(pvList) {
                 case 'soft':
                     if(typeof value !== 'boolean') valid = false;
                     break;
+                case 'maxReads':
+                    if(!Number.isInteger(value) || value < 0) valid = false;
+                    break;
+                case 'readTimeout':
+                    if(typeof(value) !== 'number') valid = false;
+                    break;
+                case 'maxWrites':
+                    if(!Number.isInteger(value) || value < 0) valid = false;
+                    break;
+                case 'writeQueue':
+                    if(!Number.isInteger(value) || value < 0) valid = false;
+                    break;
+                case 'writeTimeout':
+                    if(typeof(value) !== 'number') valid = false;
+                    break;
+                case 'deadband':
+                    if(!Object.keys(DeadbandMode).includes(value)) valid = false;
+                    break;
+                case 'maxRate':
+                    if(typeof(value) !== 'number' || value < 0) valid = false;
+                    break;
                 case 'value':
                     if(pv.count === undefined || pv.count === 1) {
                         if(Array.isArray(value)) {
@@ -273,6 +568,14 @@ function convertPVFieldFormat(pvList) {
         if(pv.mdel === undefined) pv.mdel = 0;
         if(pv.adel === undefined) pv.adel = 0;
         if(pv.soft === undefined) pv.soft = true;
+        if(pv.maxReads === undefined) pv.maxReads = 0;
+        if(pv.readTimeout === undefined) pv.readTimeout = DEFAULT_READ_TIMEOUT;
+        if(pv.maxWrites === undefined) pv.maxWrites = DEFAULT_MAX_WRITES;
+        if(pv.writeQueue === undefined) pv.writeQueue = DEFAULT_WRITE_QUEUE;
+        if(pv.writeTimeout === undefined) pv.writeTimeout = DEFAULT_WRITE_TIMEOUT;
+        if(pv.deadband === undefined) pv.deadband = 'absolute';
+        pv.deadband = DeadbandMode[pv.deadband];
+        if(pv.maxRate === undefined) pv.maxRate = 0;
         if(pv.value === undefined) {
             if(pv.type === aitEnum.aitEnumString) {
                 if(pv.count > 1) {
@@ -316,22 +619,20 @@ function convertPVFieldFormat(pvList) {
 }
 
 
-// The read callback to be called by C++
-const readCallbackPtr = koffi.register((name, result) => {
-    let data = driverReadFunc(name);
+// Encode data returned by the driver into the value buffer provided by C++
+function encodeValue(simpleValue, data, name, caller) {
     if(data === null || data === undefined) {
-        console.log(`readCallbackPtr(): no data return from driverReadFunc() for PV ${name}`);
+        console.log(`${caller}(): no data return from the driver for PV ${name}`);
         return;
     }
     if(!Array.isArray(data)) {
         data = [data];
     }
 
-    let simpleValue = koffi.decode(result, 'SimpleValue');
     let buffer = simpleValue.buffer;
 
     if(simpleValue.count !== data.length) {
-        console.log(`readCallbackPtr(): returned data length ${data.length} is not consistent with PV count ${simpleValue.count} for PV ${name}`);
+        console.log(`${caller}(): returned data length ${data.length} is not consistent with PV count ${simpleValue.count} for PV ${name}`);
         return;
     }
 
@@ -355,14 +656,137 @@ const readCallbackPtr = koffi.register((name, result) => {
             koffi.encode(buffer, 'int', data, data.length);
             break;
         default:
-            console.log(`readCallbackPtr(): Unknown PV type ${simpleValue.type}.`);
+            console.log(`${caller}(): Unknown PV type ${simpleValue.type}.`);
+    }
+}
+
+
+// Read data of a scanned PV, a promise is returned if the read function is asynchronous
+function readScanned(name) {
+    if(driverReadFunc.length >= 2) {
+        return new Promise((resolve, reject) => {
+            driverReadFunc(name, (error, value) => error ? reject(error) : resolve(value));
+        });
+    }
+    return driverReadFunc(name);
+}
+
+
+// Serve a scan tick of a group, and complete it in C++ after the value buffers of its reads are filled
+// The group read function receives an array of { name, handle, value } and assigns value of every item in place
+function serveScan(id, reads, count) {
+    let descriptors = koffi.decode(reads, 'SimpleRead', count);
+    let finish = (values) => {
+        for(let i = 0; i < count; i++) {
+            encodeValue(descriptors[i].value, values[i], descriptors[i].name, 'serveScan');
+        }
+        _completeScan(id, Alarm.NO_ALARM, Severity.NO_ALARM);
+    };
+    let fail = (error) => {
+        console.log(`serveScan(): read of scan group failed, ${error}`);
+        _completeScan(id, Alarm.READ_ALARM, Severity.INVALID_ALARM);
+    };
+
+    try {
+        if(driverGroupReadFunc) {
+            let requests = descriptors.map((read) => ({ name: read.name, handle: read.handle, value: undefined }));
+            let result = driverGroupReadFunc(requests);
+            if(result instanceof Promise) {
+                result.then(() => finish(requests.map((request) => request.value)), fail);
+            } else {
+                finish(requests.map((request) => request.value));
+            }
+            return;
+        }
+        let values = descriptors.map((read) => readScanned(read.name));
+        if(values.some((value) => value instanceof Promise)) {
+            Promise.all(values).then(finish, fail);
+        } else {
+            finish(values);
+        }
+    } catch(error) {
+        fail(error);
+    }
+}
+
+
+// Complete an asynchronous read in C++ with data returned by the driver
+function completeAsyncRead(id, name, data) {
+    let info = pvInfoMap.get(name);
+    if(data === null || data === undefined) {
+        console.log(`serveAsyncRead(): no data return from the driver for PV ${name}`);
+        finishAsyncRead(id, name, null, Alarm.READ_ALARM, Severity.INVALID_ALARM);
+        return;
+    }
+    if(!Array.isArray(data) && !ArrayBuffer.isView(data)) {
+        data = [data];
+    }
+
+    if(!ArrayBuffer.isView(data) && info.count !== data.length) {
+        console.log(`serveAsyncRead(): returned data length ${data.length} is not consistent with PV count ${info.count} for PV ${name}`);
+        finishAsyncRead(id, name, null, Alarm.READ_ALARM, Severity.INVALID_ALARM);
+        return;
+    }
+    finishAsyncRead(id, name, data, Alarm.NO_ALARM, Severity.NO_ALARM);
+}
+
+
+// Fail an asynchronous read in C++, the PV gets a READ alarm
+function failAsyncRead(id, name, error) {
+    console.log(`serveAsyncRead(): read of PV ${name} failed, ${error}`);
+    finishAsyncRead(id, name, null, Alarm.READ_ALARM, Severity.INVALID_ALARM);
+}
+
+
+// Pass the completion of an asynchronous read to C++, data is null for a failed read
+function finishAsyncRead(id, name, data, alarm, severity) {
+    if(native) {
+        native.completeRead(id, name, data, alarm, severity);
+        return;
     }
-}, koffi.pointer(ReadCallback));
+    if(data === null) {
+        _completeRead(id, null, alarm, severity);
+        return;
+    }
+
+    let info = pvInfoMap.get(name);
+    if(ArrayBuffer.isView(data) && (!isTypedArrayOf(info.type, data) || data.byteLength !== getElementSize(info.type) * info.count)) {
+        console.log(`serveAsyncRead(): returned ${data.constructor.name} is not consistent with PV ${name}`);
+        _completeRead(id, null, Alarm.READ_ALARM, Severity.INVALID_ALARM);
+        return;
+    }
+    let buffer = Buffer.alloc(getElementSize(info.type) * info.count);
+    packValue(buffer, 0, info.type, data);
+    _completeRead(id, { type: info.type, count: info.count, buffer: buffer }, alarm, severity);
+}
+
+
+// Serve a client read asynchronously, and complete it in C++ when the data is ready
+// The read function may return the data, a promise, or take a completion function done(error, data) as the second argument
+function serveAsyncRead(name, id) {
+    try {
+        if(driverReadFunc.length >= 2) {
+            driverReadFunc(name, (error, data) => {
+                if(error) {
+                    failAsyncRead(id, name, error);
+                } else {
+                    completeAsyncRead(id, name, data);
+                }
+            });
+            return;
+        }
+        Promise.resolve(driverReadFunc(name)).then(
+            (data) => completeAsyncRead(id, name, data),
+            (error) => failAsyncRead(id, name, error)
+        );
+    } catch(error) {
+        failAsyncRead(id, name, error);
+    }
+}
 
 
-// The write callback to be called by C++
-const writeCallbackPtr = koffi.register((name, value) => {
-    let simpleValue = koffi.decode(value, 'SimpleValue');
+// Decode data passed by C++ for the write function
+function decodeValue(simpleValue, caller) {
     let array;
     switch(simpleValue.type) {
         case aitEnum.aitEnumInt32:
@@ -381,33 +805,146 @@ const writeCallbackPtr = koffi.register((name, value) => {
             array = koffi.decode(simpleValue.buffer, 'int', simpleValue.count);
             break;
         default:
-            console.log(`writeCallbackPtr(): Unknown PV type ${simpleValue.type}`);
+            console.log(`${caller}(): Unknown PV type ${simpleValue.type}`);
+            return undefined;
+    }
+    return simpleValue.count === 1 ? array[0] : array;
+}
+
+
+// Pass the completion of an asynchronous write to C++
+function finishAsyncWrite(id, alarm, severity) {
+    if(native) {
+        native.completeWrite(id, alarm, severity);
+    } else {
+        _completeWrite(id, alarm, severity);
+    }
+}
+
+
+// Fail an asynchronous write in C++, the PV gets a WRITE alarm and the put callback of the client fails
+function failAsyncWrite(id, name, error) {
+    console.log(`serveAsyncWrite(): write of PV ${name} failed, ${error}`);
+    finishAsyncWrite(id, Alarm.WRITE_ALARM, Severity.INVALID_ALARM);
+}
+
+
+// Serve a client write asynchronously, and complete it in C++ when the write settles
+// The write function may return a promise, or take a completion function done(error) as the third argument
+// The value is taken by the parameter library and the put callback of the client completes when the write settles
+function serveAsyncWrite(name, data, id) {
+    try {
+        if(driverWriteFunc.length >= 3) {
+            driverWriteFunc(name, data, (error) => {
+                if(error) {
+                    failAsyncWrite(id, name, error);
+                } else {
+                    finishAsyncWrite(id, Alarm.NO_ALARM, Severity.NO_ALARM);
+                }
+            });
             return;
+        }
+        Promise.resolve(driverWriteFunc(name, data)).then(
+            () => finishAsyncWrite(id, Alarm.NO_ALARM, Severity.NO_ALARM),
+            (error) => failAsyncWrite(id, name, error)
+        );
+    } catch(error) {
+        failAsyncWrite(id, name, error);
+    }
+}
+
+
+// Handle the requests queued by the server and scan threads in batches
+// C++ wakes up Node.js once, and the queue is drained until fewer requests than the batch size are returned
+function drainRequests() {
+    let count = _drainRequests(requestBatch, REQUEST_BATCH);
+    if(count === 0) return;
+
+    let infos = koffi.decode(requestBatch, 'RequestInfo', count);
+    for(let info of infos) {
+        switch(info.kind) {
+            case RequestKind.read:
+                serveAsyncRead(info.name, info.id);
+                break;
+            case RequestKind.write: {
+                let data = decodeValue(info.value, 'drainRequests');
+                if(data === undefined) {
+                    finishAsyncWrite(info.id, Alarm.WRITE_ALARM, Severity.INVALID_ALARM);
+                } else {
+                    serveAsyncWrite(info.name, data, info.id);
+                }
+                break;
+            }
+            case RequestKind.scan:
+                serveScan(info.id, info.reads, info.count);
+                break;
+            default:
+                console.log(`drainRequests(): Unknown request kind ${info.kind}`);
+        }
+    }
+
+    if(count === REQUEST_BATCH) {
+        setImmediate(drainRequests);
+    }
+}
+
+
+// The wakeup callback to be called by C++ from the server and scan threads, it only schedules the drain on the event loop
+const wakeupCallbackPtr = koffi.register(() => {
+    setImmediate(drainRequests);
+}, koffi.pointer(WakeupCallback));
+
+
+// Install the request queue for the registered driver functions
+// Client reads need the read function, client writes the write function, and scans either read function
+function installRequestQueue() {
+    let kinds = 0;
+    if(driverReadFunc) {
+        kinds |= 1 << RequestKind.read;
     }
-    let data = simpleValue.count === 1 ? array[0] : array;
-    driverWriteFunc(name, data);
-}, koffi.pointer(WriteCallback));
+    if(driverWriteFunc) {
+        kinds |= 1 << RequestKind.write;
+    }
+    if(driverReadFunc || driverGroupReadFunc) {
+        kinds |= 1 << RequestKind.scan;
+    }
+    if(kinds === 0) return;
+
+    if(native) {
+        native.installWakeupCallback(drainRequests, kinds);
+    } else {
+        _installWakeupCallback(wakeupCallbackPtr, kinds);
+    }
+}
 
 
-// Register driver's read function and install the read callback to C++
+// Register driver's read function, which serves client reads and scans through the request queue
 function registerDriverReadFunc(read) {
     if(!read) {
         console.log('registerDriverReadFunc(): read is empty');
         return;
     }
     driverReadFunc = read;
-    _installReadCallback(readCallbackPtr);
 }
 
 
-// Register driver's write function and install the write callback to C++
+// Register driver's write function, which serves client writes through the request queue
 function registerDriverWriteFunc(write) {
     if(!write) {
         console.log('registerDriverWriteFunc(): write is empty');
         return;
     }
     driverWriteFunc = write;
-    _installWriteCallback(writeCallbackPtr);
+}
+
+
+// Register driver's group read function, which serves scans through the request queue
+function registerDriverGroupReadFunc(groupRead) {
+    if(!groupRead) {
+        console.log('registerDriverGroupReadFunc(): groupRead is empty');
+        return;
+    }
+    driverGroupReadFunc = groupRead;
 }
 
 
@@ -425,27 +962,81 @@ function waitForever(interval) {
 
 
 // Create the PCAS server
-function createServer(pvList, read, write) {
+function createServer(pvList, read, write, options) {
+    options = options || {};
     validatePVField(pvList);
     convertPVFieldFormat(pvList);
 
     _createServer(pvList, pvList.length);
+    if(options.statsPrefix) {
+        _createStatsPVs(options.statsPrefix, options.statsPeriod || DEFAULT_STATS_PERIOD);
+    }
     _createDriver();
+    for(let pv of pvList) {
+        pvInfoMap.set(pv.name, { type: pv.type, count: pv.count });
+    }
     if(read) {
         registerDriverReadFunc(read);
     }
     if(write) {
         registerDriverWriteFunc(write);
     }
-    _createScanThread();
+    if(options.groupRead) {
+        registerDriverGroupReadFunc(options.groupRead);
+    }
+    installRequestQueue();
+    _createScanScheduler(options.scanWorkers || DEFAULT_SCAN_WORKERS);
+    if(options.scanTimeout) {
+        _setScanTimeout(options.scanTimeout);
+    }
+    if(options.autoUpdate) {
+        _setAutoUpdate(options.autoUpdate);
+    }
     _serverProcess(0.2);
 
     waitForever(1000);
 }
 
 
+// Add PVs to the running server, clients can find them as soon as this returns
+// PVs whose name already exists are skipped, and the number of added PVs is returned
+function addPVs(pvList) {
+    validatePVField(pvList);
+    pvList = pvList.filter(pv => {
+        if(_getHandle(pv.name) >= 0) {
+            console.log(`addPVs(): PV ${pv.name} already exists`);
+            return false;
+        }
+        return true;
+    });
+    if(!pvList.length) return 0;
+    convertPVFieldFormat(pvList);
+
+    let added = _addPVs(pvList, pvList.length);
+    for(let pv of pvList) {
+        pvInfoMap.set(pv.name, { type: pv.type, count: pv.count });
+    }
+    return added;
+}
+
+
+// Remove PVs from the running server, their clients are disconnected
+// The number of removed PVs is returned
+function removePVs(names) {
+    if(!names || !names.length) return 0;
+    let removed = _removePVs(names, names.length);
+    for(let name of names) {
+        pvInfoMap.delete(name);
+    }
+    return removed;
+}
+
+
 // Get data from the parameter library
 function getParam(name) {
+    if(native) {
+        return native.getParam(name);
+    }
     let simpleValue = {};
     _getParam(name, simpleValue);
     if(simpleValue.count < 1) {
@@ -474,8 +1065,8 @@ function getParam(name) {
             return null;
     }
 
-    // Release the memory dynamically allocated in C++
-    koffi.free(simpleValue.buffer);
+    // Return the memory dynamically allocated in C++ to its buffer pool
+    _releaseParam(simpleValue.buffer);
 
     return simpleValue.count === 1 ? array[0] : array;
 }
@@ -487,10 +1078,21 @@ function setParam(name, data) {
         console.log(`setParam(): empty data for PV ${name}`);
         return;
     }
+    if(native) {
+        native.setParam(name, data);
+        return;
+    }
+    if(ArrayBuffer.isView(data)) {
+        setParamTyped(name, data);
+        return;
+    }
     if(!Array.isArray(data)) data = [data];
 
-    let simpleValue = {};
-    _getSimpleValue(name, simpleValue);
+    let simpleValue = pvInfoMap.get(name);
+    if(!simpleValue) {
+        console.log(`setParam(): Unknown PV ${name}`);
+        return;
+    }
 
     if(simpleValue.count !== data.length) {
         console.log(`setParam(): data length ${data.length} is not consistent with PV count ${simpleValue.count} for PV ${name}`);
@@ -522,14 +1124,203 @@ function setParam(name, data) {
 }
 
 
+// Set data from a typed array or Buffer, whose memory is passed to C++ without marshalling
+function setParamTyped(name, data) {
+    let info = pvInfoMap.get(name);
+    if(!info) {
+        console.log(`setParam(): Unknown PV ${name}`);
+        return;
+    }
+    if(!isTypedArrayOf(info.type, data) || data.byteLength !== getElementSize(info.type) * info.count) {
+        console.log(`setParam(): ${data.constructor.name} of ${data.byteLength} bytes is not consistent with PV ${name}`);
+        return;
+    }
+    _setParamBuffer(name, data, data.byteLength);
+}
+
+
+// Copy data from the parameter library into a typed array or Buffer owned by the caller, nothing is allocated on either side
+// The typed array is returned, or null if it does not match the type and count of the PV
+function getParamInto(name, data) {
+    let info = pvInfoMap.get(name);
+    if(!info) {
+        console.log(`getParamInto(): Unknown PV ${name}`);
+        return null;
+    }
+    if(!ArrayBuffer.isView(data) || !isTypedArrayOf(info.type, data) || data.byteLength !== getElementSize(info.type) * info.count) {
+        console.log(`getParamInto(): data is not a typed array consistent with the type and count of PV ${name}`);
+        return null;
+    }
+    if(native) {
+        return native.getParamInto(name, data);
+    }
+    if(_getParamBuffer(name, data, data.byteLength) < 0) {
+        return null;
+    }
+    return data;
+}
+
+
+// Set a batch of data to the parameter library in a single call, params is an array of { name, value }
+// Update events are posted to monitor clients afterwards if update is true
+function setParams(params, update) {
+    if(!params || !params.length) {
+        console.log('setParams(): parameter list is empty');
+        return 0;
+    }
+
+    // Lay out the values in a packed buffer, each value is aligned to 8 bytes
+    let descriptors = [];
+    let entries = [];
+    let size = 0;
+    for(let param of params) {
+        let info = pvInfoMap.get(param.name);
+        if(!info) {
+            console.log(`setParams(): Unknown PV ${param.name}`);
+            continue;
+        }
+        let data = param.value;
+        if(data === null || data === undefined) {
+            console.log(`setParams(): empty data for PV ${param.name}`);
+            continue;
+        }
+        if(ArrayBuffer.isView(data)) {
+            if(!isTypedArrayOf(info.type, data) || data.byteLength !== getElementSize(info.type) * info.count) {
+                console.log(`setParams(): ${data.constructor.name} of ${data.byteLength} bytes is not consistent with PV ${param.name}`);
+                continue;
+            }
+        } else {
+            if(!Array.isArray(data)) data = [data];
+            if(info.count !== data.length) {
+                console.log(`setParams(): data length ${data.length} is not consistent with PV count ${info.count} for PV ${param.name}`);
+                continue;
+            }
+        }
+        descriptors.push({ name: param.name, offset: size });
+        entries.push({ type: info.type, offset: size, data: data });
+        size += Math.ceil(getElementSize(info.type) * info.count / 8) * 8;
+    }
+    if(!descriptors.length) return 0;
+
+    let buffer = Buffer.alloc(size);
+    for(let entry of entries) {
+        packValue(buffer, entry.offset, entry.type, entry.data);
+    }
+    return _setParams(descriptors, descriptors.length, buffer, update ? 1 : 0);
+}
+
+
 // Set alarm and severity to the parameter library
 function setParamStatus(name, alarm, severity) {
+    if(native) {
+        native.setParamStatus(name, alarm, severity);
+        return;
+    }
     _setParamStatus(name, alarm, severity);
 }
 
 
+// Get the integer handle of a PV, which can be resolved once and used in hot loops
+function getHandle(name) {
+    let handle = _getHandle(name);
+    if(handle < 0) {
+        console.log(`getHandle(): Unknown PV ${name}`);
+    }
+    return handle;
+}
+
+
+// Set scalar data to the parameter library by PV handle
+function setParamDoubleH(handle, value) {
+    _setParamDoubleH(handle, value);
+}
+
+function setParamInt32H(handle, value) {
+    _setParamInt32H(handle, value);
+}
+
+
+// Get scalar data from the parameter library by PV handle
+function getParamDoubleH(handle) {
+    return _getParamDoubleH(handle);
+}
+
+function getParamInt32H(handle) {
+    return _getParamInt32H(handle);
+}
+
+
+// Set alarm and severity to the parameter library by PV handle
+function setParamStatusH(handle, alarm, severity) {
+    _setParamStatusH(handle, alarm, severity);
+}
+
+
+// Typed array views of the slot regions in C++, which are created on first use
+// Region 0 holds int and enum PVs, region 1 float PVs and region 2 double PVs
+let slotRegions = null;
+
+function getSlotRegions() {
+    if(slotRegions) return slotRegions;
+
+    const arrayTypes = [Int32Array, Float32Array, Float64Array];
+    slotRegions = arrayTypes.map((ArrayType, region) => {
+        let info = {};
+        _getSlotInfo(region, info);
+        if(info.count < 1) return { values: null, seqs: null };
+        return {
+            values: new ArrayType(koffi.view(info.values, info.count * info.elementSize)),
+            seqs: new Int32Array(koffi.view(info.seqs, info.count * 4))
+        };
+    });
+    return slotRegions;
+}
+
+
+// Get the value slot of a scalar numeric or enum PV, which is written in place and committed later
+// The slot is { handle, index, values, seqs }, where values[index] is the value of the PV in the region
+function getSlot(name) {
+    let handle = getHandle(name);
+    if(handle < 0) return null;
+
+    let region = [0];
+    let index = _getSlot(handle, region);
+    if(index < 0) {
+        console.log(`getSlot(): PV ${name} has no value slot, only scalar numeric and enum PVs have one`);
+        return null;
+    }
+    let { values, seqs } = getSlotRegions()[region[0]];
+    return { handle, index, values, seqs };
+}
+
+
+// Write a value slot, the sequence counter is odd during the write so a commit never takes a half-written value
+function setSlot(slot, value) {
+    slot.seqs[slot.index]++;
+    slot.values[slot.index] = value;
+    slot.seqs[slot.index]++;
+}
+
+
+// Commit the value slots of the PVs given by handle to the parameter library, and post the changed PVs
+function commit(handles) {
+    if(!handles || !handles.length) return 0;
+    return _commit(handles, handles.length);
+}
+
+
+// Commit every value slot written since the last commit, and post the changed PVs
+function commitAll() {
+    return _commitAll();
+}
+
+
 // Post event to monitor clients
 function updatePVs() {
+    if(native) {
+        native.updatePVs();
+        return;
+    }
     _updatePVs();
 }
 
@@ -540,11 +1331,91 @@ function setDebugLevel(level) {
 }
 
 
+// Set the log level of a PV, or of all PVs matching a name prefix ending with *, -1 follows the debug level
+function setLogLevel(pattern, level) {
+    return _setLogLevel(pattern, level);
+}
+
+
+// Write the log to a file, or to stdout if path is not given
+function setLogOutput(path) {
+    _setLogOutput(path || '');
+}
+
+
+// Get statistics of the scan scheduler
+function getScanStats() {
+    let stats = {};
+    _getScanStats(stats);
+    return stats;
+}
+
+
+// Get counters of name resolution for client searches
+function getSearchStats() {
+    let stats = {};
+    _getSearchStats(stats);
+    return stats;
+}
+
+
+// Get the binding used to call C++, 'napi' when the addon is loaded and 'koffi' otherwise
+function getBinding() {
+    return native ? 'napi' : 'koffi';
+}
+
+
+// Get statistics of the buffer pool used by the parameter library
+function getPoolStats() {
+    let stats = {};
+    _getPoolStats(stats);
+    return stats;
+}
+
+
+// Get counters of posted and coalesced updates of a PV
+function getPostStats(name) {
+    let stats = {};
+    _getPostStats(name, stats);
+    return stats;
+}
+
+
+// Get depth and wait time of the request queue from the server and scan threads to Node.js
+function getRequestStats() {
+    let stats = {};
+    _getRequestStats(stats);
+    return stats;
+}
+
+
 module.exports = {
     createServer,
+    addPVs,
+    removePVs,
     getParam,
+    getParamInto,
     setParam,
+    setParams,
     setParamStatus,
+    getHandle,
+    setParamDoubleH,
+    setParamInt32H,
+    getParamDoubleH,
+    getParamInt32H,
+    setParamStatusH,
+    getSlot,
+    setSlot,
+    commit,
+    commitAll,
     updatePVs,
     setDebugLevel,
+    setLogLevel,
+    setLogOutput,
+    getSearchStats,
+    getScanStats,
+    getPoolStats,
+    getPostStats,
+    getRequestStats,
+    getBinding,
 };
\ No newline at end of file
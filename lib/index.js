@@ -1,11 +1,33 @@
 const { aitEnum } = require('./aitTypes');
 const { Alarm, Severity } = require('./alarm');
 const { createServer } = require('./channel');
+const { addPVs } = require('./channel');
+const { removePVs } = require('./channel');
 const { getParam } = require('./channel');
+const { getParamInto } = require('./channel');
 const { setParam } = require('./channel');
+const { setParams } = require('./channel');
 const { setParamStatus } = require('./channel');
+const { getHandle } = require('./channel');
+const { setParamDoubleH } = require('./channel');
+const { setParamInt32H } = require('./channel');
+const { getParamDoubleH } = require('./channel');
+const { getParamInt32H } = require('./channel');
+const { setParamStatusH } = require('./channel');
+const { getSlot } = require('./channel');
+const { setSlot } = require('./channel');
+const { commit } = require('./channel');
+const { commitAll } = require('./channel');
 const { updatePVs } = require('./channel');
 const { setDebugLevel } = require('./channel');
+const { setLogLevel } = require('./channel');
+const { setLogOutput } = require('./channel');
+const { getSearchStats } = require('./channel');
+const { getScanStats } = require('./channel');
+const { getPoolStats } = require('./channel');
+const { getPostStats } = require('./channel');
+const { getRequestStats } = require('./channel');
+const { getBinding } = require('./channel');
 
 
 module.exports = {
@@ -13,9 +35,31 @@ module.exports = {
     Alarm,
     Severity,
     createServer,
+    addPVs,
+    removePVs,
     getParam,
+    getParamInto,
     setParam,
+    setParams,
     setParamStatus,
+    getHandle,
+    setParamDoubleH,
+    setParamInt32H,
+    getParamDoubleH,
+    getParamInt32H,
+    setParamStatusH,
+    getSlot,
+    setSlot,
+    commit,
+    commitAll,
     updatePVs,
     setDebugLevel,
+    setLogLevel,
+    setLogOutput,
+    getSearchStats,
+    getScanStats,
+    getPoolStats,
+    getPostStats,
+    getRequestStats,
+    getBinding,
 };
\ No newline at end of file
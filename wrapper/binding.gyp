@@ -0,0 +1,98 @@
+{
+    "variables": {
+        "epics_base%": "<!(node -p \"process.env.EPICS_BASE || '../../base-3.15.9'\")"
+    },
+    "target_defaults": {
+        "variables": { "pcas_harness%": 0 },
+        "target_conditions": [
+            [ "pcas_harness==1", {
+                "sources": [ "wrapper.cpp" ],
+                "include_dirs": [ "<(epics_base)/include" ],
+                "cflags_cc!": [ "-fno-exceptions", "-fno-rtti" ],
+                "target_conditions": [
+                    [ "OS=='linux'", {
+                        "include_dirs": [ "<(epics_base)/include/os/Linux", "<(epics_base)/include/compiler/gcc" ],
+                        "libraries": [ "-L<(module_root_dir)/../lib/clibs/linux64", "-lcas", "-lgdd", "-lca", "-lCom" ],
+                        "ldflags": [ "-Wl,-rpath,<(module_root_dir)/../lib/clibs/linux64" ]
+                    } ],
+                    [ "OS=='mac'", {
+                        "include_dirs": [ "<(epics_base)/include/os/Darwin", "<(epics_base)/include/compiler/clang" ],
+                        "libraries": [ "-L<(module_root_dir)/../lib/clibs/darwin64", "-lcas", "-lgdd", "-lca", "-lCom" ],
+                        "xcode_settings": {
+                            "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+                            "GCC_ENABLE_CPP_RTTI": "YES",
+                            "OTHER_LDFLAGS": [ "-Wl,-rpath,<(module_root_dir)/../lib/clibs/darwin64" ]
+                        }
+                    } ],
+                    [ "OS=='win'", { "type": "none", "sources/": [ [ "exclude", "\\.cpp$" ] ] } ]
+                ]
+            } ]
+        ]
+    },
+    "targets": [
+        {
+            "target_name": "pcas",
+            "sources": [ "napi.cpp" ],
+            "defines": [ "NAPI_VERSION=6" ],
+            "include_dirs": [ "<(epics_base)/include" ],
+            "cflags_cc!": [ "-fno-exceptions", "-fno-rtti" ],
+            "conditions": [
+                [ "OS=='linux'", {
+                    "include_dirs": [ "<(epics_base)/include/os/Linux", "<(epics_base)/include/compiler/gcc" ],
+                    "libraries": [ "-L<(module_root_dir)/../lib/clibs/linux64", "-lcas" ],
+                    "ldflags": [ "-Wl,-rpath,'$$ORIGIN'" ]
+                } ],
+                [ "OS=='mac'", {
+                    "include_dirs": [ "<(epics_base)/include/os/Darwin", "<(epics_base)/include/compiler/clang" ],
+                    "libraries": [ "-L<(module_root_dir)/../lib/clibs/darwin64", "-lcas" ],
+                    "xcode_settings": {
+                        "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+                        "GCC_ENABLE_CPP_RTTI": "YES",
+                        "OTHER_LDFLAGS": [ "-Wl,-rpath,@loader_path" ]
+                    }
+                } ],
+                [ "OS=='win'", {
+                    "include_dirs": [ "<(epics_base)/include/os/WIN32", "<(epics_base)/include/compiler/msvc" ],
+                    "libraries": [ "<(epics_base)/lib/windows-x64/cas.lib" ],
+                    "msvs_settings": {
+                        "VCCLCompilerTool": { "ExceptionHandling": 1, "RuntimeTypeInfo": "true" }
+                    }
+                } ]
+            ]
+        },
+        {
+            "target_name": "pcasBench",
+            "type": "executable",
+            "sources": [ "pcasBench.cpp" ],
+            "variables": { "pcas_harness": 1 }
+        },
+        {
+            "target_name": "pcasLoad",
+            "type": "executable",
+            "sources": [ "pcasLoad.cpp" ],
+            "variables": { "pcas_harness": 1 }
+        },
+        {
+            "target_name": "pcasStress",
+            "type": "executable",
+            "sources": [ "pcasStress.cpp" ],
+            "variables": { "pcas_harness": 1 }
+        },
+        {
+            "target_name": "pcasAlloc",
+            "type": "executable",
+            "sources": [ "pcasAlloc.cpp" ],
+            "variables": { "pcas_harness": 1 }
+        },
+        {
+            "target_name": "install",
+            "type": "none",
+            "dependencies": [ "pcas" ],
+            "conditions": [
+                [ "OS=='linux'", { "copies": [ { "files": [ "<(PRODUCT_DIR)/pcas.node" ], "destination": "<(module_root_dir)/../lib/clibs/linux64" } ] } ],
+                [ "OS=='mac'", { "copies": [ { "files": [ "<(PRODUCT_DIR)/pcas.node" ], "destination": "<(module_root_dir)/../lib/clibs/darwin64" } ] } ],
+                [ "OS=='win'", { "copies": [ { "files": [ "<(PRODUCT_DIR)/pcas.node" ], "destination": "<(module_root_dir)/../lib/clibs/win64" } ] } ]
+            ]
+        }
+    ]
+}
@@ -0,0 +1,413 @@
+/**
+ * This is an optional N-API addon which serves the hot path of the PCAS wrapper to Node.js without the dynamic FFI of koffi.
+ * It is built with node-gyp from binding.gyp in this directory and linked against the PCAS shared library containing wrapper.cpp,
+ * lib/channel.js loads it when pcas.node is found next to the shared library and falls back to koffi otherwise
+ */
+
+
+#include <node_api.h>
+#include "wrapper.h"
+
+
+/**
+ * C interfaces of the PCAS shared library used by the addon
+ */
+extern "C" {
+    epicsShareFunc void epicsShareAPI installWakeupCallback(WakeupCallback wakeupCallback, int kinds);
+    epicsShareFunc int epicsShareAPI completeRead(int id, SimpleValue* simpleValue, int alarm, int severity);
+    epicsShareFunc int epicsShareAPI completeWrite(int id, int alarm, int severity);
+    epicsShareFunc void epicsShareAPI updatePVs();
+    epicsShareFunc void epicsShareAPI setParamStatus(const char* name, int alarm, int severity);
+    epicsShareFunc void epicsShareAPI getSimpleValue(const char* name, SimpleValue* simpleValue);
+    epicsShareFunc int epicsShareAPI getParamBuffer(const char* name, void* buffer, int size);
+    epicsShareFunc int epicsShareAPI setParamBuffer(const char* name, void* buffer, int size);
+}
+
+
+/**
+ * Conversion between JS values and value buffers
+ */
+
+// Scratch buffers of the main thread, which are reused so the hot path does not allocate
+static std::vector<char> nameBuffer;
+static std::vector<char> valueBuffer;
+
+static int elementSize(int type) {
+    switch(type) {
+        case aitEnumInt32:
+        case aitEnumEnum16:
+        case aitEnumFloat32:
+            return 4;
+        case aitEnumFloat64:
+            return 8;
+        case aitEnumString:
+            return MAX_STRING_SIZE;
+        default:
+            return 0;
+    }
+}
+
+// Get the PV name argument, NULL is returned and an exception is pending if it is not a string
+static const char * getName(napi_env env, napi_value value) {
+    size_t length;
+    if(napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok) {
+        napi_throw_type_error(env, NULL, "PV name must be a string");
+        return NULL;
+    }
+    nameBuffer.resize(length + 1);
+    napi_get_value_string_utf8(env, value, &nameBuffer[0], length + 1, &length);
+    return &nameBuffer[0];
+}
+
+static bool getArgs(napi_env env, napi_callback_info info, size_t expected, napi_value *argv) {
+    size_t argc = expected;
+    napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+    if(argc < expected) {
+        napi_throw_type_error(env, NULL, "Wrong number of arguments");
+        return false;
+    }
+    return true;
+}
+
+static bool isNullOrUndefined(napi_env env, napi_value value) {
+    napi_valuetype valueType;
+    napi_typeof(env, value, &valueType);
+    return valueType == napi_null || valueType == napi_undefined;
+}
+
+// Get the memory of a typed array or Buffer holding size bytes of a PV type, NULL is returned if value is not one
+static void * getTypedData(napi_env env, napi_value value, int type, int size) {
+    bool isTyped = false;
+    if(napi_is_typedarray(env, value, &isTyped) != napi_ok || !isTyped) return NULL;
+
+    napi_typedarray_type arrayType;
+    size_t length;
+    void *data;
+    napi_get_typedarray_info(env, value, &arrayType, &length, &data, NULL, NULL);
+
+    size_t bytes;
+    switch(arrayType) {
+        case napi_uint8_array:
+            bytes = 1;
+            break;
+        case napi_int32_array:
+            bytes = (type == aitEnumInt32 || type == aitEnumEnum16) ? 4 : 0;
+            break;
+        case napi_float32_array:
+            bytes = type == aitEnumFloat32 ? 4 : 0;
+            break;
+        case napi_float64_array:
+            bytes = type == aitEnumFloat64 ? 8 : 0;
+            break;
+        default:
+            bytes = 0;
+    }
+    if(bytes == 0 || length * bytes != (size_t)size) return NULL;
+    return data;
+}
+
+static bool packElement(napi_env env, napi_value element, int type, char *buffer) {
+    switch(type) {
+        case aitEnumInt32:
+        case aitEnumEnum16: {
+            int32_t value;
+            if(napi_get_value_int32(env, element, &value) != napi_ok) return false;
+            memcpy(buffer, &value, sizeof(value));
+            return true;
+        }
+        case aitEnumFloat32: {
+            double value;
+            if(napi_get_value_double(env, element, &value) != napi_ok) return false;
+            float single = (float)value;
+            memcpy(buffer, &single, sizeof(single));
+            return true;
+        }
+        case aitEnumFloat64: {
+            double value;
+            if(napi_get_value_double(env, element, &value) != napi_ok) return false;
+            memcpy(buffer, &value, sizeof(value));
+            return true;
+        }
+        case aitEnumString: {
+            size_t length;
+            memset(buffer, 0, MAX_STRING_SIZE);
+            return napi_get_value_string_utf8(env, element, buffer, MAX_STRING_SIZE, &length) == napi_ok;
+        }
+        default:
+            return false;
+    }
+}
+
+// Convert a scalar, an array or a typed array into count elements of a PV type, false is returned if they do not match
+static bool packValue(napi_env env, napi_value value, int type, int count, char *buffer) {
+    int size = elementSize(type);
+    void *data = getTypedData(env, value, type, size * count);
+    if(data != NULL) {
+        memcpy(buffer, data, size * count);
+        return true;
+    }
+
+    bool isArray = false;
+    napi_is_array(env, value, &isArray);
+    if(!isArray) {
+        return count == 1 && packElement(env, value, type, buffer);
+    }
+
+    uint32_t length;
+    napi_get_array_length(env, value, &length);
+    if(length != (uint32_t)count) return false;
+    for(uint32_t i = 0; i < length; i++) {
+        napi_value element;
+        napi_get_element(env, value, i, &element);
+        if(!packElement(env, element, type, buffer + i * size)) return false;
+    }
+    return true;
+}
+
+static napi_value unpackElement(napi_env env, int type, const char *buffer) {
+    napi_value result = NULL;
+    switch(type) {
+        case aitEnumInt32:
+        case aitEnumEnum16: {
+            int32_t value;
+            memcpy(&value, buffer, sizeof(value));
+            napi_create_int32(env, value, &result);
+            break;
+        }
+        case aitEnumFloat32: {
+            float value;
+            memcpy(&value, buffer, sizeof(value));
+            napi_create_double(env, value, &result);
+            break;
+        }
+        case aitEnumFloat64: {
+            double value;
+            memcpy(&value, buffer, sizeof(value));
+            napi_create_double(env, value, &result);
+            break;
+        }
+        case aitEnumString:
+            napi_create_string_utf8(env, buffer, strnlen(buffer, MAX_STRING_SIZE), &result);
+            break;
+        default:
+            napi_get_undefined(env, &result);
+    }
+    return result;
+}
+
+// Convert count elements of a PV type into a scalar, or an array if count is more than 1
+static napi_value unpackValue(napi_env env, int type, int count, const char *buffer) {
+    if(count == 1) return unpackElement(env, type, buffer);
+
+    int size = elementSize(type);
+    napi_value array;
+    napi_create_array_with_length(env, count, &array);
+    for(int i = 0; i < count; i++) {
+        napi_set_element(env, array, i, unpackElement(env, type, buffer + i * size));
+    }
+    return array;
+}
+
+
+/**
+ * Wakeup bridge, which schedules draining of the request queue on the Node.js main thread
+ */
+
+static napi_threadsafe_function wakeupBridge = NULL;
+
+// The drain function is the JS function of the thread-safe function, env is NULL when it is torn down
+static void callDrain(napi_env env, napi_value func, void *context, void *data) {
+    if(env == NULL) return;
+
+    napi_value global, result;
+    napi_get_global(env, &global);
+    if(napi_call_function(env, global, func, 0, NULL, &result) == napi_pending_exception) {
+        napi_value error;
+        napi_get_and_clear_last_exception(env, &error);
+        std::cout << "callDrain(): drain function throws an exception" << std::endl;
+    }
+}
+
+// Called from the server and scan threads when requests are queued, the call returns without waiting for the main thread
+static void wakeup() {
+    if(napi_call_threadsafe_function(wakeupBridge, NULL, napi_tsfn_nonblocking) != napi_ok) {
+        std::cout << "wakeup(): drain of the request queue cannot be scheduled" << std::endl;
+    }
+}
+
+
+/**
+ * Functions exported to Node.js
+ */
+
+// setParam(name, data), data is a scalar, an array, or a typed array whose memory is passed without copying
+static napi_value jsSetParam(napi_env env, napi_callback_info info) {
+    napi_value argv[2];
+    if(!getArgs(env, info, 2, argv)) return NULL;
+    const char *name = getName(env, argv[0]);
+    if(name == NULL) return NULL;
+
+    SimpleValue simpleValue;
+    getSimpleValue(name, &simpleValue);
+    if(simpleValue.count < 1) return NULL;
+
+    int size = elementSize(simpleValue.type) * simpleValue.count;
+    void *data = getTypedData(env, argv[1], simpleValue.type, size);
+    if(data == NULL) {
+        valueBuffer.resize(size);
+        if(!packValue(env, argv[1], simpleValue.type, simpleValue.count, &valueBuffer[0])) {
+            std::cout << "setParam(): data is not consistent with the type and count of PV " << name << std::endl;
+            return NULL;
+        }
+        data = &valueBuffer[0];
+    }
+    setParamBuffer(name, data, size);
+    return NULL;
+}
+
+// getParam(name), a scalar or an array is returned
+static napi_value jsGetParam(napi_env env, napi_callback_info info) {
+    napi_value argv[1];
+    if(!getArgs(env, info, 1, argv)) return NULL;
+    const char *name = getName(env, argv[0]);
+    if(name == NULL) return NULL;
+
+    SimpleValue simpleValue;
+    getSimpleValue(name, &simpleValue);
+    if(simpleValue.count < 1) {
+        napi_value result;
+        napi_get_null(env, &result);
+        return result;
+    }
+
+    int size = elementSize(simpleValue.type) * simpleValue.count;
+    valueBuffer.resize(size);
+    getParamBuffer(name, &valueBuffer[0], size);
+    return unpackValue(env, simpleValue.type, simpleValue.count, &valueBuffer[0]);
+}
+
+// getParamInto(name, typedArray), the typed array is filled in place and returned, or null if it does not match the PV
+static napi_value jsGetParamInto(napi_env env, napi_callback_info info) {
+    napi_value argv[2];
+    if(!getArgs(env, info, 2, argv)) return NULL;
+    const char *name = getName(env, argv[0]);
+    if(name == NULL) return NULL;
+
+    SimpleValue simpleValue;
+    getSimpleValue(name, &simpleValue);
+    int size = elementSize(simpleValue.type) * simpleValue.count;
+    void *data = simpleValue.count > 0 ? getTypedData(env, argv[1], simpleValue.type, size) : NULL;
+    if(data == NULL || getParamBuffer(name, data, size) < 0) {
+        napi_value result;
+        napi_get_null(env, &result);
+        return result;
+    }
+    return argv[1];
+}
+
+// setParamStatus(name, alarm, severity)
+static napi_value jsSetParamStatus(napi_env env, napi_callback_info info) {
+    napi_value argv[3];
+    if(!getArgs(env, info, 3, argv)) return NULL;
+    const char *name = getName(env, argv[0]);
+    if(name == NULL) return NULL;
+
+    int alarm, severity;
+    napi_get_value_int32(env, argv[1], &alarm);
+    napi_get_value_int32(env, argv[2], &severity);
+    setParamStatus(name, alarm, severity);
+    return NULL;
+}
+
+// updatePVs()
+static napi_value jsUpdatePVs(napi_env env, napi_callback_info info) {
+    updatePVs();
+    return NULL;
+}
+
+// installWakeupCallback(drain, kinds), drain() is called on the main thread whenever requests of the kinds are queued
+static napi_value jsInstallWakeupCallback(napi_env env, napi_callback_info info) {
+    napi_value argv[2];
+    if(!getArgs(env, info, 2, argv)) return NULL;
+    if(wakeupBridge != NULL) {
+        napi_throw_error(env, NULL, "Wakeup callback is already installed");
+        return NULL;
+    }
+
+    // The thread-safe function does not keep the event loop alive by itself
+    napi_value resourceName;
+    napi_create_string_utf8(env, "pcasWakeup", NAPI_AUTO_LENGTH, &resourceName);
+    if(napi_create_threadsafe_function(env, argv[0], NULL, resourceName, 0, 1, NULL, NULL, NULL, callDrain, &wakeupBridge) != napi_ok) {
+        napi_throw_error(env, NULL, "Cannot create the wakeup bridge");
+        return NULL;
+    }
+    napi_unref_threadsafe_function(env, wakeupBridge);
+
+    int kinds;
+    napi_get_value_int32(env, argv[1], &kinds);
+    installWakeupCallback(wakeup, kinds);
+    return NULL;
+}
+
+// completeRead(id, name, data, alarm, severity), data is null for a failed read
+static napi_value jsCompleteRead(napi_env env, napi_callback_info info) {
+    napi_value argv[5];
+    if(!getArgs(env, info, 5, argv)) return NULL;
+    const char *name = getName(env, argv[1]);
+    if(name == NULL) return NULL;
+
+    int id, alarm, severity;
+    napi_get_value_int32(env, argv[0], &id);
+    napi_get_value_int32(env, argv[3], &alarm);
+    napi_get_value_int32(env, argv[4], &severity);
+
+    int status;
+    SimpleValue simpleValue;
+    getSimpleValue(name, &simpleValue);
+    valueBuffer.resize(elementSize(simpleValue.type) * simpleValue.count);
+    if(isNullOrUndefined(env, argv[2]) || simpleValue.count < 1) {
+        status = completeRead(id, NULL, alarm, severity);
+    } else if(!packValue(env, argv[2], simpleValue.type, simpleValue.count, &valueBuffer[0])) {
+        std::cout << "completeRead(): data is not consistent with the type and count of PV " << name << std::endl;
+        status = completeRead(id, NULL, epicsAlarmRead, epicsSevInvalid);
+    } else {
+        simpleValue.buffer = &valueBuffer[0];
+        status = completeRead(id, &simpleValue, alarm, severity);
+    }
+
+    napi_value result;
+    napi_create_int32(env, status, &result);
+    return result;
+}
+
+// completeWrite(id, alarm, severity)
+static napi_value jsCompleteWrite(napi_env env, napi_callback_info info) {
+    napi_value argv[3];
+    if(!getArgs(env, info, 3, argv)) return NULL;
+
+    int id, alarm, severity;
+    napi_get_value_int32(env, argv[0], &id);
+    napi_get_value_int32(env, argv[1], &alarm);
+    napi_get_value_int32(env, argv[2], &severity);
+
+    napi_value result;
+    napi_create_int32(env, completeWrite(id, alarm, severity), &result);
+    return result;
+}
+
+static napi_value init(napi_env env, napi_value exports) {
+    napi_property_descriptor properties[] = {
+        { "setParam", NULL, jsSetParam, NULL, NULL, NULL, napi_default, NULL },
+        { "getParam", NULL, jsGetParam, NULL, NULL, NULL, napi_default, NULL },
+        { "getParamInto", NULL, jsGetParamInto, NULL, NULL, NULL, napi_default, NULL },
+        { "setParamStatus", NULL, jsSetParamStatus, NULL, NULL, NULL, napi_default, NULL },
+        { "updatePVs", NULL, jsUpdatePVs, NULL, NULL, NULL, napi_default, NULL },
+        { "installWakeupCallback", NULL, jsInstallWakeupCallback, NULL, NULL, NULL, napi_default, NULL },
+        { "completeRead", NULL, jsCompleteRead, NULL, NULL, NULL, napi_default, NULL },
+        { "completeWrite", NULL, jsCompleteWrite, NULL, NULL, NULL, napi_default, NULL },
+    };
+    napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties);
+    return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
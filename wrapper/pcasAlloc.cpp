@@ -0,0 +1,284 @@
+/**
+ * This is a counting-allocator test of the update path of the PCAS wrapper, which checks that a steady-state update
+ * of a numeric or enum PV does not allocate from the heap.
+ * It is built with node-gyp from binding.gyp in this directory, compiling wrapper.cpp of this tree and linking the PCAS libraries in lib/clibs.
+ *
+ * Usage: pcasAlloc [-r rounds] [-w rounds] [-e elements]
+ *
+ *   -r  measured updates of each PV, 10000 by default
+ *   -w  updates of each PV before the measurement, which fill the free lists, 1000 by default
+ *   -e  element count of the array PVs, 1000 by default
+ *
+ * Every PV is monitored, and an update is Driver::setParam() with a changed value followed by Driver::updatePVs(),
+ * which builds the value gdd and posts it up to casPV::postEvent().
+ * The global operator new and delete of this process are replaced to count, which also counts the C++ allocations of
+ * the EPICS libraries, and with glibc malloc() is counted too. Misses of the buffer pool are reported separately.
+ *
+ * Strings are reported but not checked, since aitString copies the string into the heap for every post.
+ * The exit status is 1 if an update of a numeric or enum PV allocated.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+#include <envDefs.h>
+
+#include "wrapper.h"
+
+
+/**
+ * C interfaces and globals of wrapper.cpp used by the test
+ */
+extern "C" {
+    epicsShareFunc void epicsShareAPI createServer(pvDef *pvs, int count);
+    epicsShareFunc void epicsShareAPI createDriver();
+}
+extern SimpleServer *server;
+extern Driver *driver;
+
+
+/**
+ * Counting allocator
+ */
+static size_t newCalls = 0;
+static size_t mallocCalls = 0;
+
+void * operator new(size_t size) {
+    epicsAtomicIncrSizeT(&newCalls);
+    void *ptr = malloc(size > 0 ? size : 1);
+    if(ptr == NULL) throw std::bad_alloc();
+    return ptr;
+}
+
+void * operator new[](size_t size) {
+    epicsAtomicIncrSizeT(&newCalls);
+    void *ptr = malloc(size > 0 ? size : 1);
+    if(ptr == NULL) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) throw() {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) throw() {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) throw() {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) throw() {
+    free(ptr);
+}
+
+// malloc() of the C libraries, operator new above goes through it as well
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void * malloc(size_t size) {
+    epicsAtomicIncrSizeT(&mallocCalls);
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size) {
+    epicsAtomicIncrSizeT(&mallocCalls);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void *ptr, size_t size) {
+    epicsAtomicIncrSizeT(&mallocCalls);
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+
+/**
+ * Cases
+ */
+
+// PV type under test, strings are not expected to be free of allocations
+typedef struct AllocType {
+    const char *name;
+    aitEnum type;
+    int size;
+    bool checked;
+} AllocType;
+
+static const AllocType allocTypes[] = {
+    { "int", aitEnumInt32, sizeof(epicsInt32), true },
+    { "float", aitEnumFloat32, sizeof(epicsFloat32), true },
+    { "double", aitEnumFloat64, sizeof(epicsFloat64), true },
+    { "enum", aitEnumEnum16, sizeof(epicsInt32), true },
+    { "string", aitEnumString, MAX_STRING_SIZE, false }
+};
+#define ALLOC_TYPES 5
+
+static char *enumStrings[] = { (char *)"zero", (char *)"one", NULL };
+static int enumStates[] = { epicsSevNone, epicsSevNone, -1 };
+static char *noStrings[] = { NULL };
+static int noStates[] = { -1 };
+
+// PV of one case with two buffers of different values, which the updates alternate between
+typedef struct AllocCase {
+    const AllocType *type;
+    PVEntry *entry;
+    int elements;
+    std::vector<char> buffers[2];
+} AllocCase;
+
+// Fill a buffer with elements of a type, the value of the first element is 0 or 1
+static void fillBuffer(AllocCase *test, int which) {
+    int size = test->type->size;
+    test->buffers[which].assign((size_t)size * test->elements, 0);
+    char *buffer = &test->buffers[which][0];
+    epicsInt32 int32 = which;
+    epicsFloat32 float32 = (epicsFloat32)which;
+    epicsFloat64 float64 = which;
+    switch(test->type->type) {
+        case aitEnumInt32:
+        case aitEnumEnum16:
+            memcpy(buffer, &int32, sizeof(int32));
+            break;
+        case aitEnumFloat32:
+            memcpy(buffer, &float32, sizeof(float32));
+            break;
+        case aitEnumFloat64:
+            memcpy(buffer, &float64, sizeof(float64));
+            break;
+        case aitEnumString:
+            snprintf(buffer, MAX_STRING_SIZE, "value %d", which);
+            break;
+        default:
+            break;
+    }
+}
+
+static void update(AllocCase *test, int round) {
+    driver->setParam(test->entry, &test->buffers[round & 1][0]);
+    driver->updatePVs();
+}
+
+// Heap allocations and pool misses of the measured updates of a case
+typedef struct AllocResult {
+    size_t news;
+    size_t mallocs;
+    epicsUInt64 poolMisses;
+} AllocResult;
+
+static AllocResult runCase(AllocCase *test, int warmup, int rounds) {
+    for(int round = 0; round < warmup; round++) {
+        update(test, round);
+    }
+
+    PoolStats before, after;
+    BufferPool::getStats(&before);
+    size_t news = epicsAtomicGetSizeT(&newCalls);
+    size_t mallocs = epicsAtomicGetSizeT(&mallocCalls);
+    for(int round = 0; round < rounds; round++) {
+        update(test, warmup + round);
+    }
+    AllocResult result;
+    result.news = epicsAtomicGetSizeT(&newCalls) - news;
+    result.mallocs = epicsAtomicGetSizeT(&mallocCalls) - mallocs;
+    BufferPool::getStats(&after);
+    result.poolMisses = after.misses - before.misses;
+    return result;
+}
+
+
+/**
+ * Main
+ */
+int main(int argc, char *argv[]) {
+    int rounds = 10000;
+    int warmup = 1000;
+    int elements = 1000;
+
+    int opt;
+    while((opt = getopt(argc, argv, "r:w:e:")) != -1) {
+        switch(opt) {
+            case 'r': rounds = atoi(optarg); break;
+            case 'w': warmup = atoi(optarg); break;
+            case 'e': elements = atoi(optarg); break;
+            default:
+                std::cout << "Usage: pcasAlloc [-r rounds] [-w rounds] [-e elements]" << std::endl;
+                return 1;
+        }
+    }
+    if(rounds < 1 || warmup < 1 || elements < 2) {
+        std::cout << "pcasAlloc: rounds and warmup must be positive, and arrays have at least 2 elements" << std::endl;
+        return 1;
+    }
+
+    // Keep the server off the network
+    if(getenv("EPICS_CAS_INTF_ADDR_LIST") == NULL) {
+        epicsEnvSet("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1");
+    }
+
+    // One scalar alloc:<type> and one array alloc:<type>:wf of every type
+    std::vector<AllocCase *> cases;
+    std::vector<std::string> names;
+    for(int i = 0; i < ALLOC_TYPES; i++) {
+        for(int array = 0; array < 2; array++) {
+            AllocCase *test = new AllocCase();
+            test->type = &allocTypes[i];
+            test->entry = NULL;
+            test->elements = array ? elements : 1;
+            fillBuffer(test, 0);
+            fillBuffer(test, 1);
+            cases.push_back(test);
+
+            char name[64];
+            snprintf(name, sizeof(name), array ? "alloc:%s:wf" : "alloc:%s", allocTypes[i].name);
+            names.push_back(name);
+        }
+    }
+
+    std::vector<pvDef> defs(cases.size());
+    for(size_t i = 0; i < cases.size(); i++) {
+        AllocCase *test = cases[i];
+        pvDef *def = &defs[i];
+        memset(def, 0, sizeof(pvDef));
+        def->name = (char *)names[i].c_str();
+        def->type = test->type->type;
+        def->count = test->elements;
+        def->enums = test->type->type == aitEnumEnum16 ? enumStrings : noStrings;
+        def->states = test->type->type == aitEnumEnum16 ? enumStates : noStates;
+        def->unit = (char *)"";
+        def->soft = true;
+        def->deadband = deadbandAbsolute;
+        def->value = &test->buffers[0][0];
+    }
+    createServer(&defs[0], (int)defs.size());
+    createDriver();
+
+    PVRegistry &registry = server->getRegistry();
+    for(size_t i = 0; i < cases.size(); i++) {
+        cases[i]->entry = registry.get(names[i].c_str());
+        cases[i]->entry->pv->interestRegister();
+    }
+
+    printf("%-16s %10s %12s %12s %12s\n", "pv", "elements", "new/update", "malloc/update", "misses");
+    bool ok = true;
+    for(size_t i = 0; i < cases.size(); i++) {
+        AllocCase *test = cases[i];
+        AllocResult result = runCase(test, warmup, rounds);
+        bool allocated = result.news > 0 || result.mallocs > 0 || result.poolMisses > 0;
+        printf("%-16s %10d %12.3f %12.3f %12llu%s\n", names[i].c_str(), test->elements,
+            (double)result.news / rounds, (double)result.mallocs / rounds, (unsigned long long)result.poolMisses,
+            !test->type->checked ? "  (not checked)" : allocated ? "  FAIL" : "");
+        if(test->type->checked && allocated) {
+            ok = false;
+        }
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,478 @@
+/**
+ * This is a benchmark of the parameter library and the posting path of the PCAS wrapper.
+ * It is built with node-gyp from binding.gyp in this directory, compiling wrapper.cpp of this tree and linking the PCAS libraries in lib/clibs.
+ *
+ * Usage: pcasBench [-o file] [-t seconds] [-p counts] [-e counts] [-y types]
+ *
+ *   -o  JSON file the results are written to, pcasBench.json by default
+ *   -t  minimum time in seconds each case runs, 0.5 by default
+ *   -p  comma separated numbers of scalar PVs, 1000,10000,100000 by default
+ *   -e  comma separated element counts of array PVs, 1,10,100,1000,10000,100000,1000000 by default
+ *   -y  comma separated PV types, int,float,double,string,enum by default
+ *
+ * Each PV type runs in its own child process, since only one server can be created per process.
+ * The cases are
+ *
+ *   setParam    Driver::setParam() with a changed value, including the alarm and deadband evaluation
+ *   checkValue  PVInfo::checkValue() and PVInfo::checkAlarm() alone
+ *   gdd         construction of the value gdd of a post from a copy of the value
+ *   post        Driver::setParam() and Driver::updatePVs() of monitored PVs up to casPV::postEvent()
+ *
+ * No client is connected, so the post case stops where the server library queues the event for the monitors.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <envDefs.h>
+
+#include "wrapper.h"
+
+
+/**
+ * C interfaces and globals of wrapper.cpp used by the benchmark
+ */
+extern "C" {
+    epicsShareFunc void epicsShareAPI createServer(pvDef *pvs, int count);
+    epicsShareFunc void epicsShareAPI createDriver();
+}
+extern SimpleServer *server;
+extern Driver *driver;
+
+
+/**
+ * Benchmark cases
+ */
+
+// PV type under test
+typedef struct BenchType {
+    const char *name;
+    aitEnum type;
+    int size;
+} BenchType;
+
+static const BenchType benchTypes[] = {
+    { "int", aitEnumInt32, sizeof(epicsInt32) },
+    { "float", aitEnumFloat32, sizeof(epicsFloat32) },
+    { "double", aitEnumFloat64, sizeof(epicsFloat64) },
+    { "string", aitEnumString, MAX_STRING_SIZE },
+    { "enum", aitEnumEnum16, sizeof(epicsInt32) }
+};
+#define BENCH_TYPES 5
+
+// States of enum PVs
+static char *enumStrings[] = { (char *)"zero", (char *)"one", (char *)"two", (char *)"three", NULL };
+static int enumStates[] = { epicsSevNone, epicsSevNone, epicsSevMinor, epicsSevMajor, -1 };
+static char *noStrings[] = { NULL };
+static int noStates[] = { -1 };
+#define ENUM_STATES 4
+
+// PVs of one case, arrays alternate between two buffers which differ in the last element only,
+// so change detection has to look at the whole array on every update
+typedef struct BenchCase {
+    const BenchType *type;
+    std::vector<PVEntry *> entries;
+    int elements;
+    std::vector<char> buffers[2];
+    Value values[2];
+} BenchCase;
+
+// One round over all PVs of a case
+typedef void (*BenchOp)(BenchCase *bench, int round);
+
+// Result of one case, which is passed from the child to the parent as one line of JSON
+typedef struct BenchResult {
+    std::string name;
+    std::string type;
+    int pvs;
+    int elements;
+    double ops;
+    double seconds;
+    double bytes;
+} BenchResult;
+
+// Write a scalar of a PV type, the values cycle through the alarm limits of the benchmark PVs
+static void fillScalar(aitEnum type, char *buffer, int value) {
+    epicsInt32 int32 = value % 100;
+    epicsFloat32 float32 = (epicsFloat32)(value % 100);
+    epicsFloat64 float64 = value % 100;
+    switch(type) {
+        case aitEnumInt32:
+            memcpy(buffer, &int32, sizeof(int32));
+            break;
+        case aitEnumFloat32:
+            memcpy(buffer, &float32, sizeof(float32));
+            break;
+        case aitEnumFloat64:
+            memcpy(buffer, &float64, sizeof(float64));
+            break;
+        case aitEnumString:
+            memset(buffer, 0, MAX_STRING_SIZE);
+            snprintf(buffer, MAX_STRING_SIZE, "value %d", value);
+            break;
+        case aitEnumEnum16:
+            int32 = value % ENUM_STATES;
+            memcpy(buffer, &int32, sizeof(int32));
+            break;
+        default:
+            break;
+    }
+}
+
+// Point the values of a case at its buffers, and fill them with a ramp whose last element differs
+static void prepareBuffers(BenchCase *bench) {
+    int size = bench->type->size;
+    for(int b = 0; b < 2; b++) {
+        bench->buffers[b].resize((size_t)size * bench->elements);
+        for(int i = 0; i < bench->elements; i++) {
+            fillScalar(bench->type->type, &bench->buffers[b][(size_t)i * size], i);
+        }
+        bench->values[b].setType(bench->type->type);
+        bench->values[b].setCount(bench->elements);
+        bench->values[b].setBuffer(&bench->buffers[b][0]);
+    }
+    fillScalar(bench->type->type, &bench->buffers[1][(size_t)(bench->elements - 1) * size], bench->elements + 50);
+}
+
+// Scalars get a fresh value per PV and round, arrays alternate between the two buffers
+static Value * nextValue(BenchCase *bench, int round, int index) {
+    if(bench->elements > 1) {
+        return &bench->values[round & 1];
+    }
+    fillScalar(bench->type->type, &bench->buffers[0][0], round + index);
+    return &bench->values[0];
+}
+
+static void opSetParam(BenchCase *bench, int round) {
+    for(size_t i = 0; i < bench->entries.size(); i++) {
+        driver->setParam(bench->entries[i], nextValue(bench, round, (int)i)->getBuffer());
+    }
+}
+
+static void opCheckValue(BenchCase *bench, int round) {
+    epicsAlarmCondition alarm;
+    epicsAlarmSeverity severity;
+    for(size_t i = 0; i < bench->entries.size(); i++) {
+        PVInfo *info = bench->entries[i]->info;
+        Value *value = nextValue(bench, round, (int)i);
+        info->checkValue(value);
+        info->checkAlarm(value, &alarm, &severity);
+    }
+}
+
+// Build the value gdd as SimplePV::updateValue() does, the gdd takes the copy of the value
+static void opGdd(BenchCase *bench, int round) {
+    epicsTimeStamp time;
+    epicsTimeGetCurrent(&time);
+    for(size_t i = 0; i < bench->entries.size(); i++) {
+        PVEntry *entry = bench->entries[i];
+        Value *value = new Value(*nextValue(bench, round, (int)i));
+        gdd *gddValue = new gdd(gddAppType_value, bench->type->type);
+        if(bench->elements > 1) {
+            gddValue->setDimension(1);
+            gddValue->setBound(0, 0, bench->elements);
+        }
+        entry->pv->putValueToGDD(gddValue, value);
+        gddValue->setTimeStamp(&time);
+        gddValue->setStatSevr(epicsAlarmNone, epicsSevNone);
+        gddValue->unreference();
+    }
+}
+
+static void opPost(BenchCase *bench, int round) {
+    for(size_t i = 0; i < bench->entries.size(); i++) {
+        driver->setParam(bench->entries[i], nextValue(bench, round, (int)i)->getBuffer());
+    }
+    driver->updatePVs();
+}
+
+// Run rounds of a case until the minimum time has passed
+static BenchResult runCase(const char *name, BenchCase *bench, BenchOp op, double minTime) {
+    // One round to warm up caches and the buffer pool
+    op(bench, 0);
+
+    int rounds = 0;
+    double elapsed = 0;
+    epicsTime start = epicsTime::getCurrent();
+    while(elapsed < minTime) {
+        op(bench, ++rounds);
+        elapsed = epicsTime::getCurrent() - start;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.type = bench->type->name;
+    result.pvs = (int)bench->entries.size();
+    result.elements = bench->elements;
+    result.ops = (double)rounds * bench->entries.size();
+    result.seconds = elapsed;
+    result.bytes = (double)bench->type->size * bench->elements;
+    return result;
+}
+
+static void writeResult(FILE *out, const BenchResult &result) {
+    fprintf(out, "{ \"name\": \"%s\", \"type\": \"%s\", \"pvs\": %d, \"elements\": %d, \"ops\": %.0f, \"seconds\": %.6f, "
+        "\"opsPerSec\": %.1f, \"nsPerOp\": %.1f, \"bytesPerSec\": %.1f }",
+        result.name.c_str(), result.type.c_str(), result.pvs, result.elements, result.ops, result.seconds,
+        result.ops / result.seconds, result.seconds * 1e9 / result.ops, result.ops * result.bytes / result.seconds);
+}
+
+// Run every case of one PV type in this process, the results are written to out one line each
+static void runType(const BenchType *type, std::vector<int> &pvCounts, std::vector<int> &elementCounts, double minTime, FILE *out) {
+    int maxPVs = 1;
+    for(size_t i = 0; i < pvCounts.size(); i++) {
+        if(pvCounts[i] > maxPVs) maxPVs = pvCounts[i];
+    }
+
+    // Scalars bench:<type>:<index> and one array bench:<type>:wf<count> per element count
+    std::vector<std::string> names;
+    std::vector<std::vector<char> > initial;
+    for(int i = 0; i < maxPVs; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "bench:%s:%d", type->name, i);
+        names.push_back(name);
+        initial.push_back(std::vector<char>(type->size));
+    }
+    for(size_t i = 0; i < elementCounts.size(); i++) {
+        if(elementCounts[i] <= 1) continue;
+        char name[64];
+        snprintf(name, sizeof(name), "bench:%s:wf%d", type->name, elementCounts[i]);
+        names.push_back(name);
+        initial.push_back(std::vector<char>((size_t)type->size * elementCounts[i]));
+    }
+
+    std::vector<pvDef> defs(names.size());
+    for(size_t i = 0; i < names.size(); i++) {
+        pvDef *def = &defs[i];
+        memset(def, 0, sizeof(pvDef));
+        def->name = (char *)names[i].c_str();
+        def->type = type->type;
+        def->count = (int)(initial[i].size() / type->size);
+        def->enums = type->type == aitEnumEnum16 ? enumStrings : noStrings;
+        def->states = type->type == aitEnumEnum16 ? enumStates : noStates;
+        def->unit = (char *)"";
+        def->hilim = 100;
+        def->high = 80;
+        def->low = 20;
+        def->hihi = 90;
+        def->lolo = 10;
+        def->mdel = 0.5;
+        def->adel = 1;
+        def->soft = true;
+        def->deadband = deadbandAbsolute;
+        def->value = &initial[i][0];
+    }
+    createServer(&defs[0], (int)defs.size());
+    createDriver();
+    PVRegistry &registry = server->getRegistry();
+
+    const char *caseNames[] = { "setParam", "checkValue", "gdd", "post" };
+    BenchOp caseOps[] = { opSetParam, opCheckValue, opGdd, opPost };
+
+    // Scalars against the number of PVs, then arrays against the element count
+    std::vector<BenchCase *> cases;
+    for(size_t i = 0; i < pvCounts.size(); i++) {
+        BenchCase *bench = new BenchCase();
+        bench->type = type;
+        bench->elements = 1;
+        for(int j = 0; j < pvCounts[i]; j++) {
+            bench->entries.push_back(registry.get(names[j].c_str()));
+        }
+        cases.push_back(bench);
+    }
+    for(size_t i = 0; i < elementCounts.size(); i++) {
+        BenchCase *bench = new BenchCase();
+        char name[64];
+        bench->type = type;
+        bench->elements = elementCounts[i];
+        if(elementCounts[i] > 1) {
+            snprintf(name, sizeof(name), "bench:%s:wf%d", type->name, elementCounts[i]);
+        } else {
+            snprintf(name, sizeof(name), "bench:%s:0", type->name);
+        }
+        bench->entries.push_back(registry.get(name));
+        cases.push_back(bench);
+    }
+
+    for(size_t i = 0; i < cases.size(); i++) {
+        BenchCase *bench = cases[i];
+        prepareBuffers(bench);
+        for(int c = 0; c < 4; c++) {
+            // Monitored PVs are posted, others are dropped at the first check of SimplePV::updateValue()
+            bool post = caseOps[c] == opPost;
+            for(size_t j = 0; post && j < bench->entries.size(); j++) {
+                bench->entries[j]->pv->interestRegister();
+            }
+            BenchResult result = runCase(caseNames[c], bench, caseOps[c], minTime);
+            for(size_t j = 0; post && j < bench->entries.size(); j++) {
+                bench->entries[j]->pv->interestDelete();
+            }
+            writeResult(out, result);
+            fprintf(out, "\n");
+            fflush(out);
+        }
+        delete bench;
+    }
+}
+
+
+/**
+ * Parent process
+ */
+
+static bool parseList(const char *arg, std::vector<int> &list) {
+    list.clear();
+    const char *ptr = arg;
+    while(*ptr) {
+        char *end;
+        long value = strtol(ptr, &end, 10);
+        if(end == ptr || value < 1) return false;
+        list.push_back((int)value);
+        ptr = *end == ',' ? end + 1 : end;
+    }
+    return !list.empty();
+}
+
+static bool parseTypes(const char *arg, std::vector<const BenchType *> &types) {
+    types.clear();
+    std::string list = arg;
+    size_t start = 0;
+    while(start <= list.size()) {
+        size_t end = list.find(',', start);
+        if(end == std::string::npos) end = list.size();
+        std::string name = list.substr(start, end - start);
+        const BenchType *type = NULL;
+        for(int i = 0; i < BENCH_TYPES; i++) {
+            if(name == benchTypes[i].name) type = &benchTypes[i];
+        }
+        if(type == NULL) return false;
+        types.push_back(type);
+        start = end + 1;
+    }
+    return !types.empty();
+}
+
+// Run one child per type, and collect the lines of JSON it writes to the pipe
+static bool runChild(const BenchType *type, std::vector<int> &pvCounts, std::vector<int> &elementCounts, double minTime, std::vector<std::string> &lines) {
+    fflush(stdout);
+    int fds[2];
+    if(pipe(fds) != 0) {
+        perror("pcasBench: pipe");
+        return false;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0) {
+        perror("pcasBench: fork");
+        return false;
+    }
+    if(pid == 0) {
+        close(fds[0]);
+        FILE *out = fdopen(fds[1], "w");
+        runType(type, pvCounts, elementCounts, minTime, out);
+        fclose(out);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    FILE *in = fdopen(fds[0], "r");
+    char line[1024];
+    while(fgets(line, sizeof(line), in) != NULL) {
+        std::string result = line;
+        while(!result.empty() && result[result.size() - 1] == '\n') {
+            result.erase(result.size() - 1);
+        }
+        lines.push_back(result);
+
+        // Print the line as a row of the table
+        char name[32], typeName[32];
+        int pvs, elements;
+        double ops, seconds, opsPerSec, nsPerOp, bytesPerSec;
+        if(sscanf(line, "{ \"name\": \"%31[^\"]\", \"type\": \"%31[^\"]\", \"pvs\": %d, \"elements\": %d, \"ops\": %lf, \"seconds\": %lf, "
+            "\"opsPerSec\": %lf, \"nsPerOp\": %lf, \"bytesPerSec\": %lf", name, typeName, &pvs, &elements, &ops, &seconds, &opsPerSec, &nsPerOp, &bytesPerSec) == 9) {
+            printf("%-12s %-8s %10d %10d %14.0f %12.1f %12.1f\n", name, typeName, pvs, elements, opsPerSec, nsPerOp, bytesPerSec / 1e6);
+            fflush(stdout);
+        }
+    }
+    fclose(in);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cout << "pcasBench: benchmark of type " << type->name << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = "pcasBench.json";
+    double minTime = 0.5;
+    std::vector<int> pvCounts;
+    std::vector<int> elementCounts;
+    std::vector<const BenchType *> types;
+    parseList("1000,10000,100000", pvCounts);
+    parseList("1,10,100,1000,10000,100000,1000000", elementCounts);
+    parseTypes("int,float,double,string,enum", types);
+
+    int opt;
+    while((opt = getopt(argc, argv, "o:t:p:e:y:")) != -1) {
+        bool valid = true;
+        switch(opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 't':
+                minTime = atof(optarg);
+                valid = minTime > 0;
+                break;
+            case 'p':
+                valid = parseList(optarg, pvCounts);
+                break;
+            case 'e':
+                valid = parseList(optarg, elementCounts);
+                break;
+            case 'y':
+                valid = parseTypes(optarg, types);
+                break;
+            default:
+                valid = false;
+                break;
+        }
+        if(!valid) {
+            std::cout << "Usage: pcasBench [-o file] [-t seconds] [-p counts] [-e counts] [-y types]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Keep the server of each child off the network
+    if(getenv("EPICS_CAS_INTF_ADDR_LIST") == NULL) {
+        epicsEnvSet("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1");
+    }
+
+    printf("%-12s %-8s %10s %10s %14s %12s %12s\n", "case", "type", "pvs", "elements", "ops/s", "ns/op", "MB/s");
+    std::vector<std::string> lines;
+    bool ok = true;
+    for(size_t i = 0; i < types.size(); i++) {
+        ok = runChild(types[i], pvCounts, elementCounts, minTime, lines) && ok;
+    }
+
+    FILE *out = fopen(output, "w");
+    if(out == NULL) {
+        perror("pcasBench: cannot open the output file");
+        return 1;
+    }
+    char time[64];
+    epicsTime::getCurrent().strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%S");
+    fprintf(out, "{\n  \"benchmark\": \"pcasBench\",\n  \"time\": \"%s\",\n  \"minTime\": %g,\n  \"results\": [\n", time, minTime);
+    for(size_t i = 0; i < lines.size(); i++) {
+        fprintf(out, "    %s%s\n", lines[i].c_str(), i + 1 < lines.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    fclose(out);
+
+    return ok ? 0 : 1;
+}
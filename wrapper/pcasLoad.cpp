@@ -0,0 +1,370 @@
+/**
+ * This is a load generator for a PCAS server over loopback, which measures how many monitors and updates a server sustains.
+ * It is built with node-gyp from binding.gyp in this directory, linking the Channel Access client library in lib/clibs.
+ *
+ * Usage: pcasLoad [-n prefix] [-c channels] [-m monitors] [-d seconds] [-w seconds] [-g rate] [-e elements] [-o file]
+ *
+ *   -n  prefix of the PV names, the channels are <prefix>0 to <prefix>N-1, load:pv by default
+ *   -c  number of channels, 1000 by default
+ *   -m  number of monitors of each channel, 1 by default
+ *   -d  measured time in seconds, 10 by default
+ *   -w  warmup time in seconds before the measurement, 1 by default
+ *   -g  run the server in this process and update every PV at this rate in Hz, the server is external by default
+ *   -e  element count of the PVs of the native generator, 1 by default
+ *   -o  JSON file the results are written to
+ *
+ * The value of every update is a sequence number of its PV, a gap in the sequence seen by a monitor is counted as coalesced.
+ * The latency is the time from the timestamp of the update, which is set by setParam(), to the arrival at the client.
+ * benchmarks/load.js starts a server from createServer(), drives it with setParams() and updatePVs(), and runs this tool against it.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <envDefs.h>
+#include <cadef.h>
+
+#include "wrapper.h"
+
+
+/**
+ * C interfaces of wrapper.cpp used by the native generator
+ */
+extern "C" {
+    epicsShareFunc void epicsShareAPI createServer(pvDef *pvs, int count);
+    epicsShareFunc void epicsShareAPI createDriver();
+    epicsShareFunc void epicsShareAPI serverProcess(double delay);
+    epicsShareFunc void epicsShareAPI updatePVs();
+    epicsShareFunc int epicsShareAPI getHandle(const char* name);
+    epicsShareFunc void epicsShareAPI setParamDoubleH(int handle, double value);
+    epicsShareFunc int epicsShareAPI setParamBuffer(const char* name, void* buffer, int size);
+}
+
+
+/**
+ * Latency histogram
+ * Values are recorded in microseconds into 64 linear sub-buckets per power of two, so percentiles are within 1.6 percent
+ */
+#define HISTOGRAM_SUB_BITS 6
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * 40)
+
+typedef struct Histogram {
+    epicsUInt64 counts[HISTOGRAM_BUCKETS];
+    epicsUInt64 total;
+    double max;
+} Histogram;
+
+static int bucketOf(epicsUInt64 micros) {
+    if(micros < HISTOGRAM_SUB_BUCKETS) return (int)micros;
+
+    int shift = 0;
+    while((micros >> shift) >= 2 * HISTOGRAM_SUB_BUCKETS) shift++;
+    int index = (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((micros >> shift) - HISTOGRAM_SUB_BUCKETS);
+    return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+}
+
+// Lowest value of a bucket in microseconds
+static double valueOf(int index) {
+    if(index < HISTOGRAM_SUB_BUCKETS) return index;
+
+    int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    return (double)((epicsUInt64)(index % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS) << shift);
+}
+
+static void record(Histogram *histogram, double seconds) {
+    double micros = seconds > 0 ? seconds * 1e6 : 0;
+    histogram->counts[bucketOf((epicsUInt64)micros)]++;
+    histogram->total++;
+    if(micros > histogram->max) {
+        histogram->max = micros;
+    }
+}
+
+static double percentile(Histogram *histogram, double fraction) {
+    if(histogram->total == 0) return 0;
+
+    epicsUInt64 rank = (epicsUInt64)(fraction * histogram->total);
+    epicsUInt64 seen = 0;
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if(seen > rank) return valueOf(i);
+    }
+    return histogram->max;
+}
+
+
+/**
+ * Monitors
+ */
+
+// State of one monitor, the first event of a subscription only sets the sequence
+typedef struct Monitor {
+    chid channel;
+    evid subscription;
+    bool started;
+    double last;
+} Monitor;
+
+// Counters of the client, callbacks run in the main thread from ca_pend_event()
+typedef struct LoadStats {
+    bool measuring;
+    epicsUInt64 events;
+    epicsUInt64 coalesced;
+    Histogram latency;
+} LoadStats;
+
+static LoadStats stats;
+
+static void monitorCallback(struct event_handler_args args) {
+    if(args.status != ECA_NORMAL || args.dbr == NULL) return;
+
+    Monitor *monitor = (Monitor *)args.usr;
+    const struct dbr_time_double *value = (const struct dbr_time_double *)args.dbr;
+    epicsTime now = epicsTime::getCurrent();
+
+    double seq = value->value;
+    if(!monitor->started) {
+        monitor->started = true;
+        monitor->last = seq;
+        return;
+    }
+    if(!stats.measuring) {
+        monitor->last = seq;
+        return;
+    }
+
+    stats.events++;
+    if(seq > monitor->last + 1) {
+        stats.coalesced += (epicsUInt64)(seq - monitor->last - 1);
+    }
+    if(seq > monitor->last) {
+        monitor->last = seq;
+    }
+    record(&stats.latency, now - epicsTime(value->stamp));
+}
+
+
+/**
+ * Native generator, which serves the PVs from this process and updates all of them at a fixed rate
+ */
+typedef struct Generator {
+    std::vector<std::string> names;
+    std::vector<int> handles;
+    int elements;
+    double rate;
+    epicsUInt64 updates;
+    bool running;
+} Generator;
+
+static Generator generator;
+
+static void startServer(Generator *gen) {
+    std::vector<pvDef> defs(gen->names.size());
+    std::vector<double> initial(gen->elements, 0);
+    static char *noStrings[] = { NULL };
+    static int noStates[] = { -1 };
+    for(size_t i = 0; i < gen->names.size(); i++) {
+        pvDef *def = &defs[i];
+        memset(def, 0, sizeof(pvDef));
+        def->name = (char *)gen->names[i].c_str();
+        def->type = aitEnumFloat64;
+        def->count = gen->elements;
+        def->enums = noStrings;
+        def->states = noStates;
+        def->unit = (char *)"";
+        def->soft = true;
+        def->deadband = deadbandAbsolute;
+        def->value = &initial[0];
+    }
+    createServer(&defs[0], (int)defs.size());
+    createDriver();
+    serverProcess(0.2);
+
+    for(size_t i = 0; i < gen->names.size(); i++) {
+        gen->handles.push_back(getHandle(gen->names[i].c_str()));
+    }
+}
+
+static void generatorThread(void *arg) {
+    Generator *gen = (Generator *)arg;
+    double period = 1 / gen->rate;
+    std::vector<double> buffer(gen->elements, 0);
+    epicsTime next = epicsTime::getCurrent();
+    double seq = 0;
+
+    while(gen->running) {
+        seq++;
+        for(size_t i = 0; i < gen->names.size(); i++) {
+            if(gen->elements == 1) {
+                setParamDoubleH(gen->handles[i], seq);
+            } else {
+                buffer[0] = seq;
+                setParamBuffer(gen->names[i].c_str(), &buffer[0], (int)(buffer.size() * sizeof(double)));
+            }
+        }
+        updatePVs();
+        gen->updates += gen->names.size();
+
+        // Ticks that are already late are not made up, the rate then drops below the requested one
+        next += period;
+        double wait = next - epicsTime::getCurrent();
+        if(wait > 0) {
+            epicsThreadSleep(wait);
+        } else {
+            next = epicsTime::getCurrent();
+        }
+    }
+}
+
+
+/**
+ * Main
+ */
+
+static void setDefaultEnv(const char *name, const char *value) {
+    if(getenv(name) == NULL) {
+        epicsEnvSet(name, value);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *prefix = "load:pv";
+    const char *output = NULL;
+    int channels = 1000;
+    int monitors = 1;
+    double duration = 10;
+    double warmup = 1;
+    double rate = 0;
+    int elements = 1;
+
+    int opt;
+    while((opt = getopt(argc, argv, "n:c:m:d:w:g:e:o:")) != -1) {
+        switch(opt) {
+            case 'n': prefix = optarg; break;
+            case 'c': channels = atoi(optarg); break;
+            case 'm': monitors = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'w': warmup = atof(optarg); break;
+            case 'g': rate = atof(optarg); break;
+            case 'e': elements = atoi(optarg); break;
+            case 'o': output = optarg; break;
+            default:
+                std::cout << "Usage: pcasLoad [-n prefix] [-c channels] [-m monitors] [-d seconds] [-w seconds] [-g rate] [-e elements] [-o file]" << std::endl;
+                return 1;
+        }
+    }
+    if(channels < 1 || monitors < 1 || duration <= 0 || warmup < 0 || rate < 0 || elements < 1) {
+        std::cout << "pcasLoad: channels, monitors, duration and elements must be positive" << std::endl;
+        return 1;
+    }
+
+    // Client and server only talk over loopback, and arrays of the native generator fit into one message
+    char maxArrayBytes[32];
+    snprintf(maxArrayBytes, sizeof(maxArrayBytes), "%d", elements * (int)sizeof(double) + 1024);
+    setDefaultEnv("EPICS_CA_AUTO_ADDR_LIST", "NO");
+    setDefaultEnv("EPICS_CA_ADDR_LIST", "127.0.0.1");
+    setDefaultEnv("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1");
+    setDefaultEnv("EPICS_CA_MAX_ARRAY_BYTES", maxArrayBytes);
+
+    std::vector<std::string> names;
+    for(int i = 0; i < channels; i++) {
+        char name[128];
+        snprintf(name, sizeof(name), "%s%d", prefix, i);
+        names.push_back(name);
+    }
+
+    if(rate > 0) {
+        generator.names = names;
+        generator.elements = elements;
+        generator.rate = rate;
+        generator.updates = 0;
+        generator.running = true;
+        startServer(&generator);
+    }
+
+    ca_context_create(ca_disable_preemptive_callback);
+
+    std::vector<chid> chids(channels);
+    for(int i = 0; i < channels; i++) {
+        ca_create_channel(names[i].c_str(), NULL, NULL, CA_PRIORITY_DEFAULT, &chids[i]);
+    }
+    ca_pend_io(10);
+
+    int connected = 0;
+    for(int i = 0; i < channels; i++) {
+        if(ca_state(chids[i]) == cs_conn) connected++;
+    }
+    if(connected < channels) {
+        std::cout << "pcasLoad: only " << connected << " of " << channels << " channels connected" << std::endl;
+        ca_context_destroy();
+        return 1;
+    }
+
+    std::vector<Monitor> monitorList(channels * monitors);
+    for(int i = 0; i < channels; i++) {
+        for(int j = 0; j < monitors; j++) {
+            Monitor *monitor = &monitorList[i * monitors + j];
+            monitor->channel = chids[i];
+            monitor->started = false;
+            monitor->last = 0;
+            ca_create_subscription(DBR_TIME_DOUBLE, ca_element_count(chids[i]), chids[i], DBE_VALUE | DBE_ALARM,
+                monitorCallback, monitor, &monitor->subscription);
+        }
+    }
+
+    if(rate > 0) {
+        epicsThreadCreate("generatorThread", epicsThreadPriorityMedium, epicsThreadGetStackSize(epicsThreadStackMedium), generatorThread, &generator);
+    }
+
+    // Events are taken but not counted during the warmup
+    ca_pend_event(warmup > 0 ? warmup : 1e-6);
+    memset(&stats, 0, sizeof(stats));
+    stats.measuring = true;
+    epicsUInt64 startUpdates = generator.updates;
+    epicsTime start = epicsTime::getCurrent();
+    double elapsed = 0;
+    while(elapsed < duration) {
+        ca_pend_event(duration - elapsed < 0.1 ? duration - elapsed : 0.1);
+        elapsed = epicsTime::getCurrent() - start;
+    }
+    stats.measuring = false;
+    epicsUInt64 updates = generator.updates - startUpdates;
+    generator.running = false;
+
+    double p50 = percentile(&stats.latency, 0.5);
+    double p99 = percentile(&stats.latency, 0.99);
+    double p999 = percentile(&stats.latency, 0.999);
+
+    printf("channels=%d monitors=%d elements=%lu seconds=%.3f\n", channels, monitors, ca_element_count(chids[0]), elapsed);
+    if(rate > 0) {
+        printf("generated %.0f updates/s at %g Hz per PV\n", updates / elapsed, rate);
+    }
+    printf("received %.0f events/s, coalesced %llu\n", stats.events / elapsed, (unsigned long long)stats.coalesced);
+    printf("latency us: p50=%.0f p99=%.0f p999=%.0f max=%.0f\n", p50, p99, p999, stats.latency.max);
+
+    if(output != NULL) {
+        FILE *out = fopen(output, "w");
+        if(out == NULL) {
+            perror("pcasLoad: cannot open the output file");
+        } else {
+            fprintf(out, "{\n  \"benchmark\": \"pcasLoad\",\n  \"channels\": %d,\n  \"monitors\": %d,\n  \"elements\": %lu,\n  \"seconds\": %.6f,\n",
+                channels, monitors, ca_element_count(chids[0]), elapsed);
+            fprintf(out, "  \"rate\": %g,\n  \"updates\": %llu,\n  \"events\": %llu,\n  \"eventsPerSec\": %.1f,\n  \"coalesced\": %llu,\n",
+                rate, (unsigned long long)updates, (unsigned long long)stats.events, stats.events / elapsed, (unsigned long long)stats.coalesced);
+            fprintf(out, "  \"latencyUs\": { \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f }\n}\n", p50, p99, p999, stats.latency.max);
+            fclose(out);
+        }
+    }
+
+    for(size_t i = 0; i < monitorList.size(); i++) {
+        ca_clear_subscription(monitorList[i].subscription);
+    }
+    for(int i = 0; i < channels; i++) {
+        ca_clear_channel(chids[i]);
+    }
+    ca_context_destroy();
+    return 0;
+}
@@ -0,0 +1,376 @@
+/**
+ * This is a stress test of the parameter library, which checks that concurrent updates are never torn or lost.
+ * It is built with node-gyp from binding.gyp in this directory, compiling wrapper.cpp of this tree and linking the PCAS libraries in lib/clibs.
+ *
+ * Usage: pcasStress [-t seconds] [-p pvs] [-e elements] [-s setters] [-w writers] [-u posters] [-r readers]
+ *
+ *   -t  time in seconds the threads run, 5 by default
+ *   -p  number of scalar PVs, 16 by default, a few PVs make the threads collide more often
+ *   -e  element count of the array PVs, 256 by default
+ *   -s  number of threads calling Driver::setParam() on scalars and arrays, 4 by default
+ *   -w  number of threads writing scalars as a client does with SimplePV::writeValue(), 2 by default
+ *   -u  number of threads posting with Driver::updatePVs(), 2 by default
+ *   -r  number of threads reading with Data::readValue(), 4 by default
+ *
+ * Every update writes a value which no other update of the PV writes, with a sign that alternates between passes over the PVs,
+ * and the alarm limits put every value <= 0 into a LOW alarm. A reader checks that
+ *
+ *   the alarm and severity belong to the value, so value and status come from the same update
+ *   all elements of an array are equal, so an array comes from one update
+ *   the timestamp is unchanged as long as the value is, and never goes backwards
+ *
+ * When the threads have stopped, the PVs are posted once more, and every update of a PV must have been
+ * posted or coalesced into a later post. The exit status is 1 if any check failed.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <envDefs.h>
+
+#include "wrapper.h"
+
+
+/**
+ * C interfaces and globals of wrapper.cpp used by the stress test
+ */
+extern "C" {
+    epicsShareFunc void epicsShareAPI createServer(pvDef *pvs, int count);
+    epicsShareFunc void epicsShareAPI createDriver();
+}
+extern SimpleServer *server;
+extern Driver *driver;
+
+
+/**
+ * Shared state of the threads
+ */
+
+// PV under test, sets counts the updates made by all threads
+typedef struct StressPV {
+    PVEntry *entry;
+    int elements;
+    int sets;
+} StressPV;
+
+typedef struct Stress {
+    std::vector<StressPV> pvs;
+    int scalars;
+    int threads;
+    int running;
+    int active;
+    epicsEvent done;
+    epicsUInt64 reads;
+    epicsUInt64 torn;
+    epicsUInt64 backwards;
+    epicsMutex lock;
+} Stress;
+
+static Stress stress;
+
+// Thread of one kind with its index among all updating threads, which makes its values unique
+typedef struct StressThread {
+    int id;
+    epicsUInt64 count;
+} StressThread;
+
+// Value of the round-th update of thread id, the sign alternates between the passes of a thread over the PVs
+static double valueOf(int id, epicsUInt64 round, epicsUInt64 pass) {
+    double value = (double)(round * stress.threads + id + 1);
+    return pass & 1 ? -value : value;
+}
+
+static void finish() {
+    if(epicsAtomicDecrIntT(&stress.active) == 0) {
+        stress.done.signal();
+    }
+}
+
+
+/**
+ * Updating threads
+ */
+
+// Set scalars and arrays through the parameter library as Node.js does
+static void setterThread(void *arg) {
+    StressThread *thread = (StressThread *)arg;
+    std::vector<double> buffer;
+    for(epicsUInt64 pass = 0; epicsAtomicGetIntT(&stress.running); pass++) {
+        for(size_t i = 0; i < stress.pvs.size(); i++) {
+            StressPV *pv = &stress.pvs[i];
+            buffer.assign(pv->elements, valueOf(thread->id, thread->count++, pass));
+            driver->setParam(pv->entry, &buffer[0]);
+            epicsAtomicIncrIntT(&pv->sets);
+        }
+    }
+    finish();
+}
+
+// Write scalars from a gdd as a client write of a soft PV does, which sets and posts the PV
+static void writerThread(void *arg) {
+    StressThread *thread = (StressThread *)arg;
+    for(epicsUInt64 pass = 0; epicsAtomicGetIntT(&stress.running); pass++) {
+        for(int i = 0; i < stress.scalars; i++) {
+            StressPV *pv = &stress.pvs[i];
+            gdd *value = new gdd(gddAppType_value, aitEnumFloat64);
+            value->put(valueOf(thread->id, thread->count++, pass));
+            pv->entry->pv->writeValue(*value);
+            value->unreference();
+            epicsAtomicIncrIntT(&pv->sets);
+        }
+    }
+    finish();
+}
+
+static void posterThread(void *arg) {
+    StressThread *thread = (StressThread *)arg;
+    while(epicsAtomicGetIntT(&stress.running)) {
+        driver->updatePVs();
+        thread->count++;
+    }
+    finish();
+}
+
+
+/**
+ * Reading threads
+ */
+
+// Last read of a PV by one reader
+typedef struct LastRead {
+    double value;
+    epicsTimeStamp time;
+} LastRead;
+
+static bool checkRead(StressPV *pv, double *buffer, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
+    for(int i = 1; i < pv->elements; i++) {
+        if(buffer[i] != buffer[0]) return false;
+    }
+    if(pv->elements > 1) {
+        return alarm == epicsAlarmNone && severity == epicsSevNone;
+    }
+    if(buffer[0] <= 0) {
+        return alarm == epicsAlarmLow && severity == epicsSevMinor;
+    }
+    return alarm == epicsAlarmNone && severity == epicsSevNone;
+}
+
+static void readerThread(void *arg) {
+    StressThread *thread = (StressThread *)arg;
+    std::vector<LastRead> last(stress.pvs.size());
+    std::vector<bool> seen(stress.pvs.size(), false);
+    epicsUInt64 torn = 0;
+    epicsUInt64 backwards = 0;
+
+    while(epicsAtomicGetIntT(&stress.running)) {
+        for(size_t i = 0; i < stress.pvs.size(); i++) {
+            StressPV *pv = &stress.pvs[i];
+            std::vector<double> buffer(pv->elements);
+            Value value;
+            value.setType(aitEnumFloat64);
+            value.setCount(pv->elements);
+            value.setBuffer(&buffer[0]);
+            epicsAlarmCondition alarm;
+            epicsAlarmSeverity severity;
+            epicsTimeStamp time;
+            pv->entry->data->readValue(&value, &alarm, &severity, &time);
+            thread->count++;
+
+            if(!checkRead(pv, &buffer[0], alarm, severity)) {
+                torn++;
+            }
+
+            // The same value with another timestamp, or an older timestamp, mixes two updates
+            if(seen[i]) {
+                epicsTime previous(last[i].time);
+                epicsTime current(time);
+                bool sameTime = last[i].time.secPastEpoch == time.secPastEpoch && last[i].time.nsec == time.nsec;
+                if((buffer[0] == last[i].value && !sameTime) || current < previous) {
+                    backwards++;
+                }
+            }
+            last[i].value = buffer[0];
+            last[i].time = time;
+            seen[i] = true;
+        }
+    }
+
+    epicsGuard<epicsMutex> guard(stress.lock);
+    stress.reads += thread->count;
+    stress.torn += torn;
+    stress.backwards += backwards;
+    finish();
+}
+
+
+/**
+ * Main
+ */
+
+static void startThreads(const char *name, EPICSTHREADFUNC func, int count, int *id, std::vector<StressThread *> &threads) {
+    for(int i = 0; i < count; i++) {
+        StressThread *thread = new StressThread();
+        thread->id = (*id)++;
+        thread->count = 0;
+        threads.push_back(thread);
+        epicsAtomicIncrIntT(&stress.active);
+        epicsThreadCreate(name, epicsThreadPriorityMedium, epicsThreadGetStackSize(epicsThreadStackMedium), func, thread);
+    }
+}
+
+static epicsUInt64 sumCounts(std::vector<StressThread *> &threads) {
+    epicsUInt64 sum = 0;
+    for(size_t i = 0; i < threads.size(); i++) {
+        sum += threads[i]->count;
+    }
+    return sum;
+}
+
+int main(int argc, char *argv[]) {
+    double duration = 5;
+    int scalars = 16;
+    int elements = 256;
+    int setters = 4;
+    int writers = 2;
+    int posters = 2;
+    int readers = 4;
+
+    int opt;
+    while((opt = getopt(argc, argv, "t:p:e:s:w:u:r:")) != -1) {
+        switch(opt) {
+            case 't': duration = atof(optarg); break;
+            case 'p': scalars = atoi(optarg); break;
+            case 'e': elements = atoi(optarg); break;
+            case 's': setters = atoi(optarg); break;
+            case 'w': writers = atoi(optarg); break;
+            case 'u': posters = atoi(optarg); break;
+            case 'r': readers = atoi(optarg); break;
+            default:
+                std::cout << "Usage: pcasStress [-t seconds] [-p pvs] [-e elements] [-s setters] [-w writers] [-u posters] [-r readers]" << std::endl;
+                return 1;
+        }
+    }
+    if(duration <= 0 || scalars < 1 || elements < 2 || setters < 0 || writers < 0 || posters < 1 || readers < 1) {
+        std::cout << "pcasStress: duration, pvs, posters and readers must be positive, and arrays have at least 2 elements" << std::endl;
+        return 1;
+    }
+
+    // Keep the server off the network
+    if(getenv("EPICS_CAS_INTF_ADDR_LIST") == NULL) {
+        epicsEnvSet("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1");
+    }
+
+    // Scalars stress:<index> and as many arrays stress:wf<index>, the high limits are never reached
+    static char *noStrings[] = { NULL };
+    static int noStates[] = { -1 };
+    std::vector<std::string> names;
+    for(int i = 0; i < scalars; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "stress:%d", i);
+        names.push_back(name);
+    }
+    for(int i = 0; i < scalars; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "stress:wf%d", i);
+        names.push_back(name);
+    }
+
+    std::vector<double> initial(elements, 1);
+    std::vector<pvDef> defs(names.size());
+    for(size_t i = 0; i < names.size(); i++) {
+        pvDef *def = &defs[i];
+        memset(def, 0, sizeof(pvDef));
+        def->name = (char *)names[i].c_str();
+        def->type = aitEnumFloat64;
+        def->count = (int)i < scalars ? 1 : elements;
+        def->enums = noStrings;
+        def->states = noStates;
+        def->unit = (char *)"";
+        def->hilim = 1e300;
+        def->lolim = -1e300;
+        def->high = 1e300;
+        def->low = 0;
+        def->hihi = 1e301;
+        def->lolo = -1e301;
+        def->soft = true;
+        def->deadband = deadbandAbsolute;
+        def->value = &initial[0];
+    }
+    createServer(&defs[0], (int)defs.size());
+    createDriver();
+
+    // Monitored PVs build and post the value gdd, so the posting path runs in full
+    PVRegistry &registry = server->getRegistry();
+    for(size_t i = 0; i < names.size(); i++) {
+        StressPV pv;
+        pv.entry = registry.get(names[i].c_str());
+        pv.elements = (int)i < scalars ? 1 : elements;
+        pv.sets = 0;
+        pv.entry->pv->interestRegister();
+        stress.pvs.push_back(pv);
+    }
+    stress.scalars = scalars;
+    stress.threads = setters + writers;
+    stress.running = 1;
+    stress.active = 0;
+    stress.reads = 0;
+    stress.torn = 0;
+    stress.backwards = 0;
+
+    // Updates of the initial values are posted before counting
+    driver->updatePVs();
+    std::vector<PostStats> baseline(stress.pvs.size());
+    for(size_t i = 0; i < stress.pvs.size(); i++) {
+        stress.pvs[i].entry->data->getPostStats(&baseline[i]);
+    }
+
+    int id = 0;
+    std::vector<StressThread *> setterThreads, writerThreads, posterThreads, readerThreads;
+    startThreads("stressSetter", setterThread, setters, &id, setterThreads);
+    startThreads("stressWriter", writerThread, writers, &id, writerThreads);
+    startThreads("stressPoster", posterThread, posters, &id, posterThreads);
+    startThreads("stressReader", readerThread, readers, &id, readerThreads);
+
+    epicsThreadSleep(duration);
+    epicsAtomicSetIntT(&stress.running, 0);
+    while(epicsAtomicGetIntT(&stress.active) > 0) {
+        stress.done.wait(1.0);
+    }
+
+    // Every update is either posted by itself or merged into a later post
+    driver->updatePVs();
+    epicsUInt64 sets = 0;
+    epicsUInt64 posted = 0;
+    epicsUInt64 coalesced = 0;
+    int lost = 0;
+    for(size_t i = 0; i < stress.pvs.size(); i++) {
+        StressPV *pv = &stress.pvs[i];
+        PostStats stats;
+        pv->entry->data->getPostStats(&stats);
+        epicsUInt64 pvPosted = stats.posted - baseline[i].posted;
+        epicsUInt64 pvCoalesced = stats.coalesced - baseline[i].coalesced;
+        double wait;
+        if(pvPosted + pvCoalesced != (epicsUInt64)pv->sets || pv->entry->data->hasUpdate(0, &wait)) {
+            std::cout << "pcasStress: PV " << pv->entry->name << " had " << pv->sets << " updates, but " << pvPosted
+                << " were posted and " << pvCoalesced << " coalesced" << std::endl;
+            lost++;
+        }
+        sets += pv->sets;
+        posted += pvPosted;
+        coalesced += pvCoalesced;
+    }
+
+    printf("pvs=%d elements=%d setters=%d writers=%d posters=%d readers=%d seconds=%g\n",
+        scalars, elements, setters, writers, posters, readers, duration);
+    printf("updates %llu (set %llu, written %llu), posted %llu, coalesced %llu, updatePVs calls %llu\n",
+        (unsigned long long)sets, (unsigned long long)sumCounts(setterThreads), (unsigned long long)sumCounts(writerThreads),
+        (unsigned long long)posted, (unsigned long long)coalesced, (unsigned long long)sumCounts(posterThreads));
+    printf("reads %llu, torn %llu, timestamp mismatches %llu, PVs with lost updates %d\n",
+        (unsigned long long)stress.reads, (unsigned long long)stress.torn, (unsigned long long)stress.backwards, lost);
+
+    bool ok = stress.torn == 0 && stress.backwards == 0 && lost == 0;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -13,18 +13,56 @@
 extern "C" {
     epicsShareFunc void epicsShareAPI createServer(pvDef *pvs, int count);
     epicsShareFunc void epicsShareAPI createDriver();
+    epicsShareFunc int epicsShareAPI addPVs(pvDef *pvs, int count);
+    epicsShareFunc int epicsShareAPI removePVs(const char** names, int count);
     epicsShareFunc void epicsShareAPI installCallback(ReadCallback readCallback, WriteCallback writeCallback);
     epicsShareFunc void epicsShareAPI installReadCallback(ReadCallback readCallback);
     epicsShareFunc void epicsShareAPI installWriteCallback(WriteCallback writeCallback);
+    epicsShareFunc void epicsShareAPI installGroupReadCallback(GroupReadCallback groupReadCallback);
+    epicsShareFunc void epicsShareAPI installAsyncReadCallback(AsyncReadCallback asyncReadCallback);
+    epicsShareFunc int epicsShareAPI completeRead(int id, SimpleValue* simpleValue, int alarm, int severity);
+    epicsShareFunc void epicsShareAPI installAsyncWriteCallback(AsyncWriteCallback asyncWriteCallback);
+    epicsShareFunc int epicsShareAPI completeWrite(int id, int alarm, int severity);
+    epicsShareFunc void epicsShareAPI installWakeupCallback(WakeupCallback wakeupCallback, int kinds);
+    epicsShareFunc int epicsShareAPI drainRequests(RequestInfo* infos, int max);
+    epicsShareFunc int epicsShareAPI completeScan(int id, int alarm, int severity);
+    epicsShareFunc void epicsShareAPI getRequestStats(RequestStats* stats);
     epicsShareFunc void epicsShareAPI createScanThread();
+    epicsShareFunc void epicsShareAPI createScanScheduler(int workers);
+    epicsShareFunc void epicsShareAPI getScanStats(ScanStats* stats);
+    epicsShareFunc void epicsShareAPI setScanTimeout(double timeout);
     epicsShareFunc void epicsShareAPI serverProcess(double delay);
     epicsShareFunc void epicsShareAPI setDebugLevel(int level);
+    epicsShareFunc int epicsShareAPI setLogLevel(const char* pattern, int level);
+    epicsShareFunc void epicsShareAPI setLogOutput(const char* path);
 
     epicsShareFunc void epicsShareAPI updatePVs();
+    epicsShareFunc void epicsShareAPI setAutoUpdate(double period);
     epicsShareFunc void epicsShareAPI getParam(const char* name, SimpleValue* simpleValue);
     epicsShareFunc void epicsShareAPI setParam(const char* name, SimpleValue* simpleValue);
+    epicsShareFunc int epicsShareAPI setParams(SimpleParam* params, int count, void* buffer, int update);
     epicsShareFunc void epicsShareAPI setParamStatus(const char* name, int alarm, int severity);
     epicsShareFunc void epicsShareAPI getSimpleValue(const char* name, SimpleValue* simpleValue);
+    epicsShareFunc void epicsShareAPI releaseParam(void* buffer);
+    epicsShareFunc int epicsShareAPI getParamBuffer(const char* name, void* buffer, int size);
+    epicsShareFunc int epicsShareAPI setParamBuffer(const char* name, void* buffer, int size);
+
+    epicsShareFunc int epicsShareAPI getHandle(const char* name);
+    epicsShareFunc void epicsShareAPI setParamDoubleH(int handle, double value);
+    epicsShareFunc void epicsShareAPI setParamInt32H(int handle, int value);
+    epicsShareFunc double epicsShareAPI getParamDoubleH(int handle);
+    epicsShareFunc int epicsShareAPI getParamInt32H(int handle);
+    epicsShareFunc void epicsShareAPI setParamStatusH(int handle, int alarm, int severity);
+
+    epicsShareFunc void epicsShareAPI getSlotInfo(int region, SlotInfo* info);
+    epicsShareFunc int epicsShareAPI getSlot(int handle, int* region);
+    epicsShareFunc int epicsShareAPI commit(int* handles, int count);
+    epicsShareFunc int epicsShareAPI commitAll();
+
+    epicsShareFunc void epicsShareAPI getSearchStats(SearchStats* stats);
+    epicsShareFunc void epicsShareAPI getPoolStats(PoolStats* stats);
+    epicsShareFunc void epicsShareAPI getPostStats(const char* name, PostStats* stats);
+    epicsShareFunc void epicsShareAPI createStatsPVs(const char* prefix, double period);
 }
 
 
@@ -33,24 +71,144 @@ extern "C" {
  */
 SimpleServer *server = NULL;
 Driver *driver = NULL;
+ScanScheduler *scanner = NULL;
+AsyncIOManager *asyncIO = NULL;
+ServerWakeup *wakeup = NULL;
+ServerStats *serverStats = NULL;
+Logger *logger = NULL;
+
+
+/** 
+ * Default number of scan worker threads
+ */
+#define DEFAULT_SCAN_WORKERS 2
+
+
+/** 
+ * Number of lock-free attempts to read a parameter before waiting for the writer
+ */
+#define SEQLOCK_RETRIES 8
 
 
 /** 
  * Debug level
  * 0: Default level, only print error information.
  * 1: Print PV definition, PV list, parameter library and scan thread.
- * 2: Print PV process information.
+ * 2: Print PV process information through the logger.
  */
 int debugLevel = 0;
 
 
 /** 
- * Get EPICS timestamp
+ * Tracing of the hot paths, which is written to the logger
+ * The log level of a PV overrides the debug level for that PV
+ */
+static inline bool tracing() {
+    return logger != NULL && debugLevel >= 2;
+}
+
+static inline bool tracing(PVEntry *entry) {
+    if(logger == NULL) return false;
+    int level = entry->logLevel;
+    return (level >= 0 ? level : debugLevel) >= 2;
+}
+
+
+/** 
+ * Size classes of the buffer pool, from 16 bytes to 16 MB
+ */
+#define POOL_MIN_SHIFT 4
+#define POOL_CLASSES 21
+
+
+/** 
+ * Maximum bytes kept on the free list of each size class, at least two blocks are kept
+ */
+#define POOL_MAX_CACHED_BYTES (16 * 1024 * 1024)
+
+
+/** 
+ * BufferPool class
  */
-epicsTimeStamp * getEPICSTimeStamp() {
-    epicsTimeStamp *ts = new epicsTimeStamp();
-    epicsTimeGetCurrent(ts);
-    return ts;
+PoolClass BufferPool::classes[POOL_CLASSES + 1];
+epicsMutex BufferPool::locks[POOL_CLASSES + 1];
+
+int BufferPool::sizeClassOf(size_t size) {
+    int sizeClass = 0;
+    while(sizeClass < POOL_CLASSES && ((size_t)1 << (sizeClass + POOL_MIN_SHIFT)) < size) {
+        sizeClass++;
+    }
+    return sizeClass;
+}
+
+void * BufferPool::alloc(size_t size) {
+    int sizeClass = sizeClassOf(size);
+    size_t blockSize = sizeClass < POOL_CLASSES ? (size_t)1 << (sizeClass + POOL_MIN_SHIFT) : size;
+    PoolClass &pool = classes[sizeClass];
+    PoolHeader *header = NULL;
+    {
+        epicsGuard<epicsMutex> guard(locks[sizeClass]);
+        pool.allocs++;
+        pool.bytesInUse += blockSize;
+        if(pool.freeList != NULL) {
+            header = pool.freeList;
+            pool.freeList = header->block.next;
+            pool.cached--;
+            pool.hits++;
+        } else {
+            pool.misses++;
+        }
+    }
+
+    if(header == NULL) {
+        header = (PoolHeader *)malloc(sizeof(PoolHeader) + blockSize);
+        if(header == NULL) {
+            epicsGuard<epicsMutex> guard(locks[sizeClass]);
+            pool.allocs--;
+            pool.bytesInUse -= blockSize;
+            throw std::bad_alloc();
+        }
+        header->block.size = blockSize;
+        header->block.sizeClass = sizeClass;
+    }
+    return header + 1;
+}
+
+void BufferPool::release(void *ptr) {
+    if(ptr == NULL) return;
+
+    PoolHeader *header = (PoolHeader *)ptr - 1;
+    int sizeClass = header->block.sizeClass;
+    size_t blockSize = header->block.size;
+    PoolClass &pool = classes[sizeClass];
+    {
+        epicsGuard<epicsMutex> guard(locks[sizeClass]);
+        pool.frees++;
+        pool.bytesInUse -= blockSize;
+        if(sizeClass < POOL_CLASSES && (pool.cached < 2 || (pool.cached + 1) * blockSize <= POOL_MAX_CACHED_BYTES)) {
+            header->block.next = pool.freeList;
+            pool.freeList = header;
+            pool.cached++;
+            return;
+        }
+    }
+    free(header);
+}
+
+void BufferPool::getStats(PoolStats *stats) {
+    memset(stats, 0, sizeof(PoolStats));
+    for(int sizeClass = 0; sizeClass <= POOL_CLASSES; sizeClass++) {
+        epicsGuard<epicsMutex> guard(locks[sizeClass]);
+        PoolClass &pool = classes[sizeClass];
+        stats->allocs += pool.allocs;
+        stats->frees += pool.frees;
+        stats->hits += pool.hits;
+        stats->misses += pool.misses;
+        stats->bytesInUse += pool.bytesInUse;
+        if(sizeClass < POOL_CLASSES) {
+            stats->bytesCached += pool.cached * ((size_t)1 << (sizeClass + POOL_MIN_SHIFT));
+        }
+    }
 }
 
 
@@ -59,6 +217,8 @@ epicsTimeStamp * getEPICSTimeStamp() {
  */
 class aitStringDestructor: public gddDestructor {
 public:
+	static void * operator new(size_t size) { return BufferPool::alloc(size); }
+	static void operator delete(void *ptr) { BufferPool::release(ptr); }
 	aitStringDestructor(void) {}
 	void run(void *v) { 
         delete [] (aitString *)v; 
@@ -71,10 +231,28 @@ public:
  */
 class valueBufferDestructor: public gddDestructor {
 public:
+	static void * operator new(size_t size) { return BufferPool::alloc(size); }
+	static void operator delete(void *ptr) { BufferPool::release(ptr); }
 	valueBufferDestructor(void) {}
 	void run(void *v) { 
-        free(v);
+        BufferPool::release(v);
+    }
+};
+
+
+/** 
+ * Shared value buffer destructor for putRef(), each gdd holds its own reference
+ */
+class valueBufferRefDestructor: public gddDestructor {
+public:
+	static void * operator new(size_t size) { return BufferPool::alloc(size); }
+	static void operator delete(void *ptr) { BufferPool::release(ptr); }
+	valueBufferRefDestructor(ValueBuffer *buffer) : buffer(buffer) {}
+	void run(void *v) { 
+        buffer->release();
     }
+private:
+    ValueBuffer *buffer;
 };
 
 
@@ -85,10 +263,10 @@ void releaseValue(Value *value) {
     delete value;
 }
 void releaseBuffer(Value *value) {
-    free(value->getBuffer());
+    BufferPool::release(value->getBuffer());
 }
 void releaseValueAndBuffer(Value *value) {
-    free(value->getBuffer());
+    BufferPool::release(value->getBuffer());
     delete value;
 }
 
@@ -96,6 +274,14 @@ void releaseValueAndBuffer(Value *value) {
 /** 
  * Value class
  */
+void * Value::operator new(size_t size) {
+    return BufferPool::alloc(size);
+}
+
+void Value::operator delete(void *ptr) {
+    BufferPool::release(ptr);
+}
+
 Value::Value() {
     type = aitEnumInvalid;
     count = 0;
@@ -108,7 +294,7 @@ Value::Value(aitEnum type, int count) {
     
     // Initialize the buffer field
     int bufferSize = calcBufferSize();
-    this->buffer = malloc(bufferSize);
+    this->buffer = BufferPool::alloc(bufferSize);
     memset(this->buffer, 0, bufferSize);
 }
 
@@ -118,7 +304,7 @@ Value::Value(aitEnum type, int count, void *buffer) {
 
     // Initialize the buffer field
     int bufferSize = calcBufferSize();
-    this->buffer = malloc(bufferSize);
+    this->buffer = BufferPool::alloc(bufferSize);
     memcpy(this->buffer, buffer, bufferSize);
 }
 
@@ -128,7 +314,7 @@ Value::Value(Value &obj) {
 
     // Initialize the buffer field
     int bufferSize = calcBufferSize();
-    this->buffer = malloc(bufferSize);
+    this->buffer = BufferPool::alloc(bufferSize);
     memcpy(this->buffer, obj.buffer, bufferSize);
 }
 
@@ -222,30 +408,128 @@ std::ostream & operator << (std::ostream &out, const Value &value) {
 }
 
 
+/** 
+ * ValueBuffer class
+ */
+void * ValueBuffer::operator new(size_t size) {
+    return BufferPool::alloc(size);
+}
+
+void ValueBuffer::operator delete(void *ptr) {
+    BufferPool::release(ptr);
+}
+
+ValueBuffer::ValueBuffer(void *data) {
+    this->data = data;
+    this->refs = 1;
+}
+
+ValueBuffer::~ValueBuffer() {
+    BufferPool::release(data);
+}
+
+void * ValueBuffer::getData() {
+    return data;
+}
+
+void ValueBuffer::reference() {
+    epicsAtomicIncrIntT(&refs);
+}
+
+void ValueBuffer::release() {
+    if(epicsAtomicDecrIntT(&refs) == 0) {
+        delete this;
+    }
+}
+
+
 /** 
  * Data class
  */
 Data::Data() {
     value = NULL;
+    shared = NULL;
     flag = false;
     alarm = UDF_ALARM;
     severity = INVALID_ALARM;
     udf = true;
     mask = 0;
-    time = getEPICSTimeStamp();
+    epicsTimeGetCurrent(&time);
+    depth = 0;
+    seq = 0;
+    posting = 0;
+    raised = false;
+    updates = 0;
+    posted = 0;
+    coalesced = 0;
+}
+
+// The shared buffer is released by reference, since a post may still hold it
+Data::~Data() {
+    if(shared != NULL) {
+        shared->release();
+        delete value;
+    } else if(value != NULL) {
+        releaseValueAndBuffer(value);
+    }
 }
 
+// Numeric arrays are kept in shared buffers, scalars and strings are updated in place
 void Data::initValue(aitEnum type, int count) {
     value = new Value(type, count);
+    if(count > 1 && type != aitEnumString) {
+        shared = new ValueBuffer(value->getBuffer());
+    }
 }
 
 void Data::initValue(aitEnum type, int count, void *buffer) {
     value = new Value(type, count, buffer);
+    if(count > 1 && type != aitEnumString) {
+        shared = new ValueBuffer(value->getBuffer());
+    }
 }
 
 void Data::copyValue(Value *value) {
     void *buffer = value->getBuffer();
-    this->value->copyBuffer(buffer);
+    if(shared == NULL) {
+        this->value->copyBuffer(buffer);
+        return;
+    }
+
+    // Publish a new buffer, readers and posts still holding the previous one are not affected
+    int bufferSize = this->value->calcBufferSize();
+    void *copy = BufferPool::alloc(bufferSize);
+    memcpy(copy, buffer, bufferSize);
+    ValueBuffer *previous = shared;
+    shared = new ValueBuffer(copy);
+    this->value->setBuffer(copy);
+    previous->release();
+}
+
+// Take over the pooled buffer of value without copying if the parameter is shared, otherwise copy it
+void Data::adoptValue(Value *value) {
+    if(shared == NULL) {
+        copyValue(value);
+        return;
+    }
+
+    ValueBuffer *previous = shared;
+    shared = new ValueBuffer(value->getBuffer());
+    this->value->setBuffer(value->getBuffer());
+    previous->release();
+}
+
+bool Data::isShared() {
+    return shared != NULL;
+}
+
+// Get a reference to the current shared buffer together with its status under the mutex, the caller releases the reference
+// The mutex is only held while taking the reference, the array itself is copied by the caller without locking
+ValueBuffer * Data::acquireBuffer(epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time) {
+    epicsGuard<epicsMutex> guard(mutex);
+    shared->reference();
+    copyTo(NULL, alarm, severity, time);
+    return shared;
 }
 
 void Data::setValue(Value *value) {
@@ -281,6 +565,7 @@ unsigned int Data::getMask() {
 
 void Data::setFlag(bool flag) {
     this->flag = flag;
+    if(flag) raised = true;
 }
 
 bool Data::getFlag() {
@@ -288,15 +573,130 @@ bool Data::getFlag() {
 }
 
 void Data::setTimeStamp(epicsTimeStamp *time) {
-    this->time = time;
+    this->time = *time;
 }
 
 void Data::setTimeStampToCurrent() {
-    epicsTimeGetCurrent(this->time);
+    epicsTimeGetCurrent(&this->time);
 }
 
 epicsTimeStamp * Data::getTimeStamp() {
-    return time;
+    return &time;
+}
+
+// Start an update of the parameter, the sequence counter stays odd until the outermost update ends
+void Data::beginUpdate() {
+    mutex.lock();
+    if(depth++ == 0) {
+        epicsAtomicIncrIntT(&seq);
+        epicsAtomicWriteMemoryBarrier();
+    }
+}
+
+void Data::endUpdate() {
+    if(--depth == 0) {
+        // Count each outermost update which raised the flag, so merged updates can be counted when posting
+        if(raised) {
+            updates++;
+            raised = false;
+        }
+        epicsAtomicWriteMemoryBarrier();
+        epicsAtomicIncrIntT(&seq);
+    }
+    mutex.unlock();
+}
+
+// Copy value, alarm, severity and timestamp without locking, and retry if an update overlapped
+// The mutex is taken after too many retries, so a reader is not starved by a fast writer
+void Data::readValue(Value *value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time) {
+    // A shared buffer may be released by the writer, so the reference is taken under the mutex and the copy is made outside
+    if(shared != NULL) {
+        ValueBuffer *buffer = acquireBuffer(alarm, severity, time);
+        if(value != NULL) value->copyBuffer(buffer->getData());
+        buffer->release();
+        return;
+    }
+
+    for(int retry = 0; retry < SEQLOCK_RETRIES; retry++) {
+        int start = epicsAtomicGetIntT(&seq);
+        if(start & 1) continue;
+        epicsAtomicReadMemoryBarrier();
+        copyTo(value, alarm, severity, time);
+        epicsAtomicReadMemoryBarrier();
+        if(epicsAtomicGetIntT(&seq) == start) return;
+    }
+
+    epicsGuard<epicsMutex> guard(mutex);
+    copyTo(value, alarm, severity, time);
+}
+
+void Data::copyTo(Value *value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time) {
+    if(value != NULL) value->copyBuffer(this->value->getBuffer());
+    if(alarm != NULL) *alarm = this->alarm;
+    if(severity != NULL) *severity = this->severity;
+    if(time != NULL) *time = this->time;
+}
+
+// Take the pending update for posting and clear the flag, false is returned if nothing changed
+// Posts are at least interval seconds apart, an update within the interval is held back with the flag raised
+// Alarm changes are never held back
+bool Data::takeUpdate(Snapshot *snapshot, double interval) {
+    epicsGuard<epicsMutex> guard(mutex);
+    if(!flag) return false;
+
+    if(interval > 0) {
+        epicsTime now = epicsTime::getCurrent();
+        if(now - lastPost < interval && !(mask & DBE_ALARM)) return false;
+        lastPost = now;
+    }
+
+    if(shared != NULL) {
+        shared->reference();
+        snapshot->buffer = shared;
+        snapshot->value = NULL;
+    } else {
+        snapshot->buffer = NULL;
+        snapshot->value = new Value(*value);
+    }
+    snapshot->alarm = alarm;
+    snapshot->severity = severity;
+    snapshot->time = time;
+    snapshot->mask = mask;
+    flag = false;
+    mask = 0;
+
+    posted++;
+    if(updates > 1) coalesced += updates - 1;
+    updates = 0;
+    return true;
+}
+
+// Check if an update is pending, and return the time to wait until it can be posted
+bool Data::hasUpdate(double interval, double *wait) {
+    epicsGuard<epicsMutex> guard(mutex);
+    if(!flag) return false;
+
+    *wait = 0;
+    if(interval > 0 && !(mask & DBE_ALARM)) {
+        double elapsed = epicsTime::getCurrent() - lastPost;
+        if(elapsed < interval) *wait = interval - elapsed;
+    }
+    return true;
+}
+
+void Data::getPostStats(PostStats *stats) {
+    epicsGuard<epicsMutex> guard(mutex);
+    stats->posted = posted;
+    stats->coalesced = coalesced;
+}
+
+// Only one thread posts events of a PV at a time, this never blocks
+bool Data::beginPost() {
+    return epicsAtomicCmpAndSwapIntT(&posting, 0, 1) == 0;
+}
+
+void Data::endPost() {
+    epicsAtomicSetIntT(&posting, 0);
 }
 
 std::ostream & operator << (std::ostream &out, const Data &data) {
@@ -305,801 +705,2252 @@ std::ostream & operator << (std::ostream &out, const Data &data) {
     out << "severity=" << SeverityStrings[data.severity] << ", ";
     out << "flag=" << data.flag << ", ";
     out << "mask=" << data.mask << ", ";
-    out << "time=" << data.time;
+    out << "time=" << data.time.secPastEpoch << "." << data.time.nsec;
     return out;
 }
 
 
 /** 
- * Driver class
+ * PVRegistry class
  */
-Driver::Driver() {
-    std::map<std::string, casPV*> pvList = server->getPVList();
 
-    if(debugLevel >= 1) {
-        std::cout << "\n\n";
-        std::cout << "********** Parameter library ***********\n";
+// Number of hash functions and bits per name of the bloom filter, about 1% false positive rate
+#define FILTER_HASHES 4
+#define FILTER_BITS_PER_NAME 10
+
+// A handle keeps the index of its entry in the low bits and the generation of the index in the bits above
+#define HANDLE_INDEX_BITS 22
+#define HANDLE_INDEX_MASK ((1 << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATIONS (1 << (31 - HANDLE_INDEX_BITS))
+
+PVRegistry::PVRegistry() {
+    RegistryTable *initial = new RegistryTable();
+    initial->names = 0;
+    rebuild(initial);
+    table = initial;
+    draft = NULL;
+    updateDepth = 0;
+    readerKey = epicsThreadPrivateCreate();
+    readers = NULL;
+    epoch = 1;
+    hits = 0;
+    misses = 0;
+    filterRejects = 0;
+}
+
+// 64-bit FNV-1a hash of a PV name
+epicsUInt64 PVRegistry::hashName(const char *name) {
+    epicsUInt64 hash = 14695981039346656037ULL;
+    for(const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
     }
-    
-    for(std::map<std::string, casPV*>::iterator iter = pvList.begin(); iter != pvList.end(); ++iter) {
-        // std::cout << "[" << iter->first << ", " << iter->second << "]\n";
-        std::string name = iter->first;
-        SimplePV *pv = (SimplePV *)iter->second;
-        PVInfo *info = pv->getInfo();
-        Data *data = new Data();
-        data->initValue(info->getValue()->getType(), info->getValue()->getCount(), info->getValue()->getBuffer());
-        pvDB.insert(std::pair<std::string, Data*>(name, data));
+    return hash;
+}
 
-        if(debugLevel >= 1) {
-            std::cout << name << ", {" << *data << "}\n\n";
-        }
+RegistryTable * PVRegistry::current() {
+    return (RegistryTable *)epicsAtomicGetPtrT(&table);
+}
+
+// Start an update, adds and removes until the matching endUpdate() are published at once
+// Updates nest, and the writer lock is held until the outermost update ends
+void PVRegistry::beginUpdate() {
+    writeLock.lock();
+    if(updateDepth++ == 0) {
+        draft = new RegistryTable(*current());
     }
+}
 
-    if(debugLevel >= 1) {
-        std::cout << "****************************************\n";
-        std::cout << "\n\n";
+void PVRegistry::endUpdate() {
+    if(--updateDepth == 0) {
+        publish();
     }
+    writeLock.unlock();
+}
 
-    this->readCallback = NULL;
-    this->writeCallback = NULL;
+// Publish the draft, the replaced table and the removed and replaced entries are retired with the epoch after the switch
+// A reader which entered before the switch may still see them, one which entered after cannot
+void PVRegistry::publish() {
+    if(!removed.empty()) {
+        rebuild(draft);
+    }
+
+    RegistryTable *previous = current();
+    epicsAtomicCmpAndSwapPtrT(&table, previous, draft);
+    draft = NULL;
+
+    RetiredTable retiring;
+    retiring.epoch = epicsAtomicIncrIntT(&epoch);
+    retiring.table = previous;
+    retiring.entries.swap(removed);
+    retiring.replaced.swap(replaced);
+    retired.push_back(retiring);
 }
 
-void Driver::installCallback(ReadCallback readCallback, WriteCallback writeCallback) {
-    if(readCallback != NULL)
-        this->readCallback = readCallback;
-    if(writeCallback != NULL)
-        this->writeCallback = writeCallback;
+// Add a PV to the registry, the entry is returned or NULL if the name is already registered
+// A recycled index is taken before the table grows, its handle gets the next generation of the index
+PVEntry * PVRegistry::add(const char *name, SimplePV *pv, PVInfo *info) {
+    beginUpdate();
+    epicsUInt64 hash = hashName(name);
+    if(probe(draft, name, hash) >= 0) {
+        endUpdate();
+        return NULL;
+    }
+
+    PVEntry *entry = new PVEntry();
+    entry->name = name;
+    if(freeIndexes.empty()) {
+        if(draft->entries.size() > HANDLE_INDEX_MASK) {
+            std::cout << "add(): Too many PVs to add " << name << std::endl;
+            delete entry;
+            endUpdate();
+            return NULL;
+        }
+        entry->handle = (int)draft->entries.size();
+        draft->entries.push_back(NULL);
+    } else {
+        int index = freeIndexes.back();
+        freeIndexes.pop_back();
+        PVEntry *previous = draft->entries[index];
+        int generation = ((previous->handle >> HANDLE_INDEX_BITS) + 1) % HANDLE_GENERATIONS;
+        entry->handle = (generation << HANDLE_INDEX_BITS) | index;
+        replaced.push_back(previous);
+    }
+    entry->pv = pv;
+    entry->info = info;
+    entry->data = NULL;
+    entry->nextDirty = -1;
+    entry->queued = 0;
+    entry->slotRegion = -1;
+    entry->slot = -1;
+    entry->logLevel = -1;
+    entry->removed = 0;
+
+    draft->entries[entry->handle & HANDLE_INDEX_MASK] = entry;
+    draft->names++;
+
+    // Keep the load factor of the index below 0.5 and the filter at its designed bits per name
+    size_t indexed = draft->names + removed.size();
+    if(indexed * 2 > draft->index.size() || (size_t)draft->names * FILTER_BITS_PER_NAME > draft->filter.size() * 64) {
+        rebuild(draft);
+    } else {
+        insertIndex(draft, entry->handle & HANDLE_INDEX_MASK, hash);
+        insertFilter(draft, hash);
+    }
+    endUpdate();
+    return entry;
 }
 
-void Driver::installReadCallback(ReadCallback readCallback) {
-    if(readCallback != NULL)
-        this->readCallback = readCallback;
+// Remove a PV from the registry, the entry is returned or NULL if the name is not registered
+// The entry is not found from the moment it is removed, and it is handed to reclaim() after the grace period
+PVEntry * PVRegistry::remove(const char *name) {
+    beginUpdate();
+    int position = probe(draft, name, hashName(name));
+    PVEntry *entry = NULL;
+    if(position >= 0) {
+        entry = draft->entries[position];
+        epicsAtomicSetIntT(&entry->removed, 1);
+        draft->names--;
+        removed.push_back(entry);
+    }
+    endUpdate();
+    return entry;
 }
 
-void Driver::installWriteCallback(WriteCallback writeCallback) {
-    if(writeCallback != NULL)
-        this->writeCallback = writeCallback;
+// Free the tables and replaced entries whose grace period has passed and hand their removed entries to the caller,
+// which destroys the PVs before the next call
+// An entry handed out before is recycled once it has left the dirty stack, then no queued request or log record can
+// reach it through its handle anymore, and its index is reused by the next add
+// It never waits, the writer lock is only tried and a grace period still running is checked again on the next call
+void PVRegistry::reclaim(std::vector<PVEntry*> &released) {
+    if(!writeLock.tryLock()) return;
+    size_t kept = 0;
+    for(size_t i = 0; i < dead.size(); i++) {
+        if(epicsAtomicGetIntT(&dead[i]->queued)) {
+            dead[kept++] = dead[i];
+        } else {
+            freeIndexes.push_back(dead[i]->handle & HANDLE_INDEX_MASK);
+        }
+    }
+    dead.resize(kept);
+
+    while(!retired.empty() && passed(retired.front().epoch)) {
+        RetiredTable &oldest = retired.front();
+        delete oldest.table;
+        for(size_t i = 0; i < oldest.replaced.size(); i++) {
+            delete oldest.replaced[i];
+        }
+        released.insert(released.end(), oldest.entries.begin(), oldest.entries.end());
+        dead.insert(dead.end(), oldest.entries.begin(), oldest.entries.end());
+        retired.pop_front();
+    }
+    writeLock.unlock();
 }
 
-bool Driver::hasReadCallback() {
-    return readCallback != NULL;
+// Check that every reader has left the read sections it entered before the epoch of a retired table
+bool PVRegistry::passed(int retiredEpoch) {
+    for(RegistryReader *reader = (RegistryReader *)epicsAtomicGetPtrT(&readers); reader != NULL; reader = reader->next) {
+        int entered = epicsAtomicGetIntT(&reader->epoch);
+        if(entered != 0 && entered < retiredEpoch) return false;
+    }
+    return true;
 }
 
-bool Driver::hasWriteCallback() {
-    return writeCallback != NULL;
+// Reader record of the calling thread, which is allocated on first use and linked for the writer to check
+// The record of a thread is never freed, since the writer may be reading it
+RegistryReader * PVRegistry::reader() {
+    RegistryReader *reader = (RegistryReader *)epicsThreadPrivateGet(readerKey);
+    if(reader != NULL) return reader;
+
+    reader = new RegistryReader();
+    reader->epoch = 0;
+    reader->depth = 0;
+    RegistryReader *head = (RegistryReader *)epicsAtomicGetPtrT(&readers);
+    while(true) {
+        reader->next = head;
+        RegistryReader *prev = (RegistryReader *)epicsAtomicCmpAndSwapPtrT(&readers, head, reader);
+        if(prev == head) break;
+        head = prev;
+    }
+    epicsThreadPrivateSet(readerKey, reader);
+    return reader;
 }
 
-ReadCallback Driver::getReadCallback() {
-    return readCallback;
+// Enter a read section, the table and the entries seen inside stay valid until the section is left
+void PVRegistry::enter() {
+    RegistryReader *reader = this->reader();
+    if(reader->depth++ > 0) return;
+    epicsAtomicCmpAndSwapIntT(&reader->epoch, 0, epicsAtomicGetIntT(&epoch));
 }
 
-WriteCallback Driver::getWriteCallback() {
-    return writeCallback;
+void PVRegistry::exit() {
+    RegistryReader *reader = this->reader();
+    if(--reader->depth > 0) return;
+    epicsAtomicSetIntT(&reader->epoch, 0);
+}
+
+// Find the handle of a PV, -1 is returned if the PV does not exist
+int PVRegistry::find(const char *name) {
+    RegistryTable *published = current();
+    epicsUInt64 hash = hashName(name);
+    if(!mayContain(published, hash))
+        return -1;
+    int position = probe(published, name, hash);
+    return position >= 0 ? published->entries[position]->handle : -1;
 }
 
-Value * Driver::getParam(std::string name) {
-    Value *value = pvDB[name]->getValue();
+// Find the handle of a PV for a client search and update the search counters
+int PVRegistry::search(const char *name) {
+    RegistryTable *published = current();
+    epicsUInt64 hash = hashName(name);
+    if(!mayContain(published, hash)) {
+        filterRejects++;
+        return -1;
+    }
 
-    if(debugLevel >= 2) {
-        std::cout << "getParam(): pv=" << name << ", value=" << *value << std::endl;
+    int position = probe(published, name, hash);
+    if(position >= 0) {
+        hits++;
+        return published->entries[position]->handle;
     }
+    misses++;
+    return -1;
+}
 
-    // Clone a new value instance, which will be released later
-    Value *cloneValue = new Value(*value);
+// Entry of a PV, NULL is returned if the handle is invalid or the PV has been removed
+PVEntry * PVRegistry::get(int handle) {
+    PVEntry *entry = at(handle);
+    if(entry == NULL || entry->removed)
+        return NULL;
+    return entry;
+}
 
-    return cloneValue;
+PVEntry * PVRegistry::get(const char *name) {
+    return get(find(name));
+}
+
+// Entry of a handle even if the PV has been removed, for the dirty stack and the names of queued requests
+// NULL is returned for a stale handle, whose index has been reused by another PV
+PVEntry * PVRegistry::at(int handle) {
+    RegistryTable *published = current();
+    int index = handle & HANDLE_INDEX_MASK;
+    if(handle < 0 || index >= (int)published->entries.size())
+        return NULL;
+    PVEntry *entry = published->entries[index];
+    if(entry->handle != handle)
+        return NULL;
+    return entry;
 }
 
-void Driver::setParam(std::string name, Value *value) {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-    PVInfo *info = pv->getInfo();
+// Entry at an index of the table, NULL is returned if the PV has been removed
+PVEntry * PVRegistry::entryAt(int index) {
+    RegistryTable *published = current();
+    if(index < 0 || index >= (int)published->entries.size())
+        return NULL;
+    PVEntry *entry = published->entries[index];
+    if(entry->removed)
+        return NULL;
+    return entry;
+}
 
-    if(debugLevel >= 2) {
-        // The type and count in value is not guaranteed to be consistent with PV info
-        Value valueToPrint;
-        valueToPrint.setType(info->getValue()->getType());
-        valueToPrint.setCount(info->getValue()->getCount());
-        valueToPrint.setBuffer(value->getBuffer());
-        std::cout << "setParam(): pv=" << name << ", value=" << valueToPrint << std::endl;
+// Number of indexes, including the indexes of removed PVs which are not reused yet
+int PVRegistry::size() {
+    return (int)current()->entries.size();
+}
+
+void PVRegistry::getSearchStats(SearchStats *stats) {
+    RegistryTable *published = current();
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->filterRejects = filterRejects;
+    stats->names = published->names;
+    stats->indexSize = (int)published->index.size();
+    stats->filterBits = (int)published->filter.size() * 64;
+}
+
+// Check the bloom filter, false means the name is definitely not registered
+bool PVRegistry::mayContain(RegistryTable *table, epicsUInt64 hash) {
+    epicsUInt32 h1 = (epicsUInt32)hash;
+    epicsUInt32 h2 = (epicsUInt32)(hash >> 32) | 1;
+    epicsUInt32 mask = (epicsUInt32)(table->filter.size() * 64 - 1);
+    for(int i = 0; i < FILTER_HASHES; i++) {
+        epicsUInt32 bit = (h1 + i * h2) & mask;
+        if(!(table->filter[bit >> 6] & ((epicsUInt64)1 << (bit & 63))))
+            return false;
     }
+    return true;
+}
 
-    pvDB[name]->setMask(pvDB[name]->getMask() | info->checkValue(value));
-    pvDB[name]->copyValue(value);
-    pvDB[name]->setTimeStampToCurrent();
-    if(pvDB[name]->getMask()) {
-        pvDB[name]->setFlag(true);
+// Linear probing of the hash index, the full name is only compared when the hash matches
+// A removed entry stays in the index until the next rebuild and is skipped
+int PVRegistry::probe(RegistryTable *table, const char *name, epicsUInt64 hash) {
+    epicsUInt32 mask = (epicsUInt32)(table->index.size() - 1);
+    for(epicsUInt32 i = (epicsUInt32)hash & mask; ; i = (i + 1) & mask) {
+        IndexSlot &slot = table->index[i];
+        if(slot.position < 0)
+            return -1;
+        if(slot.hash != (epicsUInt32)hash)
+            continue;
+        PVEntry *entry = table->entries[slot.position];
+        if(!entry->removed && strcmp(entry->name.c_str(), name) == 0)
+            return slot.position;
     }
-    epicsAlarmCondition alarm;
-    epicsAlarmSeverity severity;
-    info->checkAlarm(value, &alarm, &severity);
-    setParamStatus(name, alarm, severity);
+}
 
-    // Release value and buffer
-    releaseValueAndBuffer(value);
+void PVRegistry::insertIndex(RegistryTable *table, int position, epicsUInt64 hash) {
+    epicsUInt32 mask = (epicsUInt32)(table->index.size() - 1);
+    epicsUInt32 i = (epicsUInt32)hash & mask;
+    while(table->index[i].position >= 0) {
+        i = (i + 1) & mask;
+    }
+    table->index[i].hash = (epicsUInt32)hash;
+    table->index[i].position = position;
 }
 
-void Driver::setParamStatus(std::string name, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
-    if(debugLevel >= 2) {
-        if(alarm != pvDB[name]->getAlarm() || severity != pvDB[name]->getSeverity()) {
-            std::cout << "setParamStatus(): alarm=" << AlarmStrings[alarm] << ", severity=" << SeverityStrings[severity] << std::endl;
-        }
+void PVRegistry::insertFilter(RegistryTable *table, epicsUInt64 hash) {
+    epicsUInt32 h1 = (epicsUInt32)hash;
+    epicsUInt32 h2 = (epicsUInt32)(hash >> 32) | 1;
+    epicsUInt32 mask = (epicsUInt32)(table->filter.size() * 64 - 1);
+    for(int i = 0; i < FILTER_HASHES; i++) {
+        epicsUInt32 bit = (h1 + i * h2) & mask;
+        table->filter[bit >> 6] |= ((epicsUInt64)1 << (bit & 63));
     }
+}
 
-    if(alarm != pvDB[name]->getAlarm()) {
-        pvDB[name]->setAlarm(alarm);
-        pvDB[name]->setMask(pvDB[name]->getMask() | DBE_ALARM);
-        pvDB[name]->setFlag(true);
+// Resize the index and the filter to powers of two that fit all names, then insert every name again
+// Removed entries are left out, which clears them from the index and the filter
+void PVRegistry::rebuild(RegistryTable *table) {
+    size_t indexSize = 16;
+    while(indexSize < (size_t)table->names * 4) {
+        indexSize <<= 1;
     }
-    if(severity != pvDB[name]->getSeverity()) {
-        pvDB[name]->setSeverity(severity);
-        pvDB[name]->setMask(pvDB[name]->getMask() | DBE_ALARM);
-        pvDB[name]->setFlag(true);
+    size_t filterWords = 1;
+    while(filterWords * 64 < (size_t)table->names * FILTER_BITS_PER_NAME * 2) {
+        filterWords <<= 1;
+    }
+
+    IndexSlot empty;
+    empty.hash = 0;
+    empty.position = -1;
+    table->index.assign(indexSize, empty);
+    table->filter.assign(filterWords, 0);
+
+    for(int position = 0; position < (int)table->entries.size(); position++) {
+        PVEntry *entry = table->entries[position];
+        if(entry->removed) continue;
+        epicsUInt64 hash = hashName(entry->name.c_str());
+        insertIndex(table, position, hash);
+        insertFilter(table, hash);
     }
 }
 
-Data * Driver::getParamDB(std::string name) {
-    return pvDB[name];
+
+/** 
+ * RegistryReadGuard class
+ */
+RegistryReadGuard::RegistryReadGuard(PVRegistry &registry) : registry(registry) {
+    registry.enter();
 }
 
-Value * Driver::read(std::string name) {
-    if(!hasReadCallback()) return NULL;
+RegistryReadGuard::~RegistryReadGuard() {
+    registry.exit();
+}
 
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-    PVInfo *info = pv->getInfo();
-    Value *value = new Value(info->getValue()->getType(), info->getValue()->getCount());
 
-    SimpleValue simpleValue;
-    simpleValue.type = value->getType();
-    simpleValue.count = value->getCount();
-    simpleValue.buffer = value->getBuffer();
+/** 
+ * SlotRegion class
+ */
 
-    // Read data from Node.js
-    readCallback(name.c_str(), &simpleValue);
+// Types of the slot regions, int and enum PVs share the int region
+static const aitEnum slotTypes[] = { aitEnumInt32, aitEnumFloat32, aitEnumFloat64 };
+#define SLOT_REGIONS 3
 
-    if(debugLevel >= 2) {
-        std::cout << "Driver::read(): pv=" << name << ", value=" << *value << std::endl;
-    }
+SlotRegion::SlotRegion(aitEnum type) {
+    this->type = type;
 
-    return value;
+    // The size is computed without allocating a buffer
+    Value value;
+    value.setType(type);
+    value.setCount(1);
+    this->elementSize = value.calcBufferSize();
 }
 
-bool Driver::write(std::string name, Value *value) {
-    if(!hasWriteCallback()) return false;
-    if(!value) return false;
-
-    if(debugLevel >= 2) {
-        std::cout << "Driver::write(): pv=" << name << ", value=" << *value << std::endl;
+// Region of a PV type, -1 is returned if the type has no slots
+int SlotRegion::regionOf(aitEnum type) {
+    if(type == aitEnumEnum16) type = aitEnumInt32;
+    for(int region = 0; region < SLOT_REGIONS; region++) {
+        if(slotTypes[region] == type) return region;
     }
+    return -1;
+}
 
-    SimpleValue simpleValue;
-    simpleValue.type = value->getType();
-    simpleValue.count = value->getCount();
-    simpleValue.buffer = value->getBuffer();
-
-    // Write data to Node.js
-    writeCallback(name.c_str(), &simpleValue);
-    return true;
+// Add a slot for the PV, the slots are allocated at once after all PVs are added
+int SlotRegion::add(int handle) {
+    handles.push_back(handle);
+    return (int)handles.size() - 1;
 }
 
-void Driver::updatePVs() {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    for(std::map<std::string, casPV*>::iterator iter = pvList.begin(); iter != pvList.end(); ++iter) {
-        std::string name = iter->first;
-        updatePV(name);
+// Allocate the region with the initial values of the PVs, the region is never moved afterwards
+void SlotRegion::allocate(PVRegistry &registry) {
+    values.resize(handles.size() * elementSize);
+    committed.resize(handles.size() * elementSize);
+    seqs.assign(handles.size(), 0);
+    for(int slot = 0; slot < size(); slot++) {
+        void *initial = registry.get(handles[slot])->info->getValue()->getBuffer();
+        memcpy(&values[slot * elementSize], initial, elementSize);
+        memcpy(&committed[slot * elementSize], initial, elementSize);
     }
 }
 
-void Driver::updatePV(std::string name) {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-    PVInfo *info = pv->getInfo();
-    if(pvDB[name]->getFlag() == true && info->getScan() == 0) {
-        pvDB[name]->setFlag(false);
-        pv->updateValue(pvDB[name]);
-        pvDB[name]->setMask(0);
+void SlotRegion::getInfo(SlotInfo *info) {
+    info->values = values.empty() ? NULL : &values[0];
+    info->seqs = seqs.empty() ? NULL : &seqs[0];
+    info->count = size();
+    info->elementSize = elementSize;
+}
+
+int SlotRegion::size() {
+    return (int)handles.size();
+}
+
+int SlotRegion::getHandle(int slot) {
+    return handles[slot];
+}
 
-        if(debugLevel >= 2) {
-            std::cout << "Driver::updatePV(): PV " << name << " updated" << std::endl;
+// Copy a slot into buffer under its sequence counter, false is returned if the slot is being written,
+// or if it did not change since it was last taken unless force is true
+bool SlotRegion::take(int slot, void *buffer, bool force) {
+    char *value = &values[slot * elementSize];
+    bool consistent = false;
+    for(int retry = 0; retry < SEQLOCK_RETRIES; retry++) {
+        int start = epicsAtomicGetIntT(&seqs[slot]);
+        if(start & 1) continue;
+        epicsAtomicReadMemoryBarrier();
+        memcpy(buffer, value, elementSize);
+        epicsAtomicReadMemoryBarrier();
+        if(epicsAtomicGetIntT(&seqs[slot]) == start) {
+            consistent = true;
+            break;
         }
     }
+    if(!consistent) return false;
+
+    char *last = &committed[slot * elementSize];
+    if(!force && memcmp(buffer, last, elementSize) == 0) return false;
+    memcpy(last, buffer, elementSize);
+    return true;
 }
 
 
 /** 
- * PVInfo class
+ * RequestQueue class
  */
-PVInfo::PVInfo(pvDef *pv) {
-    name = pv->name;
-    scan = pv->scan;
+RequestQueue::RequestQueue(PVRegistry &registry) : registry(registry) {
+    wakeupCallback = NULL;
+    kinds = 0;
+    head = NULL;
+    armed = 0;
+    depth = 0;
+    maxDepth = 0;
+    pending = NULL;
+    drained = 0;
+    batches = 0;
+    maxBatch = 0;
+    totalWait = 0;
+    maxWait = 0;
+}
 
-    // Initialize enums, the terminator is null
-    for(char **ptr = pv->enums; *ptr; ptr++) {
-        std::string str = *ptr;
-        enums.push_back(str);
+void RequestQueue::installWakeupCallback(WakeupCallback wakeupCallback, int kinds) {
+    this->wakeupCallback = wakeupCallback;
+    this->kinds = wakeupCallback != NULL ? kinds : 0;
+}
+
+bool RequestQueue::isEnabled(RequestKind kind) {
+    return (kinds & (1 << kind)) != 0;
+}
+
+// Push a request from any thread, Node.js is woken up unless it has not drained the queue since the last wakeup
+void RequestQueue::push(Request *request) {
+    request->queued = epicsTime::getCurrent();
+
+    int current = epicsAtomicIncrIntT(&depth);
+    int last = epicsAtomicGetIntT(&maxDepth);
+    while(current > last) {
+        int seen = epicsAtomicCmpAndSwapIntT(&maxDepth, last, current);
+        if(seen == last) break;
+        last = seen;
     }
 
-    // Initialize states, the terminator is -1
-    for(int *ptr = pv->states; *ptr != -1; ptr++) {
-        epicsAlarmSeverity severity = (epicsAlarmSeverity)(*ptr);
-        states.push_back(severity);
+    EpicsAtomicPtrT old;
+    do {
+        old = epicsAtomicGetPtrT(&head);
+        request->next = (Request *)old;
+    } while(epicsAtomicCmpAndSwapPtrT(&head, old, request) != old);
+
+    if(epicsAtomicCmpAndSwapIntT(&armed, 0, 1) == 0) {
+        wakeupCallback();
     }
+}
 
-    prec = pv->prec;
-    unit = pv->unit;
-    hilim = pv->hilim;
-    lolim = pv->lolim;
-    high = pv->high;
-    low = pv->low;
-    hihi = pv->hihi;
-    lolo = pv->lolo;
-    mdel = pv->mdel;
-    adel = pv->adel;
-    soft = pv->soft;
+// Take the oldest request, the stack of the producers is taken at once and reversed into the pending list
+Request * RequestQueue::pop() {
+    if(pending == NULL) {
+        EpicsAtomicPtrT old;
+        do {
+            old = epicsAtomicGetPtrT(&head);
+            if(old == NULL) return NULL;
+        } while(epicsAtomicCmpAndSwapPtrT(&head, old, NULL) != old);
+
+        Request *request = (Request *)old;
+        while(request != NULL) {
+            Request *next = request->next;
+            request->next = pending;
+            pending = request;
+            request = next;
+        }
+    }
 
-    valid_low_high = false;
-    valid_lolo_hihi = false;
-    validateLimit();
+    Request *request = pending;
+    pending = request->next;
+    return request;
+}
 
-    aitEnum type = (aitEnum)pv->type;
-    value = new Value(type, pv->count, pv->value);
-    mlst = new Value(type, pv->count, pv->value);
-    alst = new Value(type, pv->count, pv->value);
+// Drain up to max requests into infos, this is only called by Node.js
+// The requests of the previous drain are released first, since Node.js referenced their buffers until now
+// If fewer than max requests are returned the queue is empty, and the next push wakes up Node.js again
+int RequestQueue::drain(RequestInfo *infos, int max) {
+    for(size_t i = 0; i < batch.size(); i++) {
+        if(batch[i]->value != NULL) {
+            releaseValueAndBuffer(batch[i]->value);
+        }
+        delete batch[i];
+    }
+    batch.clear();
+
+    epicsTime now = epicsTime::getCurrent();
+    int count = 0;
+    while(count < max) {
+        Request *request = pop();
+        if(request == NULL) {
+            // Disarm before looking again, so a request pushed in between is either taken here or wakes up Node.js
+            epicsAtomicSetIntT(&armed, 0);
+            request = pop();
+            if(request == NULL) break;
+            epicsAtomicSetIntT(&armed, 1);
+        }
+        epicsAtomicDecrIntT(&depth);
+        batch.push_back(request);
+
+        double wait = now - request->queued;
+        totalWait += wait;
+        if(wait > maxWait) {
+            maxWait = wait;
+        }
+
+        // A request of a PV whose index has been reused is dropped, its asynchronous IO is already gone
+        PVEntry *entry = request->handle >= 0 ? registry.at(request->handle) : NULL;
+        if(request->handle >= 0 && entry == NULL) continue;
+
+        RequestInfo *info = infos + count;
+        info->kind = request->kind;
+        info->id = request->id;
+        info->name = entry != NULL ? entry->name.c_str() : NULL;
+        info->value.type = request->value != NULL ? request->value->getType() : aitEnumInvalid;
+        info->value.count = request->value != NULL ? request->value->getCount() : 0;
+        info->value.buffer = request->value != NULL ? request->value->getBuffer() : NULL;
+        info->reads = request->reads;
+        info->count = request->count;
+        count++;
+    }
+
+    if(count > 0) {
+        drained += count;
+        batches++;
+        if(count > maxBatch) {
+            maxBatch = count;
+        }
+    }
+
+    if(tracing() && count > 0) {
+        logger->log(logDrain, -1, count);
+    }
+
+    return count;
 }
 
-std::string PVInfo::getName() { 
-    return name;
+// The counters of the consumer side are read by Node.js, which is the only consumer
+void RequestQueue::getStats(RequestStats *stats) {
+    stats->depth = epicsAtomicGetIntT(&depth);
+    stats->maxDepth = epicsAtomicGetIntT(&maxDepth);
+    stats->enqueued = drained + stats->depth;
+    stats->drained = drained;
+    stats->batches = batches;
+    stats->maxBatch = maxBatch;
+    stats->meanWait = drained > 0 ? totalWait / drained : 0;
+    stats->maxWait = maxWait;
 }
 
-double PVInfo::getHopr() {
-    return hilim;
+// Allocate a request for the queue, the optional value is owned by the request
+static Request * newRequest(RequestKind kind, int id, int handle) {
+    Request *request = new Request();
+    request->next = NULL;
+    request->kind = kind;
+    request->id = id;
+    request->handle = handle;
+    request->value = NULL;
+    request->reads = NULL;
+    request->count = 0;
+    return request;
 }
 
-double PVInfo::getLopr() {
-    return lolim;
+
+/** 
+ * Driver class
+ */
+Driver::Driver(PVRegistry &registry) : registry(registry), requests(registry) {
+    if(debugLevel >= 1) {
+        std::cout << "\n\n";
+        std::cout << "********** Parameter library ***********\n";
+    }
+    
+    for(int index = 0; index < registry.size(); index++) {
+        PVEntry *entry = registry.entryAt(index);
+        if(entry == NULL) continue;
+        addPV(entry);
+    }
+
+    if(debugLevel >= 1) {
+        std::cout << "****************************************\n";
+        std::cout << "\n\n";
+    }
+
+    this->readCallback = NULL;
+    this->writeCallback = NULL;
+    this->groupReadCallback = NULL;
+    this->asyncReadCallback = NULL;
+    this->asyncWriteCallback = NULL;
+    this->dirtyHead = -1;
+    this->autoUpdatePeriod = 0;
+
+    // Scalar numeric and enum PVs get a value slot in the region of their type
+    for(int region = 0; region < SLOT_REGIONS; region++) {
+        slots.push_back(new SlotRegion(slotTypes[region]));
+    }
+    for(int index = 0; index < registry.size(); index++) {
+        PVEntry *entry = registry.entryAt(index);
+        if(entry == NULL) continue;
+        Value *value = entry->info->getValue();
+        int region = SlotRegion::regionOf(value->getType());
+        if(value->getCount() == 1 && region >= 0) {
+            entry->slotRegion = region;
+            entry->slot = slots[region]->add(entry->handle);
+        }
+    }
+    for(int region = 0; region < SLOT_REGIONS; region++) {
+        slots[region]->allocate(registry);
+    }
 }
 
-std::string PVInfo::getUnits() { 
-    return unit;
+// Create the parameter of a PV, a PV added at runtime gets it before the registry publishes it
+// The value slots are allocated once, so a PV added at runtime has no value slot
+void Driver::addPV(PVEntry *entry) {
+    PVInfo *info = entry->info;
+    Data *data = new Data();
+    data->initValue(info->getValue()->getType(), info->getValue()->getCount(), info->getValue()->getBuffer());
+    entry->data = data;
+
+    if(debugLevel >= 1) {
+        std::cout << entry->name << ", {" << *data << "}\n\n";
+    }
 }
 
-double PVInfo::getHighWarning() {
-    return high;
+void Driver::installCallback(ReadCallback readCallback, WriteCallback writeCallback) {
+    if(readCallback != NULL)
+        this->readCallback = readCallback;
+    if(writeCallback != NULL)
+        this->writeCallback = writeCallback;
 }
 
-double PVInfo::getLowWarning() {
-    return low;
+void Driver::installReadCallback(ReadCallback readCallback) {
+    if(readCallback != NULL)
+        this->readCallback = readCallback;
 }
 
-double PVInfo::getHighAlarm() {
-    return hihi;
+void Driver::installWriteCallback(WriteCallback writeCallback) {
+    if(writeCallback != NULL)
+        this->writeCallback = writeCallback;
 }
 
-double PVInfo::getLowAlarm() {
-    return lolo;
+void Driver::installGroupReadCallback(GroupReadCallback groupReadCallback) {
+    if(groupReadCallback != NULL)
+        this->groupReadCallback = groupReadCallback;
 }
 
-int PVInfo::getPrecision() {
-    return prec;
+void Driver::installAsyncReadCallback(AsyncReadCallback asyncReadCallback) {
+    this->asyncReadCallback = asyncReadCallback;
 }
 
-Value* PVInfo::getValue() {
-    return value;
+void Driver::installAsyncWriteCallback(AsyncWriteCallback asyncWriteCallback) {
+    this->asyncWriteCallback = asyncWriteCallback;
 }
 
-double PVInfo::getScan() {
-    return scan;
+// Once a wakeup callback is installed, the given kinds of requests are queued for Node.js instead of called
+void Driver::installWakeupCallback(WakeupCallback wakeupCallback, int kinds) {
+    requests.installWakeupCallback(wakeupCallback, kinds);
 }
 
-bool PVInfo::getSoft() {
-    return soft;
+bool Driver::hasReadCallback() {
+    return readCallback != NULL;
 }
 
-std::vector<std::string> PVInfo::getEnums() {
-    return enums;
+bool Driver::hasWriteCallback() {
+    return writeCallback != NULL;
 }
 
-// Validate alarm limit
-void PVInfo::validateLimit() {
-    if(low >= high) {
-        valid_low_high = false;
+bool Driver::hasGroupReadCallback() {
+    return groupReadCallback != NULL;
+}
+
+// Asynchronous reads and writes are also served by Node.js draining the request queue
+bool Driver::hasAsyncReadCallback() {
+    return asyncReadCallback != NULL || requests.isEnabled(requestRead);
+}
+
+bool Driver::hasAsyncWriteCallback() {
+    return asyncWriteCallback != NULL || requests.isEnabled(requestWrite);
+}
+
+RequestQueue & Driver::getRequests() {
+    return requests;
+}
+
+ReadCallback Driver::getReadCallback() {
+    return readCallback;
+}
+
+WriteCallback Driver::getWriteCallback() {
+    return writeCallback;
+}
+
+Value * Driver::getParam(PVEntry *entry) {
+    PVInfo *info = entry->info;
+
+    // Copy into a new value instance, which will be released later
+    Value *cloneValue = new Value(info->getValue()->getType(), info->getValue()->getCount());
+    entry->data->readValue(cloneValue, NULL, NULL, NULL);
+
+    if(tracing(entry)) {
+        logger->logValue(logGetParam, entry->handle, 0, cloneValue->getType(), cloneValue->getCount(), cloneValue->getBuffer());
+    }
+
+    return cloneValue;
+}
+
+// Copy the parameter into a buffer owned by the caller, which holds the full count of the PV type
+void Driver::getParam(PVEntry *entry, void *buffer) {
+    PVInfo *info = entry->info;
+    Value value;
+    value.setType(info->getValue()->getType());
+    value.setCount(info->getValue()->getCount());
+    value.setBuffer(buffer);
+    entry->data->readValue(&value, NULL, NULL, NULL);
+
+    if(tracing(entry)) {
+        logger->logValue(logGetParam, entry->handle, 0, value.getType(), value.getCount(), buffer);
+    }
+}
+
+void Driver::setParam(PVEntry *entry, Value *value) {
+    // A shared parameter takes over the buffer, so the payload is not copied again
+    bool adopt = entry->data->isShared();
+    _setParam(entry, value, adopt);
+
+    // Release value and buffer
+    if(adopt) {
+        releaseValue(value);
     } else {
-        valid_low_high = true;
+        releaseValueAndBuffer(value);
     }
+}
 
-    if(lolo >= hihi) {
-        valid_lolo_hihi = false;
+// Set the parameter from a buffer owned by the caller, which is copied and not taken over
+void Driver::setParam(PVEntry *entry, void *buffer) {
+    PVInfo *info = entry->info;
+    Value value;
+    value.setType(info->getValue()->getType());
+    value.setCount(info->getValue()->getCount());
+    value.setBuffer(buffer);
+    _setParam(entry, &value);
+}
+
+// Set a batch of parameters, the values are packed in the buffer according to the type and count of each PV
+int Driver::setParams(SimpleParam *params, int count, char *buffer) {
+    int updated = 0;
+    for(int i = 0; i < count; i++) {
+        SimpleParam *param = params + i;
+        PVEntry *entry = registry.get(param->name);
+        if(entry == NULL) {
+            std::cout << "setParams(): Unknown PV " << param->name << std::endl;
+            continue;
+        }
+
+        // Wrap the packed data without copying, the buffer is owned by the caller
+        PVInfo *info = entry->info;
+        Value value;
+        value.setType(info->getValue()->getType());
+        value.setCount(info->getValue()->getCount());
+        value.setBuffer(buffer + param->offset);
+
+        _setParam(entry, &value);
+        updated++;
+    }
+    return updated;
+}
+
+void Driver::setParamStatus(PVEntry *entry, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
+    Data *data = entry->data;
+    data->beginUpdate();
+
+    if(tracing(entry)) {
+        if(alarm != data->getAlarm() || severity != data->getSeverity()) {
+            logger->logStatus(logSetStatus, entry->handle, alarm, severity);
+        }
+    }
+
+    if(alarm != data->getAlarm()) {
+        data->setAlarm(alarm);
+        data->setMask(data->getMask() | DBE_ALARM);
+        raiseFlag(entry);
+    }
+    if(severity != data->getSeverity()) {
+        data->setSeverity(severity);
+        data->setMask(data->getMask() | DBE_ALARM);
+        raiseFlag(entry);
+    }
+    data->endUpdate();
+}
+
+// Update the parameter library with value, the ownership of value is not taken
+// If adopt is true, the pooled buffer of value is taken over by a shared parameter instead of copied
+void Driver::_setParam(PVEntry *entry, Value *value, bool adopt) {
+    PVInfo *info = entry->info;
+    Data *data = entry->data;
+    PCAS_TRACE3(set_param_entry, entry->handle, entry->name.c_str(), info->getValue()->getCount());
+
+    if(tracing(entry)) {
+        // The type and count in value is not guaranteed to be consistent with PV info
+        logger->logValue(logSetParam, entry->handle, 0, info->getValue()->getType(), info->getValue()->getCount(), value->getBuffer());
+    }
+
+    if(serverStats != NULL) {
+        ServerStats::local()->sets++;
+    }
+
+    data->beginUpdate();
+    data->setMask(data->getMask() | info->checkValue(value));
+    if(adopt) {
+        data->adoptValue(value);
     } else {
-        valid_lolo_hihi = true;
+        data->copyValue(value);
+    }
+    data->setTimeStampToCurrent();
+    if(data->getMask()) {
+        raiseFlag(entry);
     }
+    epicsAlarmCondition alarm;
+    epicsAlarmSeverity severity;
+    info->checkAlarm(value, &alarm, &severity);
+    setParamStatus(entry, alarm, severity);
+    data->endUpdate();
+    PCAS_TRACE3(set_param_return, entry->handle, entry->name.c_str(), info->getValue()->getCount());
 }
 
-// Check value change event
-unsigned int PVInfo::checkValue(Value *newValue) {
-    unsigned int mask = 0;
-    void *buffer = newValue->getBuffer();
-    
-    // Array type always gets notified
-    if(value->getCount() > 1) {
-        mask = DBE_VALUE | DBE_LOG;
-        return mask;
-    } 
-    
-    aitEnum type = value->getType();
+// Set scalar data by PV handle, the value is converted to the PV type without allocation
+void Driver::setParamDouble(int handle, double value) {
+    PVEntry *entry = registry.get(handle);
+    if(entry == NULL) {
+        std::cout << "setParamDouble(): Invalid PV handle " << handle << std::endl;
+        return;
+    }
+
+    PVInfo *info = entry->info;
+    aitEnum type = info->getValue()->getType();
+    union { int i; float f; double d; } scratch;
     switch(type) {
         case aitEnumInt32:
-            if(abs(*(int *)mlst->getBuffer() - *(int *)buffer) > mdel) {
-                mask |= DBE_VALUE;
-                *(int *)mlst->getBuffer() = *(int *)buffer;
-            }
-            if(abs(*(int *)alst->getBuffer() - *(int *)buffer) > adel) {
-                mask |= DBE_LOG;
-                *(int *)alst->getBuffer() = *(int *)buffer;
-            }
+        case aitEnumEnum16:
+            scratch.i = (int)value;
             break;
         case aitEnumFloat32:
-            if(fabs(*(float *)mlst->getBuffer() - *(float *)buffer) > mdel) {
-                mask |= DBE_VALUE;
-                *(float *)mlst->getBuffer() = *(float *)buffer;
-            }
-            if(fabs(*(float *)alst->getBuffer() - *(float *)buffer) > adel) {
-                mask |= DBE_LOG;
-                *(float *)alst->getBuffer() = *(float *)buffer;
-            }
+            scratch.f = (float)value;
             break;
         case aitEnumFloat64:
-            if(fabs(*(double *)mlst->getBuffer() - *(double *)buffer) > mdel) {
-                mask |= DBE_VALUE;
-                *(double *)mlst->getBuffer() = *(double *)buffer;
-            }
-            if(fabs(*(double *)alst->getBuffer() - *(double *)buffer) > adel) {
-                mask |= DBE_LOG;
-                *(double *)alst->getBuffer() = *(double *)buffer;
-            }
-            break;
-        case aitEnumString:
-            if(strcmp((char *)mlst->getBuffer(), (char *)buffer) != 0) {
-                mask |= DBE_VALUE;
-                memcpy(mlst->getBuffer(), buffer, MAX_STRING_SIZE);
-            }
-            if(strcmp((char *)alst->getBuffer(), (char *)buffer) != 0) {
-                mask |= DBE_VALUE;
-                memcpy(alst->getBuffer(), buffer, MAX_STRING_SIZE);
-            }
-            break;
-        case aitEnumEnum16:
-            if(*(int *)mlst->getBuffer() != *(int *)buffer) {
-                mask |= DBE_VALUE;
-                *(int *)mlst->getBuffer() = *(int *)buffer;
-            }
-            if(*(int *)alst->getBuffer() != *(int *)buffer) {
-                mask |= DBE_LOG;
-                *(int *)alst->getBuffer() = *(int *)buffer;
-            }
+            scratch.d = value;
             break;
         default:
-            std::cout << "checkValue(): Unknown PV type " << type << std::endl;
-            break;
+            std::cout << "setParamDouble(): Unsupported PV type " << type << " for PV " << entry->name << std::endl;
+            return;
+    }
+    if(info->getValue()->getCount() != 1) {
+        std::cout << "setParamDouble(): PV " << entry->name << " is not a scalar" << std::endl;
+        return;
     }
 
-    return mask;
+    Value wrapper;
+    wrapper.setType(type);
+    wrapper.setCount(1);
+    wrapper.setBuffer(&scratch);
+    _setParam(entry, &wrapper);
 }
 
-void PVInfo::checkAlarm(Value *newValue, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
-    aitEnum type = value->getType();
-    void *buffer = newValue->getBuffer();
-
-    // Array type does not raise alarm
-    if(value->getCount() > 1) {
-        *alarm = epicsAlarmNone;
-        *severity = epicsSevNone;
+void Driver::setParamInt32(int handle, int value) {
+    PVEntry *entry = registry.get(handle);
+    if(entry == NULL) {
+        std::cout << "setParamInt32(): Invalid PV handle " << handle << std::endl;
         return;
-    } 
+    }
 
+    PVInfo *info = entry->info;
+    aitEnum type = info->getValue()->getType();
+    union { int i; float f; double d; } scratch;
     switch(type) {
         case aitEnumInt32:
-            _checkNumericAlarm(*(int *)buffer, alarm, severity);
+        case aitEnumEnum16:
+            scratch.i = value;
             break;
         case aitEnumFloat32:
-            _checkNumericAlarm(*(float *)buffer, alarm, severity);
+            scratch.f = (float)value;
             break;
         case aitEnumFloat64:
-            _checkNumericAlarm(*(double *)buffer, alarm, severity);
-            break;
-        case aitEnumString:
-            *alarm = epicsAlarmNone;
-            *severity = epicsSevNone;
+            scratch.d = (double)value;
             break;
+        default:
+            std::cout << "setParamInt32(): Unsupported PV type " << type << " for PV " << entry->name << std::endl;
+            return;
+    }
+    if(info->getValue()->getCount() != 1) {
+        std::cout << "setParamInt32(): PV " << entry->name << " is not a scalar" << std::endl;
+        return;
+    }
+
+    Value wrapper;
+    wrapper.setType(type);
+    wrapper.setCount(1);
+    wrapper.setBuffer(&scratch);
+    _setParam(entry, &wrapper);
+}
+
+// Get the first element by PV handle converted to double, no clone is made
+double Driver::getParamDouble(int handle) {
+    PVEntry *entry = registry.get(handle);
+    if(entry == NULL) {
+        std::cout << "getParamDouble(): Invalid PV handle " << handle << std::endl;
+        return 0;
+    }
+
+    // The type is checked before reading, the scratch only holds one numeric element
+    aitEnum type = entry->info->getValue()->getType();
+    if(type != aitEnumInt32 && type != aitEnumEnum16 && type != aitEnumFloat32 && type != aitEnumFloat64) {
+        std::cout << "getParamDouble(): Unsupported PV type " << type << " for PV " << entry->name << std::endl;
+        return 0;
+    }
+
+    // Only the first element of an array PV is read
+    union { int i; float f; double d; } scratch;
+    Value wrapper;
+    wrapper.setType(type);
+    wrapper.setCount(1);
+    wrapper.setBuffer(&scratch);
+    entry->data->readValue(&wrapper, NULL, NULL, NULL);
+
+    switch(type) {
+        case aitEnumInt32:
         case aitEnumEnum16:
-            _checkEnumAlarm(*(int *)buffer, alarm, severity);
-            break;
+            return scratch.i;
+        case aitEnumFloat32:
+            return scratch.f;
         default:
-            std::cout << "checkAlarm(): Unknown PV type " << type << std::endl;
-            break;
+            return scratch.d;
     }
 }
 
-void PVInfo::_checkNumericAlarm(double value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
-    *alarm = epicsAlarmNone;
-    *severity = epicsSevNone;
+int Driver::getParamInt32(int handle) {
+    PVEntry *entry = registry.get(handle);
+    if(entry == NULL) {
+        std::cout << "getParamInt32(): Invalid PV handle " << handle << std::endl;
+        return 0;
+    }
 
-    if(valid_low_high) {
-        if(value <= low) {
-            *alarm = epicsAlarmLow;
-            *severity = epicsSevMinor;
-        } else if(value >= high) {
-            *alarm = epicsAlarmHigh;
-            *severity = epicsSevMinor;
-        }
+    // The type is checked before reading, the scratch only holds one numeric element
+    aitEnum type = entry->info->getValue()->getType();
+    if(type != aitEnumInt32 && type != aitEnumEnum16 && type != aitEnumFloat32 && type != aitEnumFloat64) {
+        std::cout << "getParamInt32(): Unsupported PV type " << type << " for PV " << entry->name << std::endl;
+        return 0;
     }
-    if(valid_lolo_hihi) {
-        if(value <= lolo) {
-            *alarm = epicsAlarmLoLo;
-            *severity = epicsSevMajor;
-        } else if(value >= hihi) {
-            *alarm = epicsAlarmHiHi;
-            *severity = epicsSevMajor;
-        }
+
+    // Only the first element of an array PV is read
+    union { int i; float f; double d; } scratch;
+    Value wrapper;
+    wrapper.setType(type);
+    wrapper.setCount(1);
+    wrapper.setBuffer(&scratch);
+    entry->data->readValue(&wrapper, NULL, NULL, NULL);
+
+    switch(type) {
+        case aitEnumInt32:
+        case aitEnumEnum16:
+            return scratch.i;
+        case aitEnumFloat32:
+            return (int)scratch.f;
+        default:
+            return (int)scratch.d;
     }
 }
 
-void PVInfo::_checkEnumAlarm(int value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
-    if(value >= 0 && value < states.size()) {
-        *severity = states[value];
-        if(*severity == epicsSevNone) {
-            *alarm = epicsAlarmNone;
-        } else {
-            *alarm = epicsAlarmState;
-        }
+Value * Driver::read(PVEntry *entry) {
+    if(!hasReadCallback()) return NULL;
+
+    PVInfo *info = entry->info;
+    Value *value = new Value(info->getValue()->getType(), info->getValue()->getCount());
+
+    SimpleValue simpleValue;
+    simpleValue.type = value->getType();
+    simpleValue.count = value->getCount();
+    simpleValue.buffer = value->getBuffer();
+
+    // Read data from Node.js
+    PCAS_TRACE3(callback_read_entry, entry->handle, entry->name.c_str(), simpleValue.count);
+    if(serverStats != NULL) {
+        epicsTime start = epicsTime::getCurrent();
+        readCallback(entry->name.c_str(), &simpleValue);
+        StatsCounters *counters = ServerStats::local();
+        counters->reads++;
+        ServerStats::recordLatency(counters->readBuckets, &counters->readTime, epicsTime::getCurrent() - start);
     } else {
-        *alarm = epicsAlarmState;
-        *severity = epicsSevMajor;
+        readCallback(entry->name.c_str(), &simpleValue);
     }
+    PCAS_TRACE3(callback_read_return, entry->handle, entry->name.c_str(), simpleValue.count);
+
+    if(tracing(entry)) {
+        logger->logValue(logRead, entry->handle, 0, value->getType(), value->getCount(), value->getBuffer());
+    }
+
+    return value;
 }
 
-std::ostream & operator << (std::ostream &out, const PVInfo &info) {
-    out << "name=" << info.name << ", ";
-    out << "type=" << info.value->getType() << ", ";
-    out << "count=" << info.value->getCount() << ", ";
-    out << "scan=" << info.scan << ", ";
+// Read all PVs of a scan tick from Node.js in one call, the value buffers are filled in place
+void Driver::groupRead(SimpleRead *reads, int count) {
+    if(groupReadCallback == NULL || count == 0) return;
 
-    out << "enums=[";
-    for(int i = 0; i < info.enums.size(); i++) {
-        out << info.enums[i];
-        if(i < info.enums.size() - 1) {
-            out << ",";
-        }
+    // Read data from Node.js
+    if(serverStats != NULL) {
+        epicsTime start = epicsTime::getCurrent();
+        groupReadCallback(reads, count);
+        StatsCounters *counters = ServerStats::local();
+        counters->reads++;
+        ServerStats::recordLatency(counters->readBuckets, &counters->readTime, epicsTime::getCurrent() - start);
+    } else {
+        groupReadCallback(reads, count);
     }
-    out << "]" << ", ";
 
-    out << "states=[";
-    for(int i = 0; i < info.states.size(); i++) {
-        out << SeverityStrings[info.states[i]];
-        if(i < info.states.size() - 1) {
-            out << ",";
+    if(logger != NULL) {
+        for(int i = 0; i < count; i++) {
+            PVEntry *entry = registry.get(reads[i].handle);
+            if(tracing(entry)) {
+                logger->logValue(logGroupRead, entry->handle, 0, (aitEnum)reads[i].value.type, reads[i].value.count, reads[i].value.buffer);
+            }
         }
     }
-    out << "]" << ", ";
-
-    out << "prec=" << info.prec << ", ";
-    out << "unit=" << info.unit << ", ";
-    out << "hilim=" << info.hilim << ", ";
-    out << "lolim=" << info.lolim << ", ";
-    out << "high=" << info.high << ", ";
-    out << "low=" << info.low << ", ";
-    out << "hihi=" << info.hihi << ", ";
-    out << "lolo=" << info.lolo << ", ";
-    out << "mdel=" << info.mdel << ", ";
-    out << "adel=" << info.adel << ", ";
-    out << "soft=" << info.soft << ", ";
-    out << "value=" << *info.value;
-    return out;
 }
 
+// Start an asynchronous read in Node.js, the callback returns immediately and the request is completed later by completeRead()
+void Driver::asyncRead(PVEntry *entry, int id) {
+    if(!hasAsyncReadCallback()) return;
 
-/** 
- * SimplePV class
- */
-SimplePV::SimplePV() {
+    if(tracing(entry)) {
+        logger->log(logAsyncRead, entry->handle, id);
+    }
+
+    if(requests.isEnabled(requestRead)) {
+        requests.push(newRequest(requestRead, id, entry->handle));
+        return;
+    }
 
+    asyncReadCallback(entry->name.c_str(), id);
 }
 
-SimplePV::SimplePV(char *name, PVInfo *info) {
-    this->name = name;
-    this->info = info;
-    this->interest = false;
+bool Driver::write(PVEntry *entry, Value *value) {
+    if(!hasWriteCallback()) return false;
+    if(!value) return false;
 
-    // if(info->getScan() > 0) {
-    //     epicsThreadCreate("scanThread",
-    //         epicsThreadPriorityMedium,
-    //         epicsThreadGetStackSize(epicsThreadStackMedium),
-    //         scanThread,
-    //         info);
-    // }
+    if(tracing(entry)) {
+        logger->logValue(logWrite, entry->handle, 0, value->getType(), value->getCount(), value->getBuffer());
+    }
 
-    if(!initialized) {
-        initFT();
+    SimpleValue simpleValue;
+    simpleValue.type = value->getType();
+    simpleValue.count = value->getCount();
+    simpleValue.buffer = value->getBuffer();
+
+    // Write data to Node.js
+    PCAS_TRACE3(callback_write_entry, entry->handle, entry->name.c_str(), simpleValue.count);
+    if(serverStats != NULL) {
+        epicsTime start = epicsTime::getCurrent();
+        writeCallback(entry->name.c_str(), &simpleValue);
+        StatsCounters *counters = ServerStats::local();
+        counters->writes++;
+        ServerStats::recordLatency(counters->writeBuckets, &counters->writeTime, epicsTime::getCurrent() - start);
+    } else {
+        writeCallback(entry->name.c_str(), &simpleValue);
     }
+    PCAS_TRACE3(callback_write_return, entry->handle, entry->name.c_str(), simpleValue.count);
+    return true;
 }
 
-SimplePV::~SimplePV() {
+// Start an asynchronous write in Node.js, the callback returns immediately and the request is completed later by completeWrite()
+void Driver::asyncWrite(PVEntry *entry, int id, Value *value) {
+    if(!hasAsyncWriteCallback()) return;
 
-}
+    if(tracing(entry)) {
+        logger->logValue(logAsyncWrite, entry->handle, id, value->getType(), value->getCount(), value->getBuffer());
+    }
 
-caStatus SimplePV::interestRegister() {
-    interest = true;
-    return S_casApp_success;
-}
+    // The value is copied, since the request may expire before Node.js drains it
+    if(requests.isEnabled(requestWrite)) {
+        Request *request = newRequest(requestWrite, id, entry->handle);
+        request->value = new Value(*value);
+        requests.push(request);
+        return;
+    }
 
-void SimplePV::interestDelete() {
-    interest = false;
+    SimpleValue simpleValue;
+    simpleValue.type = value->getType();
+    simpleValue.count = value->getCount();
+    simpleValue.buffer = value->getBuffer();
+
+    // Write data to Node.js
+    asyncWriteCallback(entry->name.c_str(), &simpleValue, id);
 }
 
-caStatus SimplePV::writeValue(const gdd &dd) {
-    Value *value = getValueFromGDD(&dd);
-    if(!info->getSoft() && driver->hasWriteCallback()) {
-        bool success = driver->write(this->name, value);
-        if(!success) {
-            driver->setParamStatus(this->name, epicsAlarmWrite, epicsSevInvalid);
+// Post the PVs on the dirty stack, the cost is linear in the number of changed PVs
+void Driver::updatePVs() {
+    epicsTime start;
+    if(serverStats != NULL) {
+        start = epicsTime::getCurrent();
+    }
+
+    int handle = drainDirty();
+    while(handle >= 0) {
+        PVEntry *entry = registry.at(handle);
+        handle = entry->nextDirty;
+
+        // The link is read before the entry is released, since a raised flag pushes it again
+        // A removed PV is dropped, its parameter may already be destroyed and its entry is recycled once released
+        bool removed = epicsAtomicGetIntT(&entry->removed) != 0;
+        epicsAtomicCmpAndSwapIntT(&entry->queued, 1, 0);
+        if(!removed) {
+            postPV(entry);
         }
     }
-    driver->setParam(this->name, value);
-    driver->updatePV(this->name);
 
-    return S_casApp_success;
+    if(serverStats != NULL) {
+        StatsCounters *counters = ServerStats::local();
+        counters->updates++;
+        counters->updateTime += epicsTime::getCurrent() - start;
+    }
 }
 
-caStatus SimplePV::read(const casCtx &ctx, gdd &prototype) {
-    return SimplePV::ft.read(*this, prototype);
-}
+// Raise the update flag of a PV, and push it onto the dirty stack unless it is already there
+// Scanned PVs are posted by the scan scheduler and never pushed
+void Driver::raiseFlag(PVEntry *entry) {
+    entry->data->setFlag(true);
+    if(entry->info->getScan() != 0) return;
+    if(epicsAtomicCmpAndSwapIntT(&entry->queued, 0, 1) != 0) return;
 
-caStatus SimplePV::write(const casCtx &ctx, const gdd &value) {
-    return writeValue(value);
+    int head = epicsAtomicGetIntT(&dirtyHead);
+    while(true) {
+        entry->nextDirty = head;
+        int prev = epicsAtomicCmpAndSwapIntT(&dirtyHead, head, entry->handle);
+        if(prev == head) break;
+        head = prev;
+    }
 }
 
-/* application function table */
-void SimplePV::initFT() {
-    if (!SimplePV::initialized)
-    {
-        SimplePV::ft.installReadFunc ("value", &SimplePV::getValue);
-        SimplePV::ft.installReadFunc ("precision", &SimplePV::getPrecision);
-        SimplePV::ft.installReadFunc ("graphicHigh", &SimplePV::getHighLimit);
-        SimplePV::ft.installReadFunc ("graphicLow", &SimplePV::getLowLimit);
-        SimplePV::ft.installReadFunc ("controlHigh", &SimplePV::getHighLimit);
-        SimplePV::ft.installReadFunc ("controlLow", &SimplePV::getLowLimit);
-        SimplePV::ft.installReadFunc ("alarmHighWarning", &SimplePV::getHighWarnLimit);
-        SimplePV::ft.installReadFunc ("alarmLowWarning", &SimplePV::getLowWarnLimit);
-        SimplePV::ft.installReadFunc ("alarmHigh", &SimplePV::getHighAlarmLimit);
-        SimplePV::ft.installReadFunc ("alarmLow", &SimplePV::getLowAlarmLimit);
-        SimplePV::ft.installReadFunc ("units", &SimplePV::getUnits);
-        SimplePV::ft.installReadFunc ("enums", &SimplePV::getEnums);
-        SimplePV::initialized = true;
+// Take the whole dirty stack at once, and return its handles linked in the order they were pushed
+int Driver::drainDirty() {
+    int head = epicsAtomicGetIntT(&dirtyHead);
+    while(head >= 0) {
+        int prev = epicsAtomicCmpAndSwapIntT(&dirtyHead, head, -1);
+        if(prev == head) break;
+        head = prev;
     }
-}
 
-caStatus SimplePV::getValue(gdd &value) {
-    aitEnum type = info->getValue()->getType();
-    if(value.primitiveType() == aitEnumInvalid) {
-        value.setPrimType(type);
+    // Reverse the stack, so PVs are posted in the order they changed
+    int first = -1;
+    while(head >= 0) {
+        PVEntry *entry = registry.at(head);
+        int next = entry->nextDirty;
+        entry->nextDirty = first;
+        first = head;
+        head = next;
     }
+    return first;
+}
 
-    Value *newValue = NULL;
-    if(info->getScan() > 0 || info->getSoft() || !driver->hasReadCallback()) {
-        newValue = driver->getParam(this->name);
-    } else if(driver->hasReadCallback()) {
-        newValue = driver->read(this->name);
+void Driver::getSlotInfo(int region, SlotInfo *info) {
+    slots[region]->getInfo(info);
+}
+
+// Set the parameter of a PV from its value slot, false is returned if the slot is being written or did not change
+bool Driver::commitSlot(PVEntry *entry, bool force) {
+    epicsFloat64 buffer;
+    if(!slots[entry->slotRegion]->take(entry->slot, &buffer, force)) {
+        return false;
     }
 
-    if(newValue == NULL) {
-        return S_casApp_undefined;
+    Value value;
+    value.setType(entry->info->getValue()->getType());
+    value.setCount(1);
+    value.setBuffer(&buffer);
+    _setParam(entry, &value);
+    return true;
+}
+
+// Commit the slots of the given PVs and post the changed PVs, the number of committed PVs is returned
+int Driver::commit(int *handles, int count) {
+    int committed = 0;
+    for(int i = 0; i < count; i++) {
+        PVEntry *entry = registry.get(handles[i]);
+        if(entry == NULL || entry->slot < 0) {
+            std::cout << "commit(): PV handle " << handles[i] << " has no value slot" << std::endl;
+            continue;
+        }
+        if(commitSlot(entry, true)) committed++;
     }
+    updatePVs();
+    return committed;
+}
 
-    putValueToGDD(&value, newValue);
-    
-    Data *data = driver->getParamDB(this->name);
-    value.setStatSevr(data->getAlarm(), data->getSeverity());
-    value.setTimeStamp(data->getTimeStamp());
-    
-    return S_casApp_success;
-};
+// Commit every slot written since it was last committed and post the changed PVs
+int Driver::commitAll() {
+    int committed = 0;
+    for(int region = 0; region < SLOT_REGIONS; region++) {
+        SlotRegion *slotRegion = slots[region];
+        for(int slot = 0; slot < slotRegion->size(); slot++) {
+            PVEntry *entry = registry.get(slotRegion->getHandle(slot));
+            if(entry == NULL) continue;
+            if(commitSlot(entry, false)) committed++;
+        }
+    }
+    updatePVs();
+    return committed;
+}
 
-caStatus SimplePV::getPrecision(gdd &prec) {
-    prec.putConvert(info->getPrecision());
-    return S_casApp_success;
-};
+// Post changed PVs from the server thread every period seconds, 0 disables it
+void Driver::setAutoUpdate(double period) {
+    autoUpdatePeriod = period > 0 ? period : 0;
+}
 
-caStatus SimplePV::getHighLimit(gdd &hilim) {
-    hilim.putConvert(info->getHopr());
-    return S_casApp_success;
-};
+double Driver::getAutoUpdate() {
+    return autoUpdatePeriod;
+}
 
-caStatus SimplePV::getLowLimit(gdd &lolim) {
-    lolim.putConvert(info->getLopr());
-    return S_casApp_success;
-};
+void Driver::updatePV(PVEntry *entry) {
+    if(entry->info->getScan() == 0) {
+        postPV(entry);
+    }
+}
 
-caStatus SimplePV::getHighWarnLimit(gdd &hilim) {
-    hilim.putConvert(info->getHighWarning());
-    return S_casApp_success;
-};
+// The only path posting update events, which may be called from any thread
+// If another thread is posting the PV, the raised flag is left to it, so posts of a PV are serialized without waiting
+// With a rate limit, an update held back is coalesced with later ones and delivered by a trailing post
+void Driver::postPV(PVEntry *entry) {
+    Data *data = entry->data;
+    double interval = entry->info->getPostInterval();
+    while(data->beginPost()) {
+        Snapshot snapshot;
+        bool changed = data->takeUpdate(&snapshot, interval);
+        if(changed) {
+            entry->pv->updateValue(&snapshot);
+
+            if(tracing(entry)) {
+                logger->log(logPost, entry->handle, 0);
+            }
+        }
+        data->endPost();
 
-caStatus SimplePV::getLowWarnLimit(gdd &lolim) {
-    lolim.putConvert(info->getLowWarning());
-    return S_casApp_success;
-};
+        // An update raised while posting was left to this thread, and an update held back is left to the trailing post
+        double wait;
+        if(!data->hasUpdate(interval, &wait)) break;
+        if(wait > 0) {
+            entry->pv->schedulePost(wait);
+            break;
+        }
+    }
+}
 
-caStatus SimplePV::getHighAlarmLimit(gdd &hilim) {
-    hilim.putConvert(info->getHighAlarm());
-    return S_casApp_success;
-};
 
-caStatus SimplePV::getLowAlarmLimit(gdd &lolim) {
-    lolim.putConvert(info->getLowAlarm());
-    return S_casApp_success;
-};
+/** 
+ * Deadband kernels for arrays, true is returned as soon as any element exceeds the deadband
+ * The elements are compared in double precision, 8 at a time with SSE2
+ */
+static inline bool exceedsDeadband(double last, double next, double threshold, bool relative) {
+    return fabs(next - last) > (relative ? threshold * fabs(last) : threshold);
+}
 
-caStatus SimplePV::getUnits(gdd &units) {
-    units.putConvert(aitString(info->getUnits().c_str()));
-    return S_casApp_success;
-};
+#ifdef PCAS_SSE2
+static inline __m128d exceedsDeadband(__m128d last, __m128d next, __m128d threshold, bool relative) {
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    __m128d diff = _mm_andnot_pd(signMask, _mm_sub_pd(next, last));
+    __m128d limit = relative ? _mm_mul_pd(threshold, _mm_andnot_pd(signMask, last)) : threshold;
+    return _mm_cmpgt_pd(diff, limit);
+}
+#endif
+
+static bool exceedsDeadbandInt32(const int *last, const int *next, int count, double threshold, bool relative) {
+    int i = 0;
+#ifdef PCAS_SSE2
+    __m128d t = _mm_set1_pd(threshold);
+    for(; i + 8 <= count; i += 8) {
+        __m128i l0 = _mm_loadu_si128((const __m128i *)(last + i));
+        __m128i l1 = _mm_loadu_si128((const __m128i *)(last + i + 4));
+        __m128i n0 = _mm_loadu_si128((const __m128i *)(next + i));
+        __m128i n1 = _mm_loadu_si128((const __m128i *)(next + i + 4));
+        __m128d m = exceedsDeadband(_mm_cvtepi32_pd(l0), _mm_cvtepi32_pd(n0), t, relative);
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtepi32_pd(_mm_shuffle_epi32(l0, 0x4e)), _mm_cvtepi32_pd(_mm_shuffle_epi32(n0, 0x4e)), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtepi32_pd(l1), _mm_cvtepi32_pd(n1), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtepi32_pd(_mm_shuffle_epi32(l1, 0x4e)), _mm_cvtepi32_pd(_mm_shuffle_epi32(n1, 0x4e)), t, relative));
+        if(_mm_movemask_pd(m)) return true;
+    }
+#endif
+    for(; i < count; i++) {
+        if(exceedsDeadband(last[i], next[i], threshold, relative)) return true;
+    }
+    return false;
+}
 
-caStatus SimplePV::getEnums(gdd &enums) {
-    int count = info->getEnums().size();
-    enums.setDimension(1);
-    enums.setBound(0, 0, count);
+static bool exceedsDeadbandFloat32(const float *last, const float *next, int count, double threshold, bool relative) {
+    int i = 0;
+#ifdef PCAS_SSE2
+    __m128d t = _mm_set1_pd(threshold);
+    for(; i + 8 <= count; i += 8) {
+        __m128 l0 = _mm_loadu_ps(last + i);
+        __m128 l1 = _mm_loadu_ps(last + i + 4);
+        __m128 n0 = _mm_loadu_ps(next + i);
+        __m128 n1 = _mm_loadu_ps(next + i + 4);
+        __m128d m = exceedsDeadband(_mm_cvtps_pd(l0), _mm_cvtps_pd(n0), t, relative);
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtps_pd(_mm_movehl_ps(l0, l0)), _mm_cvtps_pd(_mm_movehl_ps(n0, n0)), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtps_pd(l1), _mm_cvtps_pd(n1), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_cvtps_pd(_mm_movehl_ps(l1, l1)), _mm_cvtps_pd(_mm_movehl_ps(n1, n1)), t, relative));
+        if(_mm_movemask_pd(m)) return true;
+    }
+#endif
+    for(; i < count; i++) {
+        if(exceedsDeadband(last[i], next[i], threshold, relative)) return true;
+    }
+    return false;
+}
 
-    aitString *d = new aitString[count];
-    for(int i = 0; i < count; i++) {
-        *(d + i) = aitString(info->getEnums()[i].c_str());
+static bool exceedsDeadbandFloat64(const double *last, const double *next, int count, double threshold, bool relative) {
+    int i = 0;
+#ifdef PCAS_SSE2
+    __m128d t = _mm_set1_pd(threshold);
+    for(; i + 8 <= count; i += 8) {
+        __m128d m = exceedsDeadband(_mm_loadu_pd(last + i), _mm_loadu_pd(next + i), t, relative);
+        m = _mm_or_pd(m, exceedsDeadband(_mm_loadu_pd(last + i + 2), _mm_loadu_pd(next + i + 2), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_loadu_pd(last + i + 4), _mm_loadu_pd(next + i + 4), t, relative));
+        m = _mm_or_pd(m, exceedsDeadband(_mm_loadu_pd(last + i + 6), _mm_loadu_pd(next + i + 6), t, relative));
+        if(_mm_movemask_pd(m)) return true;
     }
-    enums.putRef(d, new aitStringDestructor());
+#endif
+    for(; i < count; i++) {
+        if(exceedsDeadband(last[i], next[i], threshold, relative)) return true;
+    }
+    return false;
+}
 
-    return S_casApp_success;
-};
 
-const char * SimplePV::getName() const {
-    return this->name.c_str();
+/** 
+ * PVInfo class
+ */
+PVInfo::PVInfo(pvDef *pv) {
+    name = pv->name;
+    scan = pv->scan;
+
+    // Initialize enums, the terminator is null
+    for(char **ptr = pv->enums; *ptr; ptr++) {
+        std::string str = *ptr;
+        enums.push_back(str);
+    }
+    // The posts of DBR_CTRL refer to these strings, they live until the PV is gone
+    enumStrings = new aitString[enums.size()];
+    for(size_t i = 0; i < enums.size(); i++) {
+        enumStrings[i] = aitString(enums[i].c_str());
+    }
+
+    // Initialize states, the terminator is -1
+    for(int *ptr = pv->states; *ptr != -1; ptr++) {
+        epicsAlarmSeverity severity = (epicsAlarmSeverity)(*ptr);
+        states.push_back(severity);
+    }
+
+    prec = pv->prec;
+    unit = pv->unit;
+    hilim = pv->hilim;
+    lolim = pv->lolim;
+    high = pv->high;
+    low = pv->low;
+    hihi = pv->hihi;
+    lolo = pv->lolo;
+    mdel = pv->mdel;
+    adel = pv->adel;
+    soft = pv->soft;
+    maxReads = pv->maxReads;
+    readTimeout = pv->readTimeout;
+    maxWrites = pv->maxWrites;
+    writeQueue = pv->writeQueue;
+    writeTimeout = pv->writeTimeout;
+    deadband = (DeadbandMode)pv->deadband;
+    maxRate = pv->maxRate;
+
+    valid_low_high = false;
+    valid_lolo_hihi = false;
+    validateLimit();
+
+    aitEnum type = (aitEnum)pv->type;
+    value = new Value(type, pv->count, pv->value);
+    mlst = new Value(type, pv->count, pv->value);
+    alst = new Value(type, pv->count, pv->value);
 }
 
-aitEnum SimplePV::bestExternalType() const { 
-    return info->getValue()->getType();
+PVInfo::~PVInfo() {
+    delete [] enumStrings;
+    releaseValueAndBuffer(value);
+    releaseValueAndBuffer(mlst);
+    releaseValueAndBuffer(alst);
 }
 
-unsigned SimplePV::maxDimension() const {
-    int count = info->getValue()->getCount();
-    return count > 1 ? 1 : 0; 
+std::string PVInfo::getName() { 
+    return name;
 }
 
-aitIndex SimplePV::maxBound(unsigned dimension) const {
-    int count = info->getValue()->getCount();
-    return dimension == 0 ? count : 0; 
+double PVInfo::getHopr() {
+    return hilim;
 }
 
-void SimplePV::destroy() {}
+double PVInfo::getLopr() {
+    return lolim;
+}
 
-PVInfo * SimplePV::getInfo() {
-    return info;
+std::string PVInfo::getUnits() { 
+    return unit;
+}
+
+double PVInfo::getHighWarning() {
+    return high;
 }
 
-void SimplePV::updateValue(Data *data) {
-    if(!interest) return;
+double PVInfo::getLowWarning() {
+    return low;
+}
 
-    int count = info->getValue()->getCount();
-    aitEnum type = info->getValue()->getType();
+double PVInfo::getHighAlarm() {
+    return hihi;
+}
 
-    gdd * gddValue = new gdd(gddAppType_value, type);
-    Value *value = data->getValue();
-    void *buffer = value->getBuffer();
+double PVInfo::getLowAlarm() {
+    return lolo;
+}
+
+int PVInfo::getPrecision() {
+    return prec;
+}
 
-    // Clone a new value instance, which will be released later
-    Value *cloneValue = new Value(*value);
+Value* PVInfo::getValue() {
+    return value;
+}
 
-    if(count > 1) {
-        gddValue->setDimension(1);
-        gddValue->setBound(0, 0, count);
+double PVInfo::getScan() {
+    return scan;
+}
+
+bool PVInfo::getSoft() {
+    return soft;
+}
+
+int PVInfo::getMaxReads() {
+    return maxReads;
+}
+
+double PVInfo::getReadTimeout() {
+    return readTimeout;
+}
+
+int PVInfo::getMaxWrites() {
+    return maxWrites;
+}
+
+int PVInfo::getWriteQueue() {
+    return writeQueue;
+}
+
+double PVInfo::getWriteTimeout() {
+    return writeTimeout;
+}
+
+double PVInfo::getMaxRate() {
+    return maxRate;
+}
+
+// Minimum time in seconds between two posts, 0 if the rate is not limited
+double PVInfo::getPostInterval() {
+    return maxRate > 0 ? 1.0 / maxRate : 0;
+}
+
+std::vector<std::string> PVInfo::getEnums() {
+    return enums;
+}
+
+aitString * PVInfo::getEnumStrings() {
+    return enumStrings;
+}
+
+// Validate alarm limit
+void PVInfo::validateLimit() {
+    if(low >= high) {
+        valid_low_high = false;
+    } else {
+        valid_low_high = true;
     }
 
-    putValueToGDD(gddValue, cloneValue);
-    gddValue->setTimeStamp(data->getTimeStamp());
-    gddValue->setStatSevr(data->getAlarm(), data->getSeverity());
+    if(lolo >= hihi) {
+        valid_lolo_hihi = false;
+    } else {
+        valid_lolo_hihi = true;
+    }
+}
 
-    gdd *gddCtrl;
+// Check value change event
+unsigned int PVInfo::checkValue(Value *newValue) {
+    unsigned int mask = 0;
+    void *buffer = newValue->getBuffer();
+    
+    // Array type is compared with the last posted snapshots as a whole
+    if(value->getCount() > 1) {
+        int bufferSize = value->calcBufferSize();
+        if(arrayChanged(mlst, buffer, mdel)) {
+            mask |= DBE_VALUE;
+            memcpy(mlst->getBuffer(), buffer, bufferSize);
+        }
+        if(arrayChanged(alst, buffer, adel)) {
+            mask |= DBE_LOG;
+            memcpy(alst->getBuffer(), buffer, bufferSize);
+        }
+        return mask;
+    } 
+    
+    aitEnum type = value->getType();
     switch(type) {
         case aitEnumInt32:
-            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_long);
-            gddCtrl[1].putConvert(aitString(info->getUnits().c_str()));
-            gddCtrl[2].putConvert(info->getLowWarning());
-            gddCtrl[3].putConvert(info->getHighWarning());
-            gddCtrl[4].putConvert(info->getLowAlarm());
-            gddCtrl[5].putConvert(info->getHighAlarm());
-            gddCtrl[6].putConvert(info->getLopr());
-            gddCtrl[7].putConvert(info->getHopr());
-            gddCtrl[8].putConvert(info->getLopr());
-            gddCtrl[9].putConvert(info->getHopr());
-            putGDDToGDD(&gddCtrl[10], gddValue);
+            if(abs(*(int *)mlst->getBuffer() - *(int *)buffer) > mdel) {
+                mask |= DBE_VALUE;
+                *(int *)mlst->getBuffer() = *(int *)buffer;
+            }
+            if(abs(*(int *)alst->getBuffer() - *(int *)buffer) > adel) {
+                mask |= DBE_LOG;
+                *(int *)alst->getBuffer() = *(int *)buffer;
+            }
             break;
         case aitEnumFloat32:
-            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_float);
-            gddCtrl[1].putConvert(aitString(info->getUnits().c_str()));
-            gddCtrl[2].putConvert(info->getLowWarning());
-            gddCtrl[3].putConvert(info->getHighWarning());
-            gddCtrl[4].putConvert(info->getLowAlarm());
-            gddCtrl[5].putConvert(info->getHighAlarm());
-            gddCtrl[6].putConvert(info->getLopr());
-            gddCtrl[7].putConvert(info->getHopr());
-            gddCtrl[8].putConvert(info->getLopr());
-            gddCtrl[9].putConvert(info->getHopr());
-            gddCtrl[10].putConvert(info->getPrecision());
-            putGDDToGDD(&gddCtrl[11], gddValue);
+            if(fabs(*(float *)mlst->getBuffer() - *(float *)buffer) > mdel) {
+                mask |= DBE_VALUE;
+                *(float *)mlst->getBuffer() = *(float *)buffer;
+            }
+            if(fabs(*(float *)alst->getBuffer() - *(float *)buffer) > adel) {
+                mask |= DBE_LOG;
+                *(float *)alst->getBuffer() = *(float *)buffer;
+            }
             break;
         case aitEnumFloat64:
-            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_double);
-            gddCtrl[1].putConvert(aitString(info->getUnits().c_str()));
-            gddCtrl[2].putConvert(info->getLowWarning());
-            gddCtrl[3].putConvert(info->getHighWarning());
-            gddCtrl[4].putConvert(info->getLowAlarm());
-            gddCtrl[5].putConvert(info->getHighAlarm());
-            gddCtrl[6].putConvert(info->getLopr());
-            gddCtrl[7].putConvert(info->getHopr());
-            gddCtrl[8].putConvert(info->getLopr());
-            gddCtrl[9].putConvert(info->getHopr());
-            gddCtrl[10].putConvert(info->getPrecision());
-            putGDDToGDD(&gddCtrl[11], gddValue);
+            if(fabs(*(double *)mlst->getBuffer() - *(double *)buffer) > mdel) {
+                mask |= DBE_VALUE;
+                *(double *)mlst->getBuffer() = *(double *)buffer;
+            }
+            if(fabs(*(double *)alst->getBuffer() - *(double *)buffer) > adel) {
+                mask |= DBE_LOG;
+                *(double *)alst->getBuffer() = *(double *)buffer;
+            }
             break;
         case aitEnumString:
-            gddCtrl = gddValue;
+            if(strcmp((char *)mlst->getBuffer(), (char *)buffer) != 0) {
+                mask |= DBE_VALUE;
+                memcpy(mlst->getBuffer(), buffer, MAX_STRING_SIZE);
+            }
+            if(strcmp((char *)alst->getBuffer(), (char *)buffer) != 0) {
+                mask |= DBE_VALUE;
+                memcpy(alst->getBuffer(), buffer, MAX_STRING_SIZE);
+            }
             break;
         case aitEnumEnum16:
-            {
-                gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_enum);
-
-                putGDDToGDD(&gddCtrl[1], gddValue);
-
-                int enumsCount = info->getEnums().size();
-                aitString *d = new aitString[enumsCount];
-                for(int i = 0; i < enumsCount; i++) {
-                    *(d + i) = aitString(info->getEnums()[i].c_str());
-                }
-
-                // This statement with destructor will crash the server tool, so comment it
-                // gddCtrl[2].putRef(d, new aitStringDestructor());
-
-                // Use this statement without destructor instead
-                gddCtrl[2].putRef(d);
+            if(*(int *)mlst->getBuffer() != *(int *)buffer) {
+                mask |= DBE_VALUE;
+                *(int *)mlst->getBuffer() = *(int *)buffer;
+            }
+            if(*(int *)alst->getBuffer() != *(int *)buffer) {
+                mask |= DBE_LOG;
+                *(int *)alst->getBuffer() = *(int *)buffer;
             }
             break;
         default:
-            std::cout << "updateValue(): Unknown PV type " << type << std::endl;
-            gddCtrl = NULL;
+            std::cout << "checkValue(): Unknown PV type " << type << std::endl;
             break;
     }
 
-    if(gddCtrl != NULL) {
-        myPostEvent(data->getMask(), *gddCtrl);
-        gddCtrl->unreference();
-    }
+    return mask;
 }
 
-// Get Value from GDD
-Value * SimplePV::getValueFromGDD(const gdd *pGDD) {
-    aitEnum type = info->getValue()->getType();
-    int count = info->getValue()->getCount();
+// Check if an array changed since the snapshot in last according to the deadband mode of the PV
+bool PVInfo::arrayChanged(Value *last, void *buffer, double threshold) {
+    int count = value->getCount();
+    aitEnum type = value->getType();
 
-    Value *value = new Value(type, count);
-    void *buffer = value->getBuffer();
+    if(deadband == deadbandAlways) {
+        return true;
+    }
+    if(type == aitEnumString) {
+        for(int i = 0; i < count; i++) {
+            if(strncmp((char *)last->getBuffer() + i * MAX_STRING_SIZE, (char *)buffer + i * MAX_STRING_SIZE, MAX_STRING_SIZE) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if(deadband == deadbandExact || threshold <= 0) {
+        return memcmp(last->getBuffer(), buffer, value->calcBufferSize()) != 0;
+    }
 
-    aitEnum primitiveType = pGDD->primitiveType();
-    if(pGDD->isScalar()) {
-        switch(primitiveType) {
-            case aitEnumInt32:
-                {
-                    int d;
-                    pGDD->getConvert(d);
-                    *(int *)buffer = d;
-                }
-                break;
-            case aitEnumFloat32:
+    bool relative = deadband == deadbandRelative;
+    switch(type) {
+        case aitEnumInt32:
+        case aitEnumEnum16:
+            return exceedsDeadbandInt32((int *)last->getBuffer(), (int *)buffer, count, threshold, relative);
+        case aitEnumFloat32:
+            return exceedsDeadbandFloat32((float *)last->getBuffer(), (float *)buffer, count, threshold, relative);
+        case aitEnumFloat64:
+            return exceedsDeadbandFloat64((double *)last->getBuffer(), (double *)buffer, count, threshold, relative);
+        default:
+            std::cout << "arrayChanged(): Unknown PV type " << type << std::endl;
+            return true;
+    }
+}
+
+void PVInfo::checkAlarm(Value *newValue, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
+    aitEnum type = value->getType();
+    void *buffer = newValue->getBuffer();
+
+    // Array type does not raise alarm
+    if(value->getCount() > 1) {
+        *alarm = epicsAlarmNone;
+        *severity = epicsSevNone;
+        return;
+    } 
+
+    switch(type) {
+        case aitEnumInt32:
+            _checkNumericAlarm(*(int *)buffer, alarm, severity);
+            break;
+        case aitEnumFloat32:
+            _checkNumericAlarm(*(float *)buffer, alarm, severity);
+            break;
+        case aitEnumFloat64:
+            _checkNumericAlarm(*(double *)buffer, alarm, severity);
+            break;
+        case aitEnumString:
+            *alarm = epicsAlarmNone;
+            *severity = epicsSevNone;
+            break;
+        case aitEnumEnum16:
+            _checkEnumAlarm(*(int *)buffer, alarm, severity);
+            break;
+        default:
+            std::cout << "checkAlarm(): Unknown PV type " << type << std::endl;
+            break;
+    }
+}
+
+void PVInfo::_checkNumericAlarm(double value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
+    *alarm = epicsAlarmNone;
+    *severity = epicsSevNone;
+
+    if(valid_low_high) {
+        if(value <= low) {
+            *alarm = epicsAlarmLow;
+            *severity = epicsSevMinor;
+        } else if(value >= high) {
+            *alarm = epicsAlarmHigh;
+            *severity = epicsSevMinor;
+        }
+    }
+    if(valid_lolo_hihi) {
+        if(value <= lolo) {
+            *alarm = epicsAlarmLoLo;
+            *severity = epicsSevMajor;
+        } else if(value >= hihi) {
+            *alarm = epicsAlarmHiHi;
+            *severity = epicsSevMajor;
+        }
+    }
+}
+
+void PVInfo::_checkEnumAlarm(int value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity) {
+    if(value >= 0 && value < states.size()) {
+        *severity = states[value];
+        if(*severity == epicsSevNone) {
+            *alarm = epicsAlarmNone;
+        } else {
+            *alarm = epicsAlarmState;
+        }
+    } else {
+        *alarm = epicsAlarmState;
+        *severity = epicsSevMajor;
+    }
+}
+
+std::ostream & operator << (std::ostream &out, const PVInfo &info) {
+    out << "name=" << info.name << ", ";
+    out << "type=" << info.value->getType() << ", ";
+    out << "count=" << info.value->getCount() << ", ";
+    out << "scan=" << info.scan << ", ";
+
+    out << "enums=[";
+    for(int i = 0; i < info.enums.size(); i++) {
+        out << info.enums[i];
+        if(i < info.enums.size() - 1) {
+            out << ",";
+        }
+    }
+    out << "]" << ", ";
+
+    out << "states=[";
+    for(int i = 0; i < info.states.size(); i++) {
+        out << SeverityStrings[info.states[i]];
+        if(i < info.states.size() - 1) {
+            out << ",";
+        }
+    }
+    out << "]" << ", ";
+
+    out << "prec=" << info.prec << ", ";
+    out << "unit=" << info.unit << ", ";
+    out << "hilim=" << info.hilim << ", ";
+    out << "lolim=" << info.lolim << ", ";
+    out << "high=" << info.high << ", ";
+    out << "low=" << info.low << ", ";
+    out << "hihi=" << info.hihi << ", ";
+    out << "lolo=" << info.lolo << ", ";
+    out << "mdel=" << info.mdel << ", ";
+    out << "adel=" << info.adel << ", ";
+    out << "soft=" << info.soft << ", ";
+    out << "value=" << *info.value;
+    return out;
+}
+
+
+/** 
+ * SimplePV class
+ */
+SimplePV::SimplePV() {
+
+}
+
+SimplePV::SimplePV(char *name, PVInfo *info) {
+    this->name = name;
+    this->info = info;
+    this->interest = false;
+    this->handle = -1;
+    this->entry = NULL;
+    this->outstandingReads = 0;
+    this->activeWrites = 0;
+    this->trailing = 0;
+    buildCtrlCache();
+
+    // The trailing post of a rate limited PV runs on the timer queue of the server thread
+    this->postTimer = info->getMaxRate() > 0 ? &fileDescriptorManager.createTimer() : NULL;
+
+    // if(info->getScan() > 0) {
+    //     epicsThreadCreate("scanThread",
+    //         epicsThreadPriorityMedium,
+    //         epicsThreadGetStackSize(epicsThreadStackMedium),
+    //         scanThread,
+    //         info);
+    // }
+
+    if(!initialized) {
+        initFT();
+    }
+}
+
+// A PV is only deleted on the server thread after it was removed, the base class then disconnects its channels
+SimplePV::~SimplePV() {
+    if(postTimer != NULL) {
+        postTimer->destroy();
+    }
+    if(serverStats != NULL && interest) {
+        serverStats->removeMonitor();
+    }
+}
+
+caStatus SimplePV::interestRegister() {
+    if(serverStats != NULL && !interest) {
+        serverStats->addMonitor();
+    }
+    interest = true;
+    return S_casApp_success;
+}
+
+void SimplePV::interestDelete() {
+    if(serverStats != NULL && interest) {
+        serverStats->removeMonitor();
+    }
+    interest = false;
+}
+
+caStatus SimplePV::writeValue(const gdd &dd) {
+    PCAS_TRACE3(write_value_entry, handle, name.c_str(), info->getValue()->getCount());
+    PVEntry *entry = getEntry();
+    Value *value = getValueFromGDD(&dd);
+    if(!info->getSoft() && driver->hasWriteCallback()) {
+        bool success = driver->write(entry, value);
+        if(!success) {
+            driver->setParamStatus(entry, epicsAlarmWrite, epicsSevInvalid);
+        }
+    }
+    driver->setParam(entry, value);
+    driver->updatePV(entry);
+
+    PCAS_TRACE3(write_value_return, handle, name.c_str(), S_casApp_success);
+    return S_casApp_success;
+}
+
+caStatus SimplePV::read(const casCtx &ctx, gdd &prototype) {
+    PCAS_TRACE3(read_entry, handle, name.c_str(), info->getValue()->getCount());
+    caStatus status;
+    int maxReads = info->getMaxReads();
+    if(!useAsyncRead()) {
+        status = SimplePV::ft.read(*this, prototype);
+    } else if(maxReads > 0 && outstandingReads >= maxReads) {
+        // Let the server retry the request after one of the outstanding reads completes
+        status = S_casApp_postponeAsyncIO;
+    } else {
+        PVEntry *entry = getEntry();
+        int id = asyncIO->addRead(entry, ctx, prototype);
+        outstandingReads++;
+        driver->asyncRead(entry, id);
+        status = S_casApp_asyncCompletion;
+    }
+    PCAS_TRACE3(read_return, handle, name.c_str(), status);
+    return status;
+}
+
+caStatus SimplePV::write(const casCtx &ctx, const gdd &value) {
+    PCAS_TRACE3(write_entry, handle, name.c_str(), info->getValue()->getCount());
+    caStatus status;
+    int maxWrites = info->getMaxWrites();
+    bool busy = maxWrites > 0 && activeWrites >= maxWrites;
+    if(!useAsyncWrite()) {
+        status = writeValue(value);
+    } else if(busy && (int)queuedWrites.size() >= info->getWriteQueue()) {
+        // Writes beyond maxWrites wait in the queue of the PV, and the server retries the request if the queue is full
+        status = S_casApp_postponeAsyncIO;
+    } else {
+        int id = asyncIO->addWrite(getEntry(), ctx, getValueFromGDD(&value));
+        if(busy) {
+            queuedWrites.push_back(id);
+        } else {
+            startWrite(id);
+        }
+        status = S_casApp_asyncCompletion;
+    }
+    PCAS_TRACE3(write_return, handle, name.c_str(), status);
+    return status;
+}
+
+/* application function table */
+void SimplePV::initFT() {
+    if (!SimplePV::initialized)
+    {
+        SimplePV::ft.installReadFunc ("value", &SimplePV::getValue);
+        SimplePV::ft.installReadFunc ("precision", &SimplePV::getPrecision);
+        SimplePV::ft.installReadFunc ("graphicHigh", &SimplePV::getHighLimit);
+        SimplePV::ft.installReadFunc ("graphicLow", &SimplePV::getLowLimit);
+        SimplePV::ft.installReadFunc ("controlHigh", &SimplePV::getHighLimit);
+        SimplePV::ft.installReadFunc ("controlLow", &SimplePV::getLowLimit);
+        SimplePV::ft.installReadFunc ("alarmHighWarning", &SimplePV::getHighWarnLimit);
+        SimplePV::ft.installReadFunc ("alarmLowWarning", &SimplePV::getLowWarnLimit);
+        SimplePV::ft.installReadFunc ("alarmHigh", &SimplePV::getHighAlarmLimit);
+        SimplePV::ft.installReadFunc ("alarmLow", &SimplePV::getLowAlarmLimit);
+        SimplePV::ft.installReadFunc ("units", &SimplePV::getUnits);
+        SimplePV::ft.installReadFunc ("enums", &SimplePV::getEnums);
+        SimplePV::initialized = true;
+    }
+}
+
+caStatus SimplePV::getValue(gdd &value) {
+    aitEnum type = info->getValue()->getType();
+    if(value.primitiveType() == aitEnumInvalid) {
+        value.setPrimType(type);
+    }
+
+    PVEntry *entry = getEntry();
+    Value *newValue = NULL;
+    epicsAlarmCondition alarm;
+    epicsAlarmSeverity severity;
+    epicsTimeStamp time;
+    if(info->getScan() > 0 || info->getSoft() || useAsyncRead() || !driver->hasReadCallback()) {
+        // Arrays are referenced by the client response instead of copied
+        if(entry->data->isShared()) {
+            ValueBuffer *buffer = entry->data->acquireBuffer(&alarm, &severity, &time);
+            putBufferToGDD(&value, buffer);
+            value.setStatSevr(alarm, severity);
+            value.setTimeStamp(&time);
+            return S_casApp_success;
+        }
+
+        // Value, alarm and timestamp are copied together, so they are consistent with each other
+        newValue = new Value(type, info->getValue()->getCount());
+        entry->data->readValue(newValue, &alarm, &severity, &time);
+    } else if(driver->hasReadCallback()) {
+        newValue = driver->read(entry);
+        entry->data->readValue(NULL, &alarm, &severity, &time);
+    }
+
+    if(newValue == NULL) {
+        return S_casApp_undefined;
+    }
+
+    putValueToGDD(&value, newValue);
+    
+    value.setStatSevr(alarm, severity);
+    value.setTimeStamp(&time);
+    
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getPrecision(gdd &prec) {
+    prec.putConvert(info->getPrecision());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getHighLimit(gdd &hilim) {
+    hilim.putConvert(info->getHopr());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getLowLimit(gdd &lolim) {
+    lolim.putConvert(info->getLopr());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getHighWarnLimit(gdd &hilim) {
+    hilim.putConvert(info->getHighWarning());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getLowWarnLimit(gdd &lolim) {
+    lolim.putConvert(info->getLowWarning());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getHighAlarmLimit(gdd &hilim) {
+    hilim.putConvert(info->getHighAlarm());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getLowAlarmLimit(gdd &lolim) {
+    lolim.putConvert(info->getLowAlarm());
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getUnits(gdd &units) {
+    units.putConvert(aitString(info->getUnits().c_str()));
+    return S_casApp_success;
+};
+
+caStatus SimplePV::getEnums(gdd &enums) {
+    int count = info->getEnums().size();
+    enums.setDimension(1);
+    enums.setBound(0, 0, count);
+
+    aitString *d = new aitString[count];
+    for(int i = 0; i < count; i++) {
+        *(d + i) = aitString(info->getEnums()[i].c_str());
+    }
+    enums.putRef(d, new aitStringDestructor());
+
+    return S_casApp_success;
+};
+
+const char * SimplePV::getName() const {
+    return this->name.c_str();
+}
+
+aitEnum SimplePV::bestExternalType() const { 
+    return info->getValue()->getType();
+}
+
+unsigned SimplePV::maxDimension() const {
+    int count = info->getValue()->getCount();
+    return count > 1 ? 1 : 0; 
+}
+
+aitIndex SimplePV::maxBound(unsigned dimension) const {
+    int count = info->getValue()->getCount();
+    return dimension == 0 ? count : 0; 
+}
+
+void SimplePV::destroy() {}
+
+PVInfo * SimplePV::getInfo() {
+    return info;
+}
+
+void SimplePV::setEntry(PVEntry *entry) {
+    this->entry = entry;
+    this->handle = entry->handle;
+}
+
+int SimplePV::getHandle() {
+    return handle;
+}
+
+// The entry is kept while the PV exists, also after the PV has been removed from the registry
+PVEntry * SimplePV::getEntry() {
+    return entry;
+}
+
+// Post the held back update after delay seconds, a trailing post already scheduled is kept
+void SimplePV::schedulePost(double delay) {
+    if(postTimer == NULL) return;
+    if(epicsAtomicCmpAndSwapIntT(&trailing, 0, 1) != 0) return;
+
+    postTimer->start(*this, delay);
+
+    // The server thread may be waiting longer than the delay
+    if(wakeup != NULL) {
+        wakeup->signal();
+    }
+}
+
+epicsTimerNotify::expireStatus SimplePV::expire(const epicsTime &) {
+    epicsAtomicSetIntT(&trailing, 0);
+    driver->postPV(getEntry());
+    return expireStatus(noRestart);
+}
+
+// Client reads of a PV without scan are served asynchronously when Node.js provides the asynchronous read callback
+bool SimplePV::useAsyncRead() {
+    return !info->getSoft() && info->getScan() == 0 && asyncIO != NULL && driver->hasAsyncReadCallback();
+}
+
+// Complete an asynchronous read from the parameter library, which has been updated by the driver
+void SimplePV::completeRead(casAsyncReadIO *io, gdd &prototype) {
+    outstandingReads--;
+    caStatus status = SimplePV::ft.read(*this, prototype);
+    io->postIOCompletion(status, prototype);
+}
+
+void SimplePV::cancelRead() {
+    outstandingReads--;
+}
+
+// Client writes are completed asynchronously when Node.js provides the asynchronous write callback
+bool SimplePV::useAsyncWrite() {
+    return !info->getSoft() && asyncIO != NULL && driver->hasAsyncWriteCallback();
+}
+
+void SimplePV::startWrite(int id) {
+    Value *value = asyncIO->startWrite(id);
+    if(value == NULL) return;
+
+    activeWrites++;
+    driver->asyncWrite(getEntry(), id, value);
+}
+
+// Complete an asynchronous write and hand the next queued write to Node.js
+void SimplePV::completeWrite(casAsyncWriteIO *io, caStatus status) {
+    activeWrites--;
+    if(io != NULL) {
+        io->postIOCompletion(status);
+    }
+
+    int maxWrites = info->getMaxWrites();
+    while(!queuedWrites.empty() && (maxWrites <= 0 || activeWrites < maxWrites)) {
+        int id = queuedWrites.front();
+        queuedWrites.pop_front();
+        startWrite(id);
+    }
+}
+
+// Post the snapshot taken from the parameter library, the value of the snapshot is released here
+void SimplePV::updateValue(Snapshot *snapshot) {
+    if(!interest) {
+        if(snapshot->buffer != NULL) {
+            snapshot->buffer->release();
+        } else {
+            releaseValueAndBuffer(snapshot->value);
+        }
+        return;
+    }
+
+    int count = info->getValue()->getCount();
+    aitEnum type = info->getValue()->getType();
+    PCAS_TRACE3(update_value_entry, handle, name.c_str(), count);
+
+    // The gdd comes from the free list of the gdd library, which only grows until the steady state is reached
+    gdd * gddValue = new gdd(gddAppType_value, type);
+
+    if(count > 1) {
+        gddValue->setDimension(1);
+        gddValue->setBound(0, 0, count);
+    }
+
+    if(snapshot->buffer != NULL) {
+        putBufferToGDD(gddValue, snapshot->buffer);
+    } else {
+        putValueToGDD(gddValue, snapshot->value);
+    }
+    gddValue->setTimeStamp(&snapshot->time);
+    gddValue->setStatSevr(snapshot->alarm, snapshot->severity);
+
+    // Static metadata comes from the cache, only value, status, severity and timestamp change between posts
+    gdd *gddCtrl;
+    switch(type) {
+        case aitEnumInt32:
+            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_long);
+            putCtrlLimits(gddCtrl);
+            putGDDToGDD(&gddCtrl[10], gddValue);
+            break;
+        case aitEnumFloat32:
+            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_float);
+            putCtrlLimits(gddCtrl);
+            gddCtrl[10].putConvert(ctrlCache.precision);
+            putGDDToGDD(&gddCtrl[11], gddValue);
+            break;
+        case aitEnumFloat64:
+            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_double);
+            putCtrlLimits(gddCtrl);
+            gddCtrl[10].putConvert(ctrlCache.precision);
+            putGDDToGDD(&gddCtrl[11], gddValue);
+            break;
+        case aitEnumString:
+            gddCtrl = gddValue;
+            break;
+        case aitEnumEnum16:
+            gddCtrl = gddApplicationTypeTable::AppTable().getDD(gddAppType_dbr_ctrl_enum);
+            putGDDToGDD(&gddCtrl[1], gddValue);
+
+            // The strings are owned by the PV info, which is deleted after the PV and its queued events
+            gddCtrl[2].putRef((const aitString *)ctrlCache.enums);
+            break;
+        default:
+            std::cout << "updateValue(): Unknown PV type " << type << std::endl;
+            gddCtrl = NULL;
+            break;
+    }
+
+    if(gddCtrl != NULL) {
+        myPostEvent(snapshot->mask, *gddCtrl);
+        gddCtrl->unreference();
+    }
+    PCAS_TRACE3(update_value_return, handle, name.c_str(), count);
+}
+
+// Convert the metadata of the PV once, units, limits, precision and enums do not change after the PV is created
+void SimplePV::buildCtrlCache() {
+    ctrlCache.units = aitString(info->getUnits().c_str());
+    ctrlCache.lopr = info->getLopr();
+    ctrlCache.hopr = info->getHopr();
+    ctrlCache.lowWarning = info->getLowWarning();
+    ctrlCache.highWarning = info->getHighWarning();
+    ctrlCache.lowAlarm = info->getLowAlarm();
+    ctrlCache.highAlarm = info->getHighAlarm();
+    ctrlCache.precision = info->getPrecision();
+
+    ctrlCache.enums = info->getEnumStrings();
+    ctrlCache.enumCount = info->getEnums().size();
+}
+
+void SimplePV::putCtrlLimits(gdd *gddCtrl) {
+    gddCtrl[1].putConvert(ctrlCache.units);
+    gddCtrl[2].putConvert(ctrlCache.lowWarning);
+    gddCtrl[3].putConvert(ctrlCache.highWarning);
+    gddCtrl[4].putConvert(ctrlCache.lowAlarm);
+    gddCtrl[5].putConvert(ctrlCache.highAlarm);
+    gddCtrl[6].putConvert(ctrlCache.lopr);
+    gddCtrl[7].putConvert(ctrlCache.hopr);
+    gddCtrl[8].putConvert(ctrlCache.lopr);
+    gddCtrl[9].putConvert(ctrlCache.hopr);
+}
+
+// Get Value from GDD
+Value * SimplePV::getValueFromGDD(const gdd *pGDD) {
+    aitEnum type = info->getValue()->getType();
+    int count = info->getValue()->getCount();
+
+    Value *value = new Value(type, count);
+    void *buffer = value->getBuffer();
+
+    aitEnum primitiveType = pGDD->primitiveType();
+    if(pGDD->isScalar()) {
+        switch(primitiveType) {
+            case aitEnumInt32:
+                {
+                    int d;
+                    pGDD->getConvert(d);
+                    *(int *)buffer = d;
+                }
+                break;
+            case aitEnumFloat32:
                 {
                     float d;
                     pGDD->getConvert(d);
@@ -1107,408 +2958,1867 @@ Value * SimplePV::getValueFromGDD(const gdd *pGDD) {
                 }
                 break;
             case aitEnumFloat64:
-                {
-                    double d;
-                    pGDD->getConvert(d);
-                    *(double *)buffer = d;
-                }
+                {
+                    double d;
+                    pGDD->getConvert(d);
+                    *(double *)buffer = d;
+                }
+                break;
+            case aitEnumString:
+                {
+                    aitString d;
+                    pGDD->getConvert(d);
+                    memcpy(buffer, d.string(), MAX_STRING_SIZE);
+                }
+                break;
+            case aitEnumEnum16:
+                {
+                    int d;
+                    pGDD->getConvert(d);
+                    *(int *)buffer = d;
+                }
+                break;
+            default:
+                std::cout << "getValueFromGDD(): Unknown primitiveType " << primitiveType << std::endl;
+                break;
+        }
+    } else {
+        aitUint32 elementCount = pGDD->getDataSizeElements();
+        switch(primitiveType) {
+            case aitEnumInt32:
+                pGDD->get((int *)buffer);
+                break;
+            case aitEnumFloat32:
+                pGDD->get((float *)buffer);
+                break;
+            case aitEnumFloat64:
+                pGDD->get((double *)buffer);
+                break;
+            case aitEnumString:
+                {
+                    aitString *d = new aitString[elementCount];
+                    pGDD->get(d);
+                    for(int i = 0; i < elementCount; i++) {
+                        memcpy((char *)buffer + MAX_STRING_SIZE * i, (d + i)->string(), MAX_STRING_SIZE);
+                    }
+                    delete [] d; 
+                }
+                break;
+            case aitEnumEnum16:
+                pGDD->get((int *)buffer);
+                break;
+            default:
+                std::cout << "getValueFromGDD(): Unknown primitiveType " << primitiveType << std::endl;
+                break;
+        }
+    }
+
+    return value;
+}
+
+// Put Value to GDD
+void SimplePV::putValueToGDD(gdd *pGDD, Value *value) {
+    int count = value->getCount();
+    void *buffer = value->getBuffer();
+
+    aitEnum primitiveType = pGDD->primitiveType();
+    if(pGDD->isScalar()) {
+        switch(primitiveType) {
+            case aitEnumInt32:
+                pGDD->putConvert(*(int *)buffer);
+                break;
+            case aitEnumFloat32:
+                pGDD->putConvert(*(float *)buffer);
+                break;
+            case aitEnumFloat64:
+                pGDD->putConvert(*(double *)buffer);
+                break;
+            case aitEnumString:
+                pGDD->putConvert(aitString((char *)buffer));
+                break;
+            case aitEnumEnum16:
+                pGDD->putConvert(*(int *)buffer);
+                break;
+            default:
+                std::cout << "putValueToGDD(): Unknown primitiveType " << primitiveType << std::endl;
+                break;
+        }
+        releaseValueAndBuffer(value);
+    } else {
+        pGDD->setDimension(1);
+        pGDD->setBound(0, 0, count);
+        switch(primitiveType) {
+            case aitEnumInt32:
+                pGDD->putRef((int *)buffer, new valueBufferDestructor());
+                break;
+            case aitEnumFloat32:
+                pGDD->putRef((float *)buffer, new valueBufferDestructor());
+                break;
+            case aitEnumFloat64:
+                pGDD->putRef((double *)buffer, new valueBufferDestructor());
                 break;
             case aitEnumString:
                 {
-                    aitString d;
-                    pGDD->getConvert(d);
-                    memcpy(buffer, d.string(), MAX_STRING_SIZE);
+                    // Strings are copied into the heap by aitString, so string posts are not free of allocations
+                    aitString *d = new aitString[count];
+                    for(int i = 0; i < count; i++) {
+                        *(d + i) = aitString((char *)buffer + i * MAX_STRING_SIZE);
+                    }
+                    pGDD->putRef(d, new aitStringDestructor());
+                    releaseBuffer(value);
                 }
                 break;
             case aitEnumEnum16:
-                {
-                    int d;
-                    pGDD->getConvert(d);
-                    *(int *)buffer = d;
-                }
+                pGDD->putRef((int *)buffer, new valueBufferDestructor());
                 break;
             default:
-                std::cout << "getValueFromGDD(): Unknown primitiveType " << primitiveType << std::endl;
+                std::cout << "putValueToGDD(): Unknown primitiveType " << primitiveType << std::endl;
                 break;
         }
-    } else {
-        aitUint32 elementCount = pGDD->getDataSizeElements();
-        switch(primitiveType) {
+        releaseValue(value);
+    }
+}
+
+// Put a referenced shared buffer to GDD without copying, the reference is released with the GDD
+void SimplePV::putBufferToGDD(gdd *pGDD, ValueBuffer *buffer) {
+    int count = info->getValue()->getCount();
+    aitEnum type = info->getValue()->getType();
+    void *data = buffer->getData();
+
+    pGDD->setDimension(1);
+    pGDD->setBound(0, 0, count);
+    switch(type) {
+        case aitEnumInt32:
+            pGDD->putRef((int *)data, new valueBufferRefDestructor(buffer));
+            break;
+        case aitEnumFloat32:
+            pGDD->putRef((float *)data, new valueBufferRefDestructor(buffer));
+            break;
+        case aitEnumFloat64:
+            pGDD->putRef((double *)data, new valueBufferRefDestructor(buffer));
+            break;
+        case aitEnumEnum16:
+            pGDD->putRef((int *)data, new valueBufferRefDestructor(buffer));
+            break;
+        default:
+            std::cout << "putBufferToGDD(): Unsupported PV type " << type << std::endl;
+            buffer->release();
+            break;
+    }
+}
+
+// Put GDD to GDD
+void SimplePV::putGDDToGDD(gdd *pGDD, gdd *value) {
+    if(value->isAtomic()) {
+        pGDD->setDimension(1);
+        aitIndex first, count;
+        value->getBound(0, first, count);
+        pGDD->setBound(0, first, count);
+    }
+    
+    pGDD->put(value);
+
+    if(value) {
+        value->unreference();
+    }
+}
+
+void SimplePV::myPostEvent(int mask, gdd &value)
+{
+    caServer *pCAS = this->getCAS();
+    if(pCAS != NULL) {
+        casEventMask select;
+        if(mask & DBE_VALUE)
+            select |= pCAS->valueEventMask();
+        if(mask & DBE_LOG)
+            select |= pCAS->logEventMask();
+        if(mask & DBE_ALARM)
+            select |= pCAS->alarmEventMask();
+        if(mask & DBE_PROPERTY)
+            select |= pCAS->propertyEventMask();
+        PCAS_TRACE3(post_event_entry, handle, name.c_str(), mask);
+        casPV::postEvent(select, value);
+        PCAS_TRACE3(post_event_return, handle, name.c_str(), mask);
+
+        if(serverStats != NULL) {
+            ServerStats::local()->posts++;
+        }
+    }
+}
+
+// Channels are counted per client when the server statistics are enabled
+casChannel * SimplePV::createChannel(const casCtx &ctx, const char * const pUserName, const char * const pHostName) {
+    if(serverStats == NULL) {
+        return casPV::createChannel(ctx, pUserName, pHostName);
+    }
+    return new SimpleChannel(ctx, pUserName, pHostName);
+}
+
+gddAppFuncTable<SimplePV> SimplePV::ft;
+bool SimplePV::initialized = false;
+
+
+/** 
+ * SimpleServer class
+ */
+SimpleServer::SimpleServer() {
+    this->stats = NULL;
+}
+
+SimpleServer::~SimpleServer() {
+
+};
+
+pvExistReturn SimpleServer::pvExistTest(const casCtx &ctx, const caNetAddr &clientAddress, const char *pPVAliasName) {
+    PCAS_TRACE1(pv_exist_entry, pPVAliasName);
+    int handle = registry.search(pPVAliasName);
+    PCAS_TRACE2(pv_exist_return, pPVAliasName, handle);
+    if(handle >= 0)
+        return pverExistsHere;
+    else
+        return pverDoesNotExistHere;
+}
+
+pvAttachReturn SimpleServer::pvAttach(const casCtx &ctx, const char *pPVAliasName) {
+    PVEntry *entry = registry.get(pPVAliasName);
+    if(entry != NULL)
+        return pvAttachReturn(*entry->pv);
+    else
+        return S_casApp_pvNotFound;
+}
+
+// Add a PV to the registry, NULL is returned if the name already exists
+// The PV learns its entry before the update is published, so a client never attaches to a PV without entry
+PVEntry * SimpleServer::addPV(const char *name, SimplePV *pv) { 
+    registry.beginUpdate();
+    PVEntry *entry = registry.add(name, pv, pv->getInfo());
+    if(entry == NULL) {
+        std::cout << "addPV(): PV " << name << " already exists" << std::endl;
+    } else {
+        pv->setEntry(entry);
+    }
+    registry.endUpdate();
+    return entry;
+}
+
+PVEntry * SimpleServer::createSinglePV(pvDef *pvdef) {
+    char *name = pvdef->name;
+    PVInfo *info = new PVInfo(pvdef);
+    SimplePV *pv = new SimplePV(name, info);
+    PVEntry *entry = addPV(name, pv);
+    if(entry == NULL) {
+        delete pv;
+        delete info;
+    }
+    return entry;
+}
+
+// Destroy the PVs removed from the registry once no other thread can see them, called on the server thread
+// Deleting a PV disconnects the channels of its clients, and its outstanding requests are dropped first
+void SimpleServer::reclaim() {
+    std::vector<PVEntry*> released;
+    registry.reclaim(released);
+    for(size_t i = 0; i < released.size(); i++) {
+        PVEntry *entry = released[i];
+        if(asyncIO != NULL) {
+            asyncIO->removePV(entry->handle);
+        }
+
+        SimplePV *pv = entry->pv;
+        entry->pv = NULL;
+        delete pv;
+        delete entry->info;
+        entry->info = NULL;
+        delete entry->data;
+        entry->data = NULL;
+
+        if(debugLevel >= 1) {
+            std::cout << "reclaim(): PV " << entry->name << " destroyed" << std::endl;
+        }
+    }
+}
+
+void SimpleServer::process(double delay) {
+    fileDescriptorManager.process(delay);
+}
+
+PVRegistry & SimpleServer::getRegistry() {
+    return registry;
+}
+
+// Publish the statistics PVs under prefix every period seconds
+void SimpleServer::enableStats(const char *prefix, double period) {
+    if(stats != NULL) {
+        std::cout << "enableStats(): Statistics PVs are already enabled" << std::endl;
+        return;
+    }
+    stats = new ServerStats(*this, prefix, period);
+    serverStats = stats;
+}
+
+ServerStats * SimpleServer::getStats() {
+    return stats;
+}
+
+
+/** 
+ * SimpleAsyncReadIO class
+ */
+SimpleAsyncReadIO::SimpleAsyncReadIO(const casCtx &ctx, int id) : casAsyncReadIO(ctx) {
+    this->id = id;
+}
+
+// Called by the server after the completion is sent, or when the client goes away before completion
+void SimpleAsyncReadIO::destroy() {
+    asyncIO->cancel(id);
+    delete this;
+}
+
+
+/** 
+ * SimpleAsyncWriteIO class
+ */
+SimpleAsyncWriteIO::SimpleAsyncWriteIO(const casCtx &ctx, int id) : casAsyncWriteIO(ctx) {
+    this->id = id;
+}
+
+// Called by the server after the completion is sent, or when the client goes away before completion
+void SimpleAsyncWriteIO::destroy() {
+    asyncIO->cancel(id);
+    delete this;
+}
+
+
+/** 
+ * AsyncIOManager class
+ */
+AsyncIOManager::AsyncIOManager(PVRegistry &registry) : registry(registry) {
+    nextId = 1;
+}
+
+AsyncRequest * AsyncIOManager::newRequest(PVEntry *entry, bool write) {
+    AsyncRequest *request = new AsyncRequest();
+    request->handle = entry->pv->getHandle();
+    request->write = write;
+    request->started = false;
+    request->readIO = NULL;
+    request->writeIO = NULL;
+    request->prototype = NULL;
+    request->timeout = 0;
+    request->created = epicsTime::getCurrent();
+    request->completed = false;
+    request->value = NULL;
+    request->alarm = epicsAlarmNone;
+    request->severity = epicsSevNone;
+
+    epicsGuard<epicsMutex> guard(lock);
+    request->id = nextId;
+    nextId = nextId == 0x7fffffff ? 1 : nextId + 1;
+
+    return request;
+}
+
+// Register an asynchronous read on the server thread, the returned id is handed to Node.js
+int AsyncIOManager::addRead(PVEntry *entry, const casCtx &ctx, gdd &prototype) {
+    AsyncRequest *request = newRequest(entry, false);
+    request->readIO = new SimpleAsyncReadIO(ctx, request->id);
+    request->prototype = &prototype;
+    request->timeout = entry->info->getReadTimeout();
+    request->deadline = epicsTime::getCurrent() + request->timeout;
+    request->started = true;
+    prototype.reference();
+
+    epicsGuard<epicsMutex> guard(lock);
+    pending[request->id] = request;
+
+    return request->id;
+}
+
+// Register an asynchronous write on the server thread, the ownership of value is taken
+// The write is handed to Node.js by startWrite(), which may be delayed while the PV has too many writes in progress
+int AsyncIOManager::addWrite(PVEntry *entry, const casCtx &ctx, Value *value) {
+    AsyncRequest *request = newRequest(entry, true);
+    request->writeIO = new SimpleAsyncWriteIO(ctx, request->id);
+    request->timeout = entry->info->getWriteTimeout();
+    request->value = value;
+
+    epicsGuard<epicsMutex> guard(lock);
+    pending[request->id] = request;
+
+    return request->id;
+}
+
+// Start the timeout of a queued write, the value to be written is returned, which is valid until the write finishes
+Value * AsyncIOManager::startWrite(int id) {
+    epicsGuard<epicsMutex> guard(lock);
+    std::map<int, AsyncRequest*>::iterator it = pending.find(id);
+    if(it == pending.end()) return NULL;
+
+    AsyncRequest *request = it->second;
+    request->started = true;
+    request->deadline = epicsTime::getCurrent() + request->timeout;
+
+    return request->value;
+}
+
+// Complete an asynchronous read from any thread, the value is NULL if the read failed with alarm and severity
+// False is returned if the request is unknown, already completed or expired, and the ownership of value is not taken
+bool AsyncIOManager::completeRead(int id, Value *value, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        std::map<int, AsyncRequest*>::iterator it = pending.find(id);
+        if(it == pending.end() || it->second->write || it->second->completed) {
+            return false;
+        }
+        AsyncRequest *request = it->second;
+        request->completed = true;
+        request->value = value;
+        request->alarm = alarm;
+        request->severity = severity;
+    }
+
+    if(wakeup != NULL) {
+        wakeup->signal();
+    }
+    return true;
+}
+
+// Complete an asynchronous write from any thread, the write failed if alarm is not NO_ALARM
+bool AsyncIOManager::completeWrite(int id, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        std::map<int, AsyncRequest*>::iterator it = pending.find(id);
+        if(it == pending.end() || !it->second->write || !it->second->started || it->second->completed) {
+            return false;
+        }
+        AsyncRequest *request = it->second;
+        request->completed = true;
+        request->alarm = alarm;
+        request->severity = severity;
+    }
+
+    if(wakeup != NULL) {
+        wakeup->signal();
+    }
+    return true;
+}
+
+// Handle an IO destroyed by the server before completion
+// A read is dropped, while a write still goes to Node.js as a plain put without completion sent to the client
+void AsyncIOManager::cancel(int id) {
+    AsyncRequest *request = NULL;
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        std::map<int, AsyncRequest*>::iterator it = pending.find(id);
+        if(it == pending.end()) return;
+        request = it->second;
+        if(request->write) {
+            request->writeIO = NULL;
+            return;
+        }
+        pending.erase(it);
+    }
+
+    // The PV is being destroyed if its entry has no PV anymore
+    PVEntry *entry = registry.at(request->handle);
+    if(tracing(entry)) {
+        logger->log(logCancel, request->handle, id);
+    }
+
+    if(entry->pv != NULL) {
+        entry->pv->cancelRead();
+    }
+    request->prototype->unreference();
+    if(request->value != NULL) {
+        releaseValueAndBuffer(request->value);
+    }
+    delete request;
+}
+
+// Drop the outstanding requests of a PV which is about to be destroyed, called on the server thread
+// The IOs are not completed, the server destroys them together with the channels of the PV
+void AsyncIOManager::removePV(int handle) {
+    std::vector<AsyncRequest*> dropped;
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        std::map<int, AsyncRequest*>::iterator it = pending.begin();
+        while(it != pending.end()) {
+            if(it->second->handle == handle) {
+                dropped.push_back(it->second);
+                pending.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < dropped.size(); i++) {
+        AsyncRequest *request = dropped[i];
+        if(request->prototype != NULL) {
+            request->prototype->unreference();
+        }
+        if(request->value != NULL) {
+            releaseValueAndBuffer(request->value);
+        }
+        delete request;
+    }
+}
+
+// Post completed and expired requests to the clients, called on the server thread
+void AsyncIOManager::process() {
+    std::vector<AsyncRequest*> done;
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        if(pending.empty()) return;
+
+        epicsTime now = epicsTime::getCurrent();
+        std::map<int, AsyncRequest*>::iterator it = pending.begin();
+        while(it != pending.end()) {
+            AsyncRequest *request = it->second;
+            bool expired = request->started && request->timeout > 0 && now >= request->deadline;
+            if(request->completed || expired) {
+                done.push_back(request);
+                pending.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < done.size(); i++) {
+        if(done[i]->write) {
+            finishWrite(done[i]);
+        } else {
+            finishRead(done[i]);
+        }
+    }
+}
+
+// A removed PV is still completed, since its requests are dropped by removePV() before the PV is destroyed
+void AsyncIOManager::finishRead(AsyncRequest *request) {
+    PVEntry *entry = registry.at(request->handle);
+    PVInfo *info = entry->info;
+    Value *value = request->value;
+
+    if(!request->completed) {
+        if(tracing(entry)) {
+            logger->log(logReadTimeout, entry->handle, request->id);
+        }
+        driver->setParamStatus(entry, epicsAlarmTimeout, epicsSevInvalid);
+    } else if(value == NULL) {
+        driver->setParamStatus(entry, request->alarm, request->severity);
+    } else if(value->getType() != info->getValue()->getType() || value->getCount() != info->getValue()->getCount()) {
+        std::cout << "AsyncIOManager::finishRead(): Returned value is not consistent with PV " << entry->name << std::endl;
+        releaseValueAndBuffer(value);
+        driver->setParamStatus(entry, epicsAlarmRead, epicsSevInvalid);
+    } else {
+        driver->setParam(entry, value);
+    }
+    driver->updatePV(entry);
+
+    // The latency of an asynchronous read is the time the client waited for the completion
+    if(serverStats != NULL && request->completed) {
+        StatsCounters *counters = ServerStats::local();
+        counters->reads++;
+        ServerStats::recordLatency(counters->readBuckets, &counters->readTime, epicsTime::getCurrent() - request->created);
+    }
+
+    entry->pv->completeRead(request->readIO, *request->prototype);
+    request->prototype->unreference();
+    delete request;
+}
+
+// The parameter library takes the written value only if Node.js reports success
+void AsyncIOManager::finishWrite(AsyncRequest *request) {
+    PVEntry *entry = registry.at(request->handle);
+    caStatus status = S_casApp_success;
+
+    if(!request->completed) {
+        if(tracing(entry)) {
+            logger->log(logWriteTimeout, entry->handle, request->id);
+        }
+        releaseValueAndBuffer(request->value);
+        driver->setParamStatus(entry, epicsAlarmTimeout, epicsSevInvalid);
+        status = S_casApp_timeout;
+    } else if(request->alarm != epicsAlarmNone) {
+        releaseValueAndBuffer(request->value);
+        driver->setParamStatus(entry, request->alarm, request->severity);
+        status = S_casApp_canceledAsyncIO;
+    } else {
+        driver->setParam(entry, request->value);
+    }
+    driver->updatePV(entry);
+
+    if(serverStats != NULL && request->completed) {
+        StatsCounters *counters = ServerStats::local();
+        counters->writes++;
+        ServerStats::recordLatency(counters->writeBuckets, &counters->writeTime, epicsTime::getCurrent() - request->created);
+    }
+
+    entry->pv->completeWrite(request->writeIO, status);
+    delete request;
+}
+
+
+/** 
+ * ServerWakeup class
+ */
+ServerWakeup::ServerWakeup(SOCKET sock) : fdReg(sock, fdrRead) {
+    this->sock = sock;
+    this->signaled = 0;
+}
+
+ServerWakeup::~ServerWakeup() {
+    epicsSocketDestroy(sock);
+}
+
+// Create the wakeup on the server thread, a datagram socket connected to itself on the loopback interface
+ServerWakeup * ServerWakeup::create() {
+    SOCKET sock = epicsSocketCreate(AF_INET, SOCK_DGRAM, 0);
+    if(sock == INVALID_SOCKET) {
+        std::cout << "ServerWakeup::create(): Failed to create the wakeup socket" << std::endl;
+        return NULL;
+    }
+
+    osiSockAddr addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.ia.sin_family = AF_INET;
+    addr.ia.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.ia.sin_port = htons(0);
+    osiSocklen_t size = sizeof(addr.ia);
+    if(bind(sock, &addr.sa, sizeof(addr.ia)) < 0 ||
+        getsockname(sock, &addr.sa, &size) < 0 ||
+        connect(sock, &addr.sa, sizeof(addr.ia)) < 0) {
+        std::cout << "ServerWakeup::create(): Failed to bind the wakeup socket" << std::endl;
+        epicsSocketDestroy(sock);
+        return NULL;
+    }
+
+    osiSockIoctl_t nonBlocking = 1;
+    socket_ioctl(sock, FIONBIO, &nonBlocking);
+
+    return new ServerWakeup(sock);
+}
+
+// Only the first signal since the last wakeup sends a datagram
+void ServerWakeup::signal() {
+    if(epicsAtomicCmpAndSwapIntT(&signaled, 0, 1) == 0) {
+        char byte = 0;
+        send(sock, &byte, 1, 0);
+    }
+}
+
+void ServerWakeup::callBack() {
+    epicsAtomicSetIntT(&signaled, 0);
+
+    char buffer[16];
+    while(recv(sock, buffer, sizeof(buffer), 0) > 0) {}
+}
+
+
+/** 
+ * Print PV definition
+ */
+void printPVDef(pvDef *pv) {
+    std::cout << "name=" << pv->name << ", ";
+    std::cout << "type=" << pv->type << ", ";
+    std::cout << "count=" << pv->count << ", ";
+    std::cout << "scan=" << pv->scan << ", ";
+
+    std::cout << "enums=[";
+    for(char **ptr = pv->enums; *ptr; ptr++) {
+        std::cout << *ptr;
+        if(*(ptr + 1)) {
+            std::cout << ", ";
+        }
+    }
+    std::cout << "]" << ", ";
+
+    std::cout << "states=[";
+    for(int *ptr = pv->states; *ptr != -1; ptr++) {
+        std::cout << SeverityStrings[*ptr];
+        if(*(ptr + 1) != -1) {
+            std::cout << ", ";
+        }
+    }
+    std::cout << "]" << ", ";
+
+    std::cout << "prec=" << pv->prec << ", ";
+    std::cout << "unit=" << pv->unit << ", ";
+    std::cout << "hilim=" << pv->hilim << ", ";
+    std::cout << "lolim=" << pv->lolim << ", ";
+    std::cout << "high=" << pv->high << ", ";
+    std::cout << "low=" << pv->low << ", ";
+    std::cout << "hihi=" << pv->hihi << ", ";
+    std::cout << "lolo=" << pv->lolo << ", ";
+    std::cout << "adel=" << pv->adel << ", ";
+    std::cout << "mdel=" << pv->mdel << ", ";
+    std::cout << "soft=" << pv->soft << ", ";
+    std::cout << "maxReads=" << pv->maxReads << ", ";
+    std::cout << "readTimeout=" << pv->readTimeout << ", ";
+    std::cout << "maxWrites=" << pv->maxWrites << ", ";
+    std::cout << "writeQueue=" << pv->writeQueue << ", ";
+    std::cout << "writeTimeout=" << pv->writeTimeout << ", ";
+    std::cout << "deadband=" << pv->deadband << ", ";
+    std::cout << "maxRate=" << pv->maxRate << ", ";
+
+    std::cout << "value=";
+    if(pv->count > 1) {
+        std::cout << "[";
+    }
+    for(int i = 0; i < pv->count; i++) {
+        switch(aitEnum(pv->type)) {
             case aitEnumInt32:
-                pGDD->get((int *)buffer);
+                std::cout << *((int *)pv->value + i);
                 break;
             case aitEnumFloat32:
-                pGDD->get((float *)buffer);
+                std::cout << *((float *)pv->value + i);
                 break;
             case aitEnumFloat64:
-                pGDD->get((double *)buffer);
+                std::cout << *((double *)pv->value + i);
                 break;
             case aitEnumString:
-                {
-                    aitString *d = new aitString[elementCount];
-                    pGDD->get(d);
-                    for(int i = 0; i < elementCount; i++) {
-                        memcpy((char *)buffer + MAX_STRING_SIZE * i, (d + i)->string(), MAX_STRING_SIZE);
-                    }
-                    delete [] d; 
-                }
+                std::cout << (char *)pv->value + i * MAX_STRING_SIZE;
                 break;
             case aitEnumEnum16:
-                pGDD->get((int *)buffer);
+                std::cout << *((int *)pv->value + i);
                 break;
             default:
-                std::cout << "getValueFromGDD(): Unknown primitiveType " << primitiveType << std::endl;
+                std::cout << "printPVDef(): Unknown PV type " << pv->type << std::endl;
                 break;
         }
+        if(i < pv->count - 1) {
+            std::cout << ", ";
+        }
+    }
+    if(pv->count > 1) {
+        std::cout << "]";
+    }
+}
+
+
+/** 
+ * Create server instance
+ */
+void createServer(pvDef *pvs, int count) {
+    server = new SimpleServer();
+    pvDef *pv;
+
+    // Print PV definition
+    if(debugLevel >= 1) {
+        std::cout << "\n\n";
+        std::cout << "************ PV definition *************\n";
+        for(int i = 0; i < count; i++) {
+            pv = pvs + i;
+            printPVDef(pv);
+            std::cout << "\n\n";
+        }
+        std::cout << "****************************************\n";
+        std::cout << "\n\n";
+    }
+
+    // Create PVs for the server tool, which are published at once
+    PVRegistry &registry = server->getRegistry();
+    registry.beginUpdate();
+    for(int i = 0; i < count; i++) {
+        pv = pvs + i;
+        server->createSinglePV(pv);
+    }
+    registry.endUpdate();
+
+    // Print PV list in the server tool
+    if(debugLevel >= 1) {
+        std::cout << "\n\n";
+        std::cout << "*************** PV list ****************\n";
+        for(int index = 0; index < registry.size(); index++) {
+            PVEntry *entry = registry.entryAt(index);
+            if(entry == NULL) continue;
+            std::cout << entry->name << ", {" << *entry->info << "}\n\n";
+        }
+        std::cout << "****************************************\n\n";
+        std::cout << "\n\n";
+    }
+}
+
+
+/** 
+ * Create driver instance
+ */
+void createDriver() {
+    driver = new Driver(server->getRegistry());
+    asyncIO = new AsyncIOManager(server->getRegistry());
+}
+
+
+/** 
+ * Add PVs to the running server, the number of added PVs is returned
+ * The PVs are published at once together with their parameters, a PV whose name already exists is skipped
+ */
+int addPVs(pvDef *pvs, int count) {
+    PVRegistry &registry = server->getRegistry();
+    RegistryReadGuard reading(registry);
+    std::vector<PVEntry*> added;
+
+    registry.beginUpdate();
+    for(int i = 0; i < count; i++) {
+        if(debugLevel >= 1) {
+            printPVDef(pvs + i);
+            std::cout << "\n\n";
+        }
+        PVEntry *entry = server->createSinglePV(pvs + i);
+        if(entry == NULL) continue;
+        if(driver != NULL) {
+            driver->addPV(entry);
+        }
+        added.push_back(entry);
+    }
+    registry.endUpdate();
+
+    // Scanned PVs join their groups once they can be found
+    if(scanner != NULL) {
+        for(size_t i = 0; i < added.size(); i++) {
+            double scan = added[i]->info->getScan();
+            if(scan > 0) {
+                scanner->addPV(added[i]->handle, scan);
+            }
+        }
+    }
+    return (int)added.size();
+}
+
+
+/** 
+ * Remove PVs from the running server, the number of removed PVs is returned
+ * A removed PV is not found anymore when this returns, and it is destroyed on the server thread
+ * once no other thread can see it, which disconnects its clients
+ */
+int removePVs(const char** names, int count) {
+    PVRegistry &registry = server->getRegistry();
+    RegistryReadGuard reading(registry);
+    std::vector<PVEntry*> removed;
+
+    registry.beginUpdate();
+    for(int i = 0; i < count; i++) {
+        PVEntry *entry = registry.remove(names[i]);
+        if(entry == NULL) {
+            std::cout << "removePVs(): Unknown PV " << names[i] << std::endl;
+            continue;
+        }
+        removed.push_back(entry);
+    }
+    registry.endUpdate();
+
+    // The entries stay valid inside the read section
+    if(scanner != NULL) {
+        for(size_t i = 0; i < removed.size(); i++) {
+            double scan = removed[i]->info->getScan();
+            if(scan > 0) {
+                scanner->removePV(removed[i]->handle, scan);
+            }
+        }
+    }
+    if(wakeup != NULL && !removed.empty()) {
+        wakeup->signal();
+    }
+    return (int)removed.size();
+}
+
+
+/** 
+ * Install read and write callbacks
+ */
+void installCallback(ReadCallback readCallback, WriteCallback writeCallback) {
+    driver->installCallback(readCallback, writeCallback);
+}
+
+
+/** 
+ * Install read callback
+ */
+void installReadCallback(ReadCallback readCallback) {
+    driver->installReadCallback(readCallback);
+}
+
+
+/** 
+ * Install write callback
+ */
+void installWriteCallback(WriteCallback writeCallback) {
+    driver->installWriteCallback(writeCallback);
+}
+
+
+/** 
+ * Install group read callback, which reads all PVs due in the same scan tick in one call
+ */
+void installGroupReadCallback(GroupReadCallback groupReadCallback) {
+    driver->installGroupReadCallback(groupReadCallback);
+}
+
+
+/** 
+ * ScanScheduler class
+ */
+ScanScheduler::ScanScheduler(PVRegistry &registry, int workers) : registry(registry) {
+    this->workers = workers > 0 ? workers : 1;
+    this->timeout = 0;
+    this->nextTick = 1;
+}
+
+// Timeout in seconds of scan ticks queued for Node.js, 0 gives each group one scan period
+void ScanScheduler::setTimeout(double timeout) {
+    epicsGuard<epicsMutex> guard(lock);
+    this->timeout = timeout > 0 ? timeout : 0;
+}
+
+// Add a PV to the group of its scan period, which may be done while the scheduler runs
+void ScanScheduler::addPV(int handle, double period) {
+    epicsGuard<epicsMutex> guard(lock);
+    std::map<double, ScanGroup*>::iterator iter = groups.find(period);
+    ScanGroup *group;
+    if(iter == groups.end()) {
+        group = new ScanGroup();
+        group->period = period;
+        group->deadline = epicsTime::getCurrent();
+        group->busy = false;
+        group->ticks = 0;
+        group->missed = 0;
+        group->maxLag = 0;
+        group->stale = false;
+        group->tick = 0;
+        group->timedOut = false;
+        group->timeouts = 0;
+        group->index = (int)groupList.size();
+        groupList.push_back(group);
+        groups.insert(std::pair<double, ScanGroup*>(period, group));
+        heap.push_back(group);
+        std::push_heap(heap.begin(), heap.end(), laterDeadline);
+        dispatchEvent.signal();
+    } else {
+        group = iter->second;
+    }
+    group->joining.push_back(handle);
+    if(!group->busy) {
+        applyChanges(group);
+    }
+}
+
+// Remove a PV from the group of its scan period, an empty group keeps ticking without reads
+void ScanScheduler::removePV(int handle, double period) {
+    epicsGuard<epicsMutex> guard(lock);
+    std::map<double, ScanGroup*>::iterator iter = groups.find(period);
+    if(iter == groups.end()) return;
+
+    ScanGroup *group = iter->second;
+    group->leaving.push_back(handle);
+    if(!group->busy) {
+        applyChanges(group);
+    }
+}
+
+// Apply the PVs joining and leaving a group which is not busy, called with the lock held
+void ScanScheduler::applyChanges(ScanGroup *group) {
+    if(group->joining.empty() && group->leaving.empty()) return;
+
+    group->handles.insert(group->handles.end(), group->joining.begin(), group->joining.end());
+    for(size_t i = 0; i < group->leaving.size(); i++) {
+        std::vector<int>::iterator found = std::find(group->handles.begin(), group->handles.end(), group->leaving[i]);
+        if(found != group->handles.end()) {
+            group->handles.erase(found);
+        }
+    }
+    group->joining.clear();
+    group->leaving.clear();
+    group->stale = true;
+}
+
+// Start the dispatcher and the worker threads
+void ScanScheduler::start() {
+    if(debugLevel >= 1) {
+        std::cout << "Starting scan scheduler: groups=" << groups.size() << ", workers=" << workers << std::endl;
+        for(std::map<double, ScanGroup*>::iterator iter = groups.begin(); iter != groups.end(); ++iter) {
+            std::cout << "Scan group: scan=" << iter->first << ", pvs=" << iter->second->handles.size() << std::endl;
+        }
+    }
+
+    epicsThreadCreate("scanDispatcher",
+        epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackSmall),
+        dispatcherThread,
+        this);
+    for(int i = 0; i < workers; i++) {
+        epicsThreadCreate("scanWorker",
+            epicsThreadPriorityMedium,
+            epicsThreadGetStackSize(epicsThreadStackMedium),
+            workerThread,
+            this);
+    }
+}
+
+void ScanScheduler::getStats(ScanStats *stats) {
+    epicsGuard<epicsMutex> guard(lock);
+    stats->groups = (int)groups.size();
+    stats->workers = workers;
+    stats->ticks = 0;
+    stats->missed = 0;
+    stats->timeouts = 0;
+    stats->maxLag = 0;
+    for(std::map<double, ScanGroup*>::iterator iter = groups.begin(); iter != groups.end(); ++iter) {
+        ScanGroup *group = iter->second;
+        stats->ticks += group->ticks;
+        stats->missed += group->missed;
+        stats->timeouts += group->timeouts;
+        if(group->maxLag > stats->maxLag) {
+            stats->maxLag = group->maxLag;
+        }
+    }
+}
+
+void ScanScheduler::dispatcherThread(void *arg) {
+    ((ScanScheduler *)arg)->dispatch();
+}
+
+void ScanScheduler::workerThread(void *arg) {
+    ((ScanScheduler *)arg)->work();
+}
+
+// Heap comparator, the group with the earliest deadline is on top
+bool ScanScheduler::laterDeadline(const ScanGroup *a, const ScanGroup *b) {
+    return a->deadline > b->deadline;
+}
+
+// Wait for the earliest deadline and queue the due group for the workers
+// Deadlines advance by a fixed period, so the scan rate does not drift with the time spent in the scan
+void ScanScheduler::dispatch() {
+    epicsGuard<epicsMutex> guard(lock);
+    while(true) {
+        if(heap.empty()) {
+            epicsGuardRelease<epicsMutex> unguard(guard);
+            dispatchEvent.wait();
+            continue;
+        }
+
+        ScanGroup *group = heap.front();
+        epicsTime now = epicsTime::getCurrent();
+        double delay = group->deadline - now;
+        if(delay > 0) {
+            epicsGuardRelease<epicsMutex> unguard(guard);
+            dispatchEvent.wait(delay);
+            continue;
+        }
+
+        std::pop_heap(heap.begin(), heap.end(), laterDeadline);
+        heap.pop_back();
+
+        double lag = now - group->deadline;
+        if(lag > group->maxLag) {
+            group->maxLag = lag;
+        }
+        PCAS_TRACE3(scan_tick, group->index, (int)group->handles.size(), (long)(lag * 1e6));
+        if(serverStats != NULL) {
+            StatsCounters *counters = ServerStats::local();
+            counters->scanTicks++;
+            counters->scanLag += lag;
+        }
+        if(group->busy) {
+            // The previous tick of this group is still being processed, or waits for Node.js beyond its deadline
+            group->missed++;
+            if(group->tick != 0 && now >= group->tickDeadline) {
+                expireTick(group);
+            }
+        } else {
+            applyChanges(group);
+            group->busy = true;
+            group->ticks++;
+            queue.push_back(group);
+            workEvent.signal();
+        }
+
+        // Skip the periods that have already passed
+        group->deadline += group->period;
+        if(group->deadline <= now) {
+            double behind = now - group->deadline;
+            epicsUInt64 skipped = (epicsUInt64)(behind / group->period) + 1;
+            group->missed += skipped;
+            group->deadline += skipped * group->period;
+        }
+        heap.push_back(group);
+        std::push_heap(heap.begin(), heap.end(), laterDeadline);
+    }
+}
+
+void ScanScheduler::work() {
+    epicsGuard<epicsMutex> guard(lock);
+    while(true) {
+        if(queue.empty()) {
+            epicsGuardRelease<epicsMutex> unguard(guard);
+            workEvent.wait();
+            continue;
+        }
+
+        ScanGroup *group = queue.front();
+        queue.pop_front();
+
+        // The event is binary, pass the wakeup on while there is still work queued
+        if(!queue.empty()) {
+            workEvent.signal();
+        }
+
+        bool done;
+        {
+            epicsGuardRelease<epicsMutex> unguard(guard);
+            RegistryReadGuard reading(registry);
+            if(group->timedOut) {
+                timeoutGroup(group);
+                done = true;
+            } else {
+                PCAS_TRACE2(scan_start, group->index, (int)group->handles.size());
+                done = scanGroup(group);
+            }
+        }
+        if(done) {
+            PCAS_TRACE2(scan_done, group->index, (int)group->handles.size());
+            group->timedOut = false;
+            group->busy = false;
+        }
+    }
+}
+
+// Read every PV in the group from Node.js and post update events if necessary
+// false is returned if the tick is queued for Node.js, the group stays busy until completeGroup()
+bool ScanScheduler::scanGroup(ScanGroup *group) {
+    RequestQueue &requests = driver->getRequests();
+    if(requests.isEnabled(requestScan)) {
+        prepareReads(group);
+        if(group->reads.empty()) return true;
+
+        // Each queued tick gets its own id, so a completion arriving after the tick timed out is told apart
+        Request *request;
+        {
+            epicsGuard<epicsMutex> guard(lock);
+            group->tick = nextTick;
+            nextTick = nextTick == 0x7fffffff ? 1 : nextTick + 1;
+            group->tickDeadline = epicsTime::getCurrent() + (timeout > 0 ? timeout : group->period);
+            request = newRequest(requestScan, group->tick, -1);
+        }
+        request->reads = &group->reads[0];
+        request->count = (int)group->reads.size();
+        requests.push(request);
+        return false;
+    }
+
+    if(driver->hasGroupReadCallback()) {
+        groupReadGroup(group);
+        return true;
+    }
+
+    for(size_t i = 0; i < group->handles.size(); i++) {
+        PVEntry *entry = registry.get(group->handles[i]);
+        if(entry == NULL) continue;
+
+        if(!entry->info->getSoft() && driver->hasReadCallback()) {
+            Value *newValue = driver->read(entry);
+            driver->setParam(entry, newValue);
+
+            // post update events if necessary
+            driver->postPV(entry);
+        }
+    }
+    return true;
+}
+
+
+// Abandon a queued tick which Node.js did not complete before its deadline, called by the dispatcher with the lock held
+// Node.js may still write the buffers of the tick, so they are kept until its late completion, and the group gets new ones
+void ScanScheduler::expireTick(ScanGroup *group) {
+    if(tracing()) {
+        logger->log(logScanTimeout, -1, group->tick);
     }
 
-    return value;
+    ScanTick &tick = abandoned[group->tick];
+    tick.reads.swap(group->reads);
+    tick.values.swap(group->readValues);
+    group->tick = 0;
+    group->timedOut = true;
+    group->timeouts++;
+    queue.push_back(group);
+    workEvent.signal();
 }
 
-// Put Value to GDD
-void SimplePV::putValueToGDD(gdd *pGDD, Value *value) {
-    int count = value->getCount();
-    void *buffer = value->getBuffer();
 
-    aitEnum primitiveType = pGDD->primitiveType();
-    if(pGDD->isScalar()) {
-        switch(primitiveType) {
-            case aitEnumInt32:
-                pGDD->putConvert(*(int *)buffer);
-                break;
-            case aitEnumFloat32:
-                pGDD->putConvert(*(float *)buffer);
-                break;
-            case aitEnumFloat64:
-                pGDD->putConvert(*(double *)buffer);
-                break;
-            case aitEnumString:
-                pGDD->putConvert(aitString((char *)buffer));
-                break;
-            case aitEnumEnum16:
-                pGDD->putConvert(*(int *)buffer);
-                break;
-            default:
-                std::cout << "putValueToGDD(): Unknown primitiveType " << primitiveType << std::endl;
-                break;
-        }
-        releaseValueAndBuffer(value);
-    } else {
-        pGDD->setDimension(1);
-        pGDD->setBound(0, 0, count);
-        switch(primitiveType) {
-            case aitEnumInt32:
-                pGDD->putRef((int *)buffer, new valueBufferDestructor());
-                break;
-            case aitEnumFloat32:
-                pGDD->putRef((float *)buffer, new valueBufferDestructor());
-                break;
-            case aitEnumFloat64:
-                pGDD->putRef((double *)buffer, new valueBufferDestructor());
-                break;
-            case aitEnumString:
-                {
-                    aitString *d = new aitString[count];
-                    for(int i = 0; i < count; i++) {
-                        *(d + i) = aitString((char *)buffer + i * MAX_STRING_SIZE);
-                    }
-                    pGDD->putRef(d, new aitStringDestructor());
-                    releaseBuffer(value);
-                }
-                break;
-            case aitEnumEnum16:
-                pGDD->putRef((int *)buffer, new valueBufferDestructor());
-                break;
-            default:
-                std::cout << "putValueToGDD(): Unknown primitiveType " << primitiveType << std::endl;
-                break;
-        }
-        releaseValue(value);
+// Raise a timeout alarm on the PVs of a group whose tick timed out, as for client reads
+void ScanScheduler::timeoutGroup(ScanGroup *group) {
+    for(size_t i = 0; i < group->handles.size(); i++) {
+        PVEntry *entry = registry.get(group->handles[i]);
+        if(entry == NULL || entry->info->getSoft()) continue;
+
+        driver->setParamStatus(entry, epicsAlarmTimeout, epicsSevInvalid);
+        driver->postPV(entry);
     }
 }
 
-// Put GDD to GDD
-void SimplePV::putGDDToGDD(gdd *pGDD, gdd *value) {
-    if(value->isAtomic()) {
-        pGDD->setDimension(1);
-        aitIndex first, count;
-        value->getBound(0, first, count);
-        pGDD->setBound(0, first, count);
+
+// Read the whole group from Node.js in one call
+void ScanScheduler::groupReadGroup(ScanGroup *group) {
+    prepareReads(group);
+    if(group->reads.empty()) return;
+
+    driver->groupRead(&group->reads[0], (int)group->reads.size());
+    applyReads(group);
+}
+
+
+// Allocate the read descriptors and value buffers of a group on its first tick, they are reused by later ticks
+// until PVs join or leave the group
+// Only one worker or Node.js processes a group at a time, since the group is busy until its tick is done
+void ScanScheduler::prepareReads(ScanGroup *group) {
+    if(group->stale) {
+        for(size_t i = 0; i < group->readValues.size(); i++) {
+            releaseValueAndBuffer(group->readValues[i]);
+        }
+        group->readValues.clear();
+        group->reads.clear();
+        group->stale = false;
     }
-    
-    pGDD->put(value);
 
-    if(value) {
-        value->unreference();
+    if(group->readValues.empty()) {
+        for(size_t i = 0; i < group->handles.size(); i++) {
+            PVEntry *entry = registry.get(group->handles[i]);
+            if(entry == NULL || entry->info->getSoft()) continue;
+
+            Value *value = new Value(*entry->info->getValue());
+            SimpleRead read;
+            read.name = entry->name.c_str();
+            read.handle = group->handles[i];
+            read.value.type = value->getType();
+            read.value.count = value->getCount();
+            read.value.buffer = value->getBuffer();
+            group->reads.push_back(read);
+            group->readValues.push_back(value);
+        }
     }
 }
 
-void SimplePV::myPostEvent(int mask, gdd &value)
-{
-    caServer *pCAS = this->getCAS();
-    if(pCAS != NULL) {
-        casEventMask select;
-        if(mask & DBE_VALUE)
-            select |= pCAS->valueEventMask();
-        if(mask & DBE_LOG)
-            select |= pCAS->logEventMask();
-        if(mask & DBE_ALARM)
-            select |= pCAS->alarmEventMask();
-        if(mask & DBE_PROPERTY)
-            select |= pCAS->propertyEventMask();
-        casPV::postEvent(select, value);
+
+// Take the values read into the buffers of a group into the parameter library
+void ScanScheduler::applyReads(ScanGroup *group) {
+    for(size_t i = 0; i < group->reads.size(); i++) {
+        PVEntry *entry = registry.get(group->reads[i].handle);
+        if(entry == NULL) continue;
+
+        driver->_setParam(entry, group->readValues[i]);
+
+        // post update events if necessary
+        driver->postPV(entry);
     }
 }
 
-gddAppFuncTable<SimplePV> SimplePV::ft;
-bool SimplePV::initialized = false;
+
+// Complete a scan tick which was queued for Node.js, the values are taken unless the read failed with alarm and severity
+// false is returned if the tick is unknown, already completed or timed out, a timed out tick then releases its buffers
+bool ScanScheduler::completeGroup(int id, epicsAlarmCondition alarm, epicsAlarmSeverity severity) {
+    ScanGroup *group = NULL;
+    {
+        epicsGuard<epicsMutex> guard(lock);
+        std::map<int, ScanTick>::iterator late = abandoned.find(id);
+        if(late != abandoned.end()) {
+            for(size_t i = 0; i < late->second.values.size(); i++) {
+                releaseValueAndBuffer(late->second.values[i]);
+            }
+            abandoned.erase(late);
+            return false;
+        }
+
+        for(size_t i = 0; i < groupList.size(); i++) {
+            if(groupList[i]->busy && groupList[i]->tick == id) {
+                group = groupList[i];
+                break;
+            }
+        }
+        if(id == 0 || group == NULL) return false;
+        group->tick = 0;
+    }
+
+    if(alarm == epicsAlarmNone) {
+        applyReads(group);
+    } else {
+        for(size_t i = 0; i < group->reads.size(); i++) {
+            PVEntry *entry = registry.get(group->reads[i].handle);
+            if(entry == NULL) continue;
+
+            driver->setParamStatus(entry, alarm, severity);
+            driver->postPV(entry);
+        }
+    }
+
+    PCAS_TRACE2(scan_done, group->index, (int)group->handles.size());
+    epicsGuard<epicsMutex> guard(lock);
+    group->busy = false;
+    return true;
+}
 
 
 /** 
- * SimpleServer class
+ * ServerStats class
  */
-SimpleServer::SimpleServer() {
 
+// Statistics PVs under the prefix, in the order of their handles in ServerStats
+enum StatsPV {
+    statsClients,
+    statsChannels,
+    statsMonitored,
+    statsEventRate,
+    statsPostRate,
+    statsSetRate,
+    statsReadCount,
+    statsReadTime,
+    statsReadLatency,
+    statsWriteCount,
+    statsWriteTime,
+    statsWriteLatency,
+    statsLatencyBins,
+    statsScanLag,
+    statsScanMaxLag,
+    statsScanMissed,
+    statsUpdateTime,
+    statsPoolBytes,
+    statsPoolCached,
+    statsPVCount
+};
+
+typedef struct StatsPVDef {
+    const char *suffix;
+    int count;
+    const char *unit;
+} StatsPVDef;
+
+static const StatsPVDef statsPVDefs[statsPVCount] = {
+    { "CLIENTS", 1, "" },                   // Clients with a connected channel, identified by user and host
+    { "CHANNELS", 1, "" },                  // Connected channels
+    { "MONITORED", 1, "" },                 // PVs with at least one monitor
+    { "EVENT_RATE", 1, "1/s" },             // Events posted to subscriptions by the server library
+    { "POST_RATE", 1, "1/s" },              // Update events posted by the PVs
+    { "SET_RATE", 1, "1/s" },               // Updates of the parameter library
+    { "READ_COUNT", 1, "" },                // Completed read callbacks
+    { "READ_TIME", 1, "us" },               // Mean read latency over the last period
+    { "READ_LATENCY", STATS_BUCKETS, "" },  // Histogram of the read latency
+    { "WRITE_COUNT", 1, "" },               // Completed write callbacks
+    { "WRITE_TIME", 1, "us" },              // Mean write latency over the last period
+    { "WRITE_LATENCY", STATS_BUCKETS, "" }, // Histogram of the write latency
+    { "LATENCY_BINS", STATS_BUCKETS, "us" },// Lower bounds of the histogram buckets
+    { "SCAN_LAG", 1, "us" },                // Mean lag of the scan ticks over the last period
+    { "SCAN_MAX_LAG", 1, "us" },            // Maximum lag of the scan ticks
+    { "SCAN_MISSED", 1, "" },               // Missed scan ticks
+    { "UPDATE_TIME", 1, "us" },             // Mean duration of updatePVs() over the last period
+    { "POOL_BYTES", 1, "B" },               // Bytes in use from the buffer pool
+    { "POOL_CACHED", 1, "B" }               // Bytes cached on the free lists of the buffer pool
+};
+
+epicsThreadPrivateId ServerStats::key;
+EpicsAtomicPtrT ServerStats::threads = NULL;
+
+// Create the statistics PVs, which get their parameters here if the driver already exists
+ServerStats::ServerStats(SimpleServer &server, const char *prefix, double period) : server(server) {
+    this->channels = 0;
+    this->monitors = 0;
+    this->period = period > 0 ? period : 1;
+    this->lastPublish = epicsTime::getCurrent();
+    this->eventsPosted = 0;
+    memset(&previous, 0, sizeof(StatsCounters));
+    key = epicsThreadPrivateCreate();
+
+    static char *noEnums[] = { NULL };
+    static int noStates[] = { -1 };
+    std::vector<double> zeros(STATS_BUCKETS, 0);
+    server.getRegistry().beginUpdate();
+    for(int i = 0; i < statsPVCount; i++) {
+        std::string name = std::string(prefix) + statsPVDefs[i].suffix;
+        pvDef def;
+        memset(&def, 0, sizeof(pvDef));
+        def.name = (char *)name.c_str();
+        def.type = aitEnumFloat64;
+        def.count = statsPVDefs[i].count;
+        def.enums = noEnums;
+        def.states = noStates;
+        def.prec = 3;
+        def.unit = (char *)statsPVDefs[i].unit;
+        def.soft = true;
+        def.deadband = deadbandAbsolute;
+        def.value = &zeros[0];
+        PVEntry *entry = server.createSinglePV(&def);
+        if(entry != NULL && driver != NULL) {
+            driver->addPV(entry);
+        }
+        handles.push_back(entry != NULL ? entry->handle : -1);
+    }
+    server.getRegistry().endUpdate();
 }
 
-SimpleServer::~SimpleServer() {
+// Counters of the calling thread, which are allocated on first use and linked for the server thread to sum
+// The block of a thread is never freed, since the server thread may be reading it, and threads of the server live as long as the process
+StatsCounters * ServerStats::local() {
+    StatsCounters *counters = (StatsCounters *)epicsThreadPrivateGet(key);
+    if(counters != NULL) return counters;
 
-};
+    counters = new StatsCounters();
+    memset(counters, 0, sizeof(StatsCounters));
+    StatsCounters *head = (StatsCounters *)epicsAtomicGetPtrT(&threads);
+    while(true) {
+        counters->next = head;
+        StatsCounters *prev = (StatsCounters *)epicsAtomicCmpAndSwapPtrT(&threads, head, counters);
+        if(prev == head) break;
+        head = prev;
+    }
+    epicsThreadPrivateSet(key, counters);
+    return counters;
+}
 
-pvExistReturn SimpleServer::pvExistTest(const casCtx &ctx, const caNetAddr &clientAddress, const char *pPVAliasName) {
-    if(pvList.find(pPVAliasName) != pvList.end())
-        return pverExistsHere;
-    else
-        return pverDoesNotExistHere;
+void ServerStats::recordLatency(epicsUInt64 *buckets, double *total, double seconds) {
+    double micros = seconds > 0 ? seconds * 1e6 : 0;
+    int bucket = 0;
+    while(bucket < STATS_BUCKETS - 1 && micros >= (double)(2 << bucket)) {
+        bucket++;
+    }
+    buckets[bucket]++;
+    *total += seconds;
 }
 
-pvAttachReturn SimpleServer::pvAttach(const casCtx &ctx, const char *pPVAliasName) {
-    if(pvList.find(pPVAliasName) != pvList.end())
-        return pvAttachReturn(*pvList[pPVAliasName]);
-    else
-        return S_casApp_pvNotFound;
+// Channels are created and destroyed on the server thread
+void ServerStats::addChannel(const std::string &client) {
+    channels++;
+    clients[client]++;
 }
 
-void SimpleServer::addPV(const char *name, casPV *pv) { 
-    pvList.insert(std::pair<std::string, casPV*>(name, pv));
+void ServerStats::removeChannel(const std::string &client) {
+    channels--;
+    std::map<std::string, int>::iterator iter = clients.find(client);
+    if(iter != clients.end() && --iter->second <= 0) {
+        clients.erase(iter);
+    }
 }
 
-void SimpleServer::createSinglePV(pvDef *pvdef) {
-    char *name = pvdef->name;
-    PVInfo *info = new PVInfo(pvdef);
-    casPV *pv = new SimplePV(name, info);
-    addPV(name, pv);
+void ServerStats::addMonitor() {
+    monitors++;
 }
 
-void SimpleServer::process(double delay) {
-    fileDescriptorManager.process(delay);
+void ServerStats::removeMonitor() {
+    monitors--;
+}
+
+// Sum the counters of all threads, a counter being written may be read one update behind
+void ServerStats::sum(StatsCounters *totals) {
+    memset(totals, 0, sizeof(StatsCounters));
+    StatsCounters *counters = (StatsCounters *)epicsAtomicGetPtrT(&threads);
+    for(; counters != NULL; counters = counters->next) {
+        totals->sets += counters->sets;
+        totals->posts += counters->posts;
+        totals->reads += counters->reads;
+        totals->writes += counters->writes;
+        for(int i = 0; i < STATS_BUCKETS; i++) {
+            totals->readBuckets[i] += counters->readBuckets[i];
+            totals->writeBuckets[i] += counters->writeBuckets[i];
+        }
+        totals->readTime += counters->readTime;
+        totals->writeTime += counters->writeTime;
+        totals->scanTicks += counters->scanTicks;
+        totals->scanLag += counters->scanLag;
+        totals->updates += counters->updates;
+        totals->updateTime += counters->updateTime;
+    }
+}
+
+void ServerStats::setValue(int index, double value) {
+    PVEntry *entry = server.getRegistry().get(handles[index]);
+    if(entry == NULL) return;
+    driver->setParam(entry, &value);
+    driver->updatePV(entry);
+}
+
+void ServerStats::setArray(int index, double *values) {
+    PVEntry *entry = server.getRegistry().get(handles[index]);
+    if(entry == NULL) return;
+    driver->setParam(entry, values);
+    driver->updatePV(entry);
+}
+
+// Publish the statistics PVs if the period has passed, called on the server thread
+// The time until the next publication is returned
+double ServerStats::publish() {
+    epicsTime now = epicsTime::getCurrent();
+    double elapsed = now - lastPublish;
+    if(elapsed < period) {
+        return period - elapsed;
+    }
+
+    StatsCounters totals;
+    sum(&totals);
+    unsigned posted = server.subscriptionEventsPosted();
+
+    setValue(statsClients, (double)clients.size());
+    setValue(statsChannels, channels);
+    setValue(statsMonitored, monitors);
+    setValue(statsEventRate, (unsigned)(posted - eventsPosted) / elapsed);
+    setValue(statsPostRate, (totals.posts - previous.posts) / elapsed);
+    setValue(statsSetRate, (totals.sets - previous.sets) / elapsed);
+
+    epicsUInt64 reads = totals.reads - previous.reads;
+    epicsUInt64 writes = totals.writes - previous.writes;
+    epicsUInt64 ticks = totals.scanTicks - previous.scanTicks;
+    epicsUInt64 updates = totals.updates - previous.updates;
+    setValue(statsReadCount, (double)totals.reads);
+    setValue(statsReadTime, reads > 0 ? (totals.readTime - previous.readTime) / reads * 1e6 : 0);
+    setValue(statsWriteCount, (double)totals.writes);
+    setValue(statsWriteTime, writes > 0 ? (totals.writeTime - previous.writeTime) / writes * 1e6 : 0);
+    setValue(statsScanLag, ticks > 0 ? (totals.scanLag - previous.scanLag) / ticks * 1e6 : 0);
+    setValue(statsUpdateTime, updates > 0 ? (totals.updateTime - previous.updateTime) / updates * 1e6 : 0);
+
+    double readLatency[STATS_BUCKETS];
+    double writeLatency[STATS_BUCKETS];
+    double bins[STATS_BUCKETS];
+    for(int i = 0; i < STATS_BUCKETS; i++) {
+        readLatency[i] = (double)totals.readBuckets[i];
+        writeLatency[i] = (double)totals.writeBuckets[i];
+        bins[i] = i == 0 ? 0 : (double)(1 << i);
+    }
+    setArray(statsReadLatency, readLatency);
+    setArray(statsWriteLatency, writeLatency);
+    setArray(statsLatencyBins, bins);
+
+    ScanStats scanStats;
+    getScanStats(&scanStats);
+    setValue(statsScanMaxLag, scanStats.maxLag * 1e6);
+    setValue(statsScanMissed, (double)scanStats.missed);
+
+    PoolStats poolStats;
+    BufferPool::getStats(&poolStats);
+    setValue(statsPoolBytes, (double)poolStats.bytesInUse);
+    setValue(statsPoolCached, (double)poolStats.bytesCached);
+
+    previous = totals;
+    eventsPosted = posted;
+    lastPublish = now;
+    return period;
+}
+
+
+/** 
+ * SimpleChannel class
+ */
+SimpleChannel::SimpleChannel(const casCtx &ctx, const char *userName, const char *hostName) : casChannel(ctx) {
+    client = std::string(userName ? userName : "") + "@" + std::string(hostName ? hostName : "");
+    serverStats->addChannel(client);
 }
 
-std::map<std::string, casPV*> SimpleServer::getPVList() {
-    return pvList;
+SimpleChannel::~SimpleChannel() {
+    serverStats->removeChannel(client);
 }
 
 
 /** 
- * Print PV definition
+ * Logger class
  */
-void printPVDef(pvDef *pv) {
-    std::cout << "name=" << pv->name << ", ";
-    std::cout << "type=" << pv->type << ", ";
-    std::cout << "count=" << pv->count << ", ";
-    std::cout << "scan=" << pv->scan << ", ";
 
-    std::cout << "enums=[";
-    for(char **ptr = pv->enums; *ptr; ptr++) {
-        std::cout << *ptr;
-        if(*(ptr + 1)) {
-            std::cout << ", ";
-        }
+// Messages of the logged events, in the order of LogEvent
+static const char *LogEventStrings[logEventCount] = {
+    "getParam():",
+    "setParam():",
+    "setParamStatus():",
+    "Driver::read():",
+    "Driver::groupRead():",
+    "Driver::asyncRead():",
+    "Driver::write():",
+    "Driver::asyncWrite():",
+    "Driver::postPV(): PV updated,",
+    "AsyncIOManager::cancel(): Request cancelled,",
+    "AsyncIOManager::finishRead(): Read timed out,",
+    "AsyncIOManager::finishWrite(): Write timed out,",
+    "ScanScheduler::timeoutGroup(): Scan timed out,",
+    "completeRead(): Unknown or expired request,",
+    "completeWrite(): Unknown or expired request,",
+    "completeScan(): Unknown, completed or timed out scan,",
+    "RequestQueue::drain():"
+};
+
+Logger::Logger() : records(LOG_RING_SIZE) {
+    for(int i = 0; i < LOG_RING_SIZE; i++) {
+        records[i].seq = i;
     }
-    std::cout << "]" << ", ";
+    this->tail = 0;
+    this->head = 0;
+    this->dropped = 0;
+    this->reported = 0;
+    this->started = false;
+    this->output = stdout;
+}
 
-    std::cout << "states=[";
-    for(int *ptr = pv->states; *ptr != -1; ptr++) {
-        std::cout << SeverityStrings[*ptr];
-        if(*(ptr + 1) != -1) {
-            std::cout << ", ";
+// Start the logger thread, which is done before any PV is traced
+void Logger::start() {
+    if(started) return;
+    started = true;
+    epicsThreadCreate("pcasLogger",
+        epicsThreadPriorityLow,
+        epicsThreadGetStackSize(epicsThreadStackMedium),
+        loggerThread,
+        this);
+}
+
+// Write the records to a file, or to stdout if path is NULL or empty
+void Logger::setOutput(const char *path) {
+    FILE *file = stdout;
+    if(path != NULL && path[0] != '\0') {
+        file = fopen(path, "a");
+        if(file == NULL) {
+            std::cout << "setLogOutput(): Cannot open log file " << path << std::endl;
+            return;
         }
     }
-    std::cout << "]" << ", ";
 
-    std::cout << "prec=" << pv->prec << ", ";
-    std::cout << "unit=" << pv->unit << ", ";
-    std::cout << "hilim=" << pv->hilim << ", ";
-    std::cout << "lolim=" << pv->lolim << ", ";
-    std::cout << "high=" << pv->high << ", ";
-    std::cout << "low=" << pv->low << ", ";
-    std::cout << "hihi=" << pv->hihi << ", ";
-    std::cout << "lolo=" << pv->lolo << ", ";
-    std::cout << "adel=" << pv->adel << ", ";
-    std::cout << "mdel=" << pv->mdel << ", ";
-    std::cout << "soft=" << pv->soft << ", ";
+    epicsGuard<epicsMutex> guard(outputLock);
+    if(output != stdout) {
+        fclose(output);
+    }
+    output = file;
+}
 
-    std::cout << "value=";
-    if(pv->count > 1) {
-        std::cout << "[";
+// Set the log level of the PV named pattern, or of all PVs whose names start with pattern if it ends with *
+// A level of -1 makes the PVs follow the debug level again, the number of matched PVs is returned
+int Logger::setLevel(PVRegistry &registry, const char *pattern, int level) {
+    std::string prefix(pattern);
+    bool wildcard = !prefix.empty() && prefix[prefix.size() - 1] == '*';
+    if(wildcard) {
+        prefix.erase(prefix.size() - 1);
     }
-    for(int i = 0; i < pv->count; i++) {
-        switch(aitEnum(pv->type)) {
-            case aitEnumInt32:
-                std::cout << *((int *)pv->value + i);
-                break;
-            case aitEnumFloat32:
-                std::cout << *((float *)pv->value + i);
-                break;
-            case aitEnumFloat64:
-                std::cout << *((double *)pv->value + i);
-                break;
-            case aitEnumString:
-                std::cout << (char *)pv->value + i * MAX_STRING_SIZE;
-                break;
-            case aitEnumEnum16:
-                std::cout << *((int *)pv->value + i);
-                break;
-            default:
-                std::cout << "printPVDef(): Unknown PV type " << pv->type << std::endl;
-                break;
+
+    int matched = 0;
+    for(int index = 0; index < registry.size(); index++) {
+        PVEntry *entry = registry.entryAt(index);
+        if(entry == NULL) continue;
+        bool match = wildcard ? entry->name.compare(0, prefix.size(), prefix) == 0 : entry->name == prefix;
+        if(match) {
+            epicsAtomicSetIntT(&entry->logLevel, level);
+            matched++;
         }
-        if(i < pv->count - 1) {
-            std::cout << ", ";
+    }
+    return matched;
+}
+
+// Claim the next free record, or return NULL and count a drop if the logger thread is behind by the whole ring
+// Positions and sequences wrap around as unsigned integers
+LogRecord * Logger::claim(int *pos) {
+    int next = epicsAtomicGetIntT(&tail);
+    while(true) {
+        LogRecord *record = &records[next & (LOG_RING_SIZE - 1)];
+        int diff = (int)((unsigned)epicsAtomicGetIntT(&record->seq) - (unsigned)next);
+        if(diff == 0) {
+            int prev = epicsAtomicCmpAndSwapIntT(&tail, next, (int)((unsigned)next + 1));
+            if(prev == next) {
+                *pos = next;
+                return record;
+            }
+            next = prev;
+        } else if(diff < 0) {
+            epicsAtomicIncrIntT(&dropped);
+            return NULL;
+        } else {
+            next = epicsAtomicGetIntT(&tail);
         }
     }
-    if(pv->count > 1) {
-        std::cout << "]";
+}
+
+// Hand the filled record to the logger thread
+void Logger::publish(LogRecord *record, int pos) {
+    epicsAtomicSetIntT(&record->seq, (int)((unsigned)pos + 1));
+}
+
+void Logger::log(LogEvent event, int handle, int id) {
+    int pos;
+    LogRecord *record = claim(&pos);
+    if(record == NULL) return;
+
+    record->event = event;
+    record->handle = handle;
+    record->id = id;
+    record->type = aitEnumInvalid;
+    record->count = 0;
+    epicsTimeGetCurrent(&record->time);
+    publish(record, pos);
+}
+
+// Record the value, of which only the first LOG_VALUE_BYTES bytes are kept
+void Logger::logValue(LogEvent event, int handle, int id, aitEnum type, int count, void *buffer) {
+    int pos;
+    LogRecord *record = claim(&pos);
+    if(record == NULL) return;
+
+    record->event = event;
+    record->handle = handle;
+    record->id = id;
+    record->type = buffer != NULL ? type : aitEnumInvalid;
+    record->count = count;
+    if(buffer != NULL) {
+        Value value;
+        value.setType(type);
+        value.setCount(count);
+        int size = value.calcBufferSize();
+        memcpy(record->value.bytes, buffer, size < LOG_VALUE_BYTES ? size : LOG_VALUE_BYTES);
+    }
+    epicsTimeGetCurrent(&record->time);
+    publish(record, pos);
+}
+
+void Logger::logStatus(LogEvent event, int handle, int alarm, int severity) {
+    int pos;
+    LogRecord *record = claim(&pos);
+    if(record == NULL) return;
+
+    record->event = event;
+    record->handle = handle;
+    record->id = 0;
+    record->type = aitEnumInvalid;
+    record->count = 0;
+    record->alarm = alarm;
+    record->severity = severity;
+    epicsTimeGetCurrent(&record->time);
+    publish(record, pos);
+}
+
+void Logger::loggerThread(void *arg) {
+    ((Logger *)arg)->run();
+}
+
+// Producers never signal the logger thread, so it polls the ring
+void Logger::run() {
+    while(true) {
+        if(flush() == 0) {
+            event.wait(0.05);
+        }
     }
 }
 
+// Format the ready records in order and report the records dropped since the last flush
+int Logger::flush() {
+    epicsGuard<epicsMutex> guard(outputLock);
+    int count = 0;
+    while(true) {
+        LogRecord *record = &records[head & (LOG_RING_SIZE - 1)];
+        if(epicsAtomicGetIntT(&record->seq) != (int)((unsigned)head + 1)) break;
 
-/** 
- * Create server instance
- */
-void createServer(pvDef *pvs, int count) {
-    server = new SimpleServer();
-    pvDef *pv;
+        format(record);
+        epicsAtomicSetIntT(&record->seq, (int)((unsigned)head + LOG_RING_SIZE));
+        head = (int)((unsigned)head + 1);
+        count++;
+    }
 
-    // Print PV definition
-    if(debugLevel >= 1) {
-        std::cout << "\n\n";
-        std::cout << "************ PV definition *************\n";
-        for(int i = 0; i < count; i++) {
-            pv = pvs + i;
-            printPVDef(pv);
-            std::cout << "\n\n";
-        }
-        std::cout << "****************************************\n";
-        std::cout << "\n\n";
+    int drops = epicsAtomicGetIntT(&dropped);
+    if(drops != reported) {
+        fprintf(output, "Logger: %d records dropped\n", drops - reported);
+        reported = drops;
+    }
+    if(count > 0) {
+        fflush(output);
     }
+    return count;
+}
 
-    // Create PVs for the server tool
-    for(int i = 0; i < count; i++) {
-        pv = pvs + i;
-        server->createSinglePV(pv);
+void Logger::format(LogRecord *record) {
+    char time[64];
+    epicsTime(record->time).strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S.%06f");
+
+    std::ostringstream line;
+    line << time << " " << LogEventStrings[record->event];
+    if(record->handle >= 0) {
+        // The entry of a removed PV keeps its name until its index is reused
+        PVRegistry &registry = server->getRegistry();
+        RegistryReadGuard reading(registry);
+        PVEntry *entry = registry.at(record->handle);
+        if(entry != NULL) {
+            line << " pv=" << entry->name;
+        } else {
+            line << " pv=#" << record->handle;
+        }
+    }
+    switch(record->event) {
+        case logSetStatus:
+            line << " alarm=" << AlarmStrings[record->alarm] << ", severity=" << SeverityStrings[record->severity];
+            break;
+        case logDrain:
+            line << " count=" << record->id;
+            break;
+        default:
+            if(record->id != 0 || record->handle < 0) {
+                line << " id=" << record->id;
+            }
+            break;
     }
 
-    // Print PV list in the server tool
-    if(debugLevel >= 1) {
-        std::cout << "\n\n";
-        std::cout << "*************** PV list ****************\n";
-        std::map<std::string, casPV*> pvList = server->getPVList();
-        for(std::map<std::string, casPV*>::iterator iter = pvList.begin(); iter != pvList.end(); ++iter) {
-            std::string name = iter->first;
-            SimplePV *pv = (SimplePV *)iter->second;
-            PVInfo *info = pv->getInfo();
-            std::cout << name << ", {" << *info << "}\n\n";
+    // Print the elements kept in the record, and the count of an array which did not fit
+    if(record->type != aitEnumInvalid) {
+        Value value;
+        value.setType((aitEnum)record->type);
+        value.setCount(1);
+        int elementSize = value.calcBufferSize();
+        int kept = record->count < LOG_VALUE_BYTES / elementSize ? record->count : LOG_VALUE_BYTES / elementSize;
+        value.setCount(kept);
+        value.setBuffer(record->value.bytes);
+        line << " value=" << value;
+        if(kept < record->count) {
+            line << " (" << record->count << " elements)";
         }
-        std::cout << "****************************************\n\n";
-        std::cout << "\n\n";
     }
+    fprintf(output, "%s\n", line.str().c_str());
 }
 
 
 /** 
- * Create driver instance
+ * Create the scan scheduler for PVs whose scan field is greater than zero
  */
-void createDriver() {
-    driver = new Driver();
-}
+void createScanScheduler(int workers) {
+    scanner = new ScanScheduler(server->getRegistry(), workers);
 
+    PVRegistry &registry = server->getRegistry();
+    for(int index = 0; index < registry.size(); index++) {
+        PVEntry *entry = registry.entryAt(index);
+        if(entry == NULL) continue;
 
-/** 
- * Install read and write callbacks
- */
-void installCallback(ReadCallback readCallback, WriteCallback writeCallback) {
-    driver->installCallback(readCallback, writeCallback);
-}
-
+        if(entry->info->getScan() > 0) {
+            scanner->addPV(entry->handle, entry->info->getScan());
+        }
+    }
 
-/** 
- * Install read callback
- */
-void installReadCallback(ReadCallback readCallback) {
-    driver->installReadCallback(readCallback);
+    scanner->start();
 }
 
 
 /** 
- * Install write callback
+ * Create the scan scheduler with the default number of workers
  */
-void installWriteCallback(WriteCallback writeCallback) {
-    driver->installWriteCallback(writeCallback);
+void createScanThread() {
+    createScanScheduler(DEFAULT_SCAN_WORKERS);
 }
 
 
 /** 
- * The scan thread for PVs whose scan field is greater than zero
+ * Get statistics of the scan scheduler
  */
-void scanThread(void *arg) {
-    PVInfo *info = (PVInfo *) arg;
-    std::string name = info->getName();
-    double scan = info->getScan();
-
-    if(debugLevel >= 1) {
-        std::cout << "Starting scan thread: pv=" << name << ", scan=" << scan << std::endl;
-    }
-
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-
-    while(true) {        
-        if(!info->getSoft() && driver->hasReadCallback()) {
-            Value *newValue = driver->read(name);
-            driver->setParam(name, newValue);
-
-            // post update events if necessary
-            Data *data = driver->getParamDB(name);
-            if(data->getFlag() == true) {
-                data->setFlag(false);
-                pv->updateValue(data);
-                data->setMask(0);
-            }
-        }
-        epicsThreadSleep(scan);
+void getScanStats(ScanStats* stats) {
+    if(scanner == NULL) {
+        memset(stats, 0, sizeof(ScanStats));
+        return;
     }
+    scanner->getStats(stats);
 }
 
 
 /** 
- * Create scan thread for PVs whose scan field is greater than zero
+ * Set the timeout in seconds of scan ticks queued for Node.js, 0 gives each group one scan period
+ * The PVs of a timed out tick get a timeout alarm, and the group is scanned again on its next tick
  */
-void createScanThread() {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    for(std::map<std::string, casPV*>::iterator iter = pvList.begin(); iter != pvList.end(); ++iter) {
-        std::string name = iter->first;
-        SimplePV *pv = (SimplePV *)iter->second;
-        PVInfo *info = pv->getInfo();
-        
-        if(info->getScan() > 0) {
-            epicsThreadCreate("scanThread",
-                epicsThreadPriorityMedium,
-                epicsThreadGetStackSize(epicsThreadStackMedium),
-                scanThread,
-                info);
-        }
+void setScanTimeout(double timeout) {
+    if(scanner == NULL) {
+        std::cout << "setScanTimeout(): Scan scheduler is not created" << std::endl;
+        return;
     }
+    scanner->setTimeout(timeout);
 }
 
 
@@ -1523,8 +4833,33 @@ void serverProcessThread(void *arg)
         std::cout << "serverProcessThread(): delay=" << delay << " second" << std::endl;
     }
 
+    // Completions of asynchronous IO from other threads wake up the server thread
+    wakeup = ServerWakeup::create();
+
+    epicsTime nextUpdate = epicsTime::getCurrent();
     while(true) {
-        server->process(delay);
+        // Destroy the removed PVs nobody can see anymore
+        server->reclaim();
+
+        // Wake up in time for the next automatic update
+        double wait = delay;
+        double period = driver->getAutoUpdate();
+        if(period > 0) {
+            epicsTime now = epicsTime::getCurrent();
+            if(now >= nextUpdate) {
+                driver->updatePVs();
+                nextUpdate = now + period;
+            }
+            wait = std::min(delay, nextUpdate - now);
+        }
+
+        // Publish the statistics PVs in time
+        if(server->getStats() != NULL) {
+            wait = std::min(wait, server->getStats()->publish());
+        }
+
+        server->process(wait);
+        asyncIO->process();
     }
 }
 
@@ -1544,52 +4879,178 @@ void serverProcess(double delay)
 }
 
 
+/** 
+ * Create and start the logger on first use, before any PV is traced
+ */
+static void startLogger() {
+    if(logger != NULL) return;
+    Logger *created = new Logger();
+    created->start();
+    logger = created;
+}
+
+
 /** 
  * Set debug level
  */
 void setDebugLevel(int level) {
     std::cout << "Setting debug level to " << level << std::endl;
+    if(level >= 2) {
+        startLogger();
+    }
     debugLevel = level;
 }
 
 
+/** 
+ * Set the log level of a PV, or of all PVs whose names start with pattern if it ends with *
+ * A level of -1 makes the PVs follow the debug level again, the number of matched PVs is returned
+ */
+int setLogLevel(const char* pattern, int level) {
+    if(server == NULL) {
+        std::cout << "setLogLevel(): Server is not created" << std::endl;
+        return 0;
+    }
+    if(level >= 2) {
+        startLogger();
+    }
+    RegistryReadGuard reading(server->getRegistry());
+    return Logger::setLevel(server->getRegistry(), pattern, level);
+}
+
+
+/** 
+ * Write the log to a file, or to stdout if path is empty
+ */
+void setLogOutput(const char* path) {
+    startLogger();
+    logger->setOutput(path);
+}
+
+
 /** 
  * Post update events on all PVs with value or alarm status changed
  */
 void updatePVs() {
+    RegistryReadGuard reading(server->getRegistry());
     driver->updatePVs();
 }
 
 
+/** 
+ * Post update events from the server thread every period seconds, 0 disables it
+ */
+void setAutoUpdate(double period) {
+    driver->setAutoUpdate(period);
+}
+
+
 /** 
  * Get data from parameter library
  */
 void getParam(const char* name, SimpleValue* simpleValue) {
-    Value *value = driver->getParam(name);
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "getParam(): Unknown PV " << name << std::endl;
+        simpleValue->type = aitEnumInvalid;
+        simpleValue->count = 0;
+        simpleValue->buffer = NULL;
+        return;
+    }
+
+    Value *value = driver->getParam(entry);
 
     simpleValue->type = value->getType();
     simpleValue->count = value->getCount();
     simpleValue->buffer = value->getBuffer();
 
-    // Only release Value here, and buffer will be released in Node.js using koffi.free()
+    // Only release Value here, and buffer will be released in Node.js using releaseParam()
     releaseValue(value);
 }
 
 
+/** 
+ * Release the buffer returned by getParam() to the buffer pool
+ */
+void releaseParam(void* buffer) {
+    BufferPool::release(buffer);
+}
+
+
+/** 
+ * Copy data from parameter library into a buffer owned by the caller, size is the byte size of the buffer
+ * -1 is returned if the PV is unknown or the size does not match the PV
+ */
+int getParamBuffer(const char* name, void* buffer, int size) {
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "getParamBuffer(): Unknown PV " << name << std::endl;
+        return -1;
+    }
+    if(size != entry->info->getValue()->calcBufferSize()) {
+        std::cout << "getParamBuffer(): Buffer size " << size << " is not consistent with PV " << name << std::endl;
+        return -1;
+    }
+
+    driver->getParam(entry, buffer);
+    return 0;
+}
+
+
+/** 
+ * Set data to parameter library from a buffer owned by the caller, size is the byte size of the buffer
+ * -1 is returned if the PV is unknown or the size does not match the PV
+ */
+int setParamBuffer(const char* name, void* buffer, int size) {
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "setParamBuffer(): Unknown PV " << name << std::endl;
+        return -1;
+    }
+    if(size != entry->info->getValue()->calcBufferSize()) {
+        std::cout << "setParamBuffer(): Buffer size " << size << " is not consistent with PV " << name << std::endl;
+        return -1;
+    }
+
+    driver->setParam(entry, buffer);
+    return 0;
+}
+
+
 /** 
  * Set data to parameter library
  */
 void setParam(const char* name, SimpleValue* simpleValue) {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-    PVInfo *info = pv->getInfo();
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "setParam(): Unknown PV " << name << std::endl;
+        return;
+    }
+    PVInfo *info = entry->info;
 
     aitEnum type = info->getValue()->getType();
     int count = info->getValue()->getCount();
     Value *value = new Value(type, count);
     value->copyBuffer(simpleValue->buffer);
 
-    driver->setParam(name, value);
+    driver->setParam(entry, value);
+}
+
+
+/** 
+ * Set a batch of data to parameter library in one call, and post update events if update is nonzero
+ */
+int setParams(SimpleParam* params, int count, void* buffer, int update) {
+    RegistryReadGuard reading(server->getRegistry());
+    int updated = driver->setParams(params, count, (char *)buffer);
+    if(update) {
+        driver->updatePVs();
+    }
+    return updated;
 }
 
 
@@ -1597,7 +5058,13 @@ void setParam(const char* name, SimpleValue* simpleValue) {
  * Set alarm and severity to parameter library
  */
 void setParamStatus(const char* name, int alarm, int severity) {
-    driver->setParamStatus(name, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity);
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "setParamStatus(): Unknown PV " << name << std::endl;
+        return;
+    }
+    driver->setParamStatus(entry, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity);
 }
 
 
@@ -1605,11 +5072,250 @@ void setParamStatus(const char* name, int alarm, int severity) {
  * Get type and count for a specific PV
  */
 void getSimpleValue(const char* name, SimpleValue* simpleValue) {
-    std::map<std::string, casPV*> pvList = server->getPVList();
-    SimplePV *pv = (SimplePV *)pvList[name];
-    PVInfo *info = pv->getInfo();
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "getSimpleValue(): Unknown PV " << name << std::endl;
+        simpleValue->type = aitEnumInvalid;
+        simpleValue->count = 0;
+        simpleValue->buffer = NULL;
+        return;
+    }
+    PVInfo *info = entry->info;
 
     simpleValue->type = info->getValue()->getType();
     simpleValue->count = info->getValue()->getCount();
     simpleValue->buffer = NULL;
-}
\ No newline at end of file
+}
+
+
+/** 
+ * Get the handle of a PV, -1 is returned if the PV does not exist
+ */
+int getHandle(const char* name) {
+    RegistryReadGuard reading(server->getRegistry());
+    return server->getRegistry().find(name);
+}
+
+
+/** 
+ * Set scalar data to parameter library by PV handle
+ */
+void setParamDoubleH(int handle, double value) {
+    RegistryReadGuard reading(server->getRegistry());
+    driver->setParamDouble(handle, value);
+}
+
+void setParamInt32H(int handle, int value) {
+    RegistryReadGuard reading(server->getRegistry());
+    driver->setParamInt32(handle, value);
+}
+
+
+/** 
+ * Get scalar data from parameter library by PV handle
+ */
+double getParamDoubleH(int handle) {
+    RegistryReadGuard reading(server->getRegistry());
+    return driver->getParamDouble(handle);
+}
+
+int getParamInt32H(int handle) {
+    RegistryReadGuard reading(server->getRegistry());
+    return driver->getParamInt32(handle);
+}
+
+
+/** 
+ * Set alarm and severity to parameter library by PV handle
+ */
+void setParamStatusH(int handle, int alarm, int severity) {
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(handle);
+    if(entry == NULL) {
+        std::cout << "setParamStatusH(): Invalid PV handle " << handle << std::endl;
+        return;
+    }
+    driver->setParamStatus(entry, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity);
+}
+
+
+/** 
+ * Get the slot region of a PV type, region 0 holds int and enum, 1 float and 2 double PVs
+ */
+void getSlotInfo(int region, SlotInfo* info) {
+    if(region < 0 || region >= SLOT_REGIONS) {
+        std::cout << "getSlotInfo(): Invalid slot region " << region << std::endl;
+        memset(info, 0, sizeof(SlotInfo));
+        return;
+    }
+    driver->getSlotInfo(region, info);
+}
+
+
+/** 
+ * Get the slot index and region of a PV by handle, -1 is returned if the PV has no value slot
+ */
+int getSlot(int handle, int* region) {
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(handle);
+    if(entry == NULL) {
+        std::cout << "getSlot(): Invalid PV handle " << handle << std::endl;
+        return -1;
+    }
+    *region = entry->slotRegion;
+    return entry->slot;
+}
+
+
+/** 
+ * Commit value slots into parameter library and post update events of the changed PVs
+ */
+int commit(int* handles, int count) {
+    RegistryReadGuard reading(server->getRegistry());
+    return driver->commit(handles, count);
+}
+
+int commitAll() {
+    RegistryReadGuard reading(server->getRegistry());
+    return driver->commitAll();
+}
+
+
+/** 
+ * Get counters of name resolution for client searches
+ */
+void getSearchStats(SearchStats* stats) {
+    RegistryReadGuard reading(server->getRegistry());
+    server->getRegistry().getSearchStats(stats);
+}
+
+
+/** 
+ * Install asynchronous read callback, which serves client reads of PVs without scan
+ */
+void installAsyncReadCallback(AsyncReadCallback asyncReadCallback) {
+    driver->installAsyncReadCallback(asyncReadCallback);
+}
+
+
+/** 
+ * Complete an asynchronous read, the value is NULL if the read failed with alarm and severity
+ * 0 is returned if the request is unknown, already completed or expired by the read timeout
+ */
+int completeRead(int id, SimpleValue* simpleValue, int alarm, int severity) {
+    Value *value = NULL;
+    if(simpleValue != NULL && simpleValue->buffer != NULL) {
+        value = new Value((aitEnum)simpleValue->type, simpleValue->count, simpleValue->buffer);
+    }
+
+    if(!asyncIO->completeRead(id, value, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity)) {
+        if(value != NULL) {
+            releaseValueAndBuffer(value);
+        }
+        if(tracing()) {
+            logger->log(logUnknownRead, -1, id);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+/** 
+ * Install asynchronous write callback, which serves client writes of PVs whose soft field is false
+ */
+void installAsyncWriteCallback(AsyncWriteCallback asyncWriteCallback) {
+    driver->installAsyncWriteCallback(asyncWriteCallback);
+}
+
+
+/** 
+ * Complete an asynchronous write, the write failed if alarm is not NO_ALARM
+ * 0 is returned if the request is unknown, already completed or expired by the write timeout
+ */
+int completeWrite(int id, int alarm, int severity) {
+    if(!asyncIO->completeWrite(id, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity)) {
+        if(tracing()) {
+            logger->log(logUnknownWrite, -1, id);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+/** 
+ * Get statistics of the buffer pool
+ */
+void getPoolStats(PoolStats* stats) {
+    BufferPool::getStats(stats);
+}
+
+
+/** 
+ * Get the counters of posted and coalesced updates of a PV
+ */
+void getPostStats(const char* name, PostStats* stats) {
+    RegistryReadGuard reading(server->getRegistry());
+    PVEntry *entry = server->getRegistry().get(name);
+    if(entry == NULL) {
+        std::cout << "getPostStats(): Unknown PV " << name << std::endl;
+        memset(stats, 0, sizeof(PostStats));
+        return;
+    }
+    entry->data->getPostStats(stats);
+}
+
+
+/** 
+ * Install the wakeup callback, the request kinds in the bit mask are then queued for Node.js instead of called
+ * The callback is called from EPICS threads and must only schedule drainRequests() on the Node.js thread
+ */
+void installWakeupCallback(WakeupCallback wakeupCallback, int kinds) {
+    driver->installWakeupCallback(wakeupCallback, kinds);
+}
+
+
+/** 
+ * Drain up to max queued requests, fewer than max are returned once the queue is empty
+ * The buffers referenced by the descriptors stay valid until the next call
+ */
+int drainRequests(RequestInfo* infos, int max) {
+    RegistryReadGuard reading(server->getRegistry());
+    return driver->getRequests().drain(infos, max);
+}
+
+
+/** 
+ * Complete a queued scan tick after Node.js filled the value buffers of its reads
+ * If alarm is not NO_ALARM the read failed, the values are kept and the PVs of the group get the alarm
+ * 0 is returned if the scan is unknown, already completed or timed out
+ */
+int completeScan(int id, int alarm, int severity) {
+    RegistryReadGuard reading(server->getRegistry());
+    if(scanner == NULL || !scanner->completeGroup(id, (epicsAlarmCondition)alarm, (epicsAlarmSeverity)severity)) {
+        if(tracing()) {
+            logger->log(logUnknownScan, -1, id);
+        }
+        return 0;
+    }
+    return 1;
+}
+
+
+/** 
+ * Get statistics of the request queue
+ */
+void getRequestStats(RequestStats* stats) {
+    driver->getRequests().getStats(stats);
+}
+
+
+/** 
+ * Create the statistics PVs of the server under prefix, which are published every period seconds
+ * Must be called after createServer()
+ */
+void createStatsPVs(const char* prefix, double period) {
+    server->enableStats(prefix, period);
+}
@@ -7,11 +7,49 @@
 #include <casdef.h>
 #include <caeventmask.h>
 #include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <epicsGuard.h>
+#include <epicsAtomic.h>
+#include <osiSock.h>
 
+#include <cstdio>
 #include <string>
 #include <map>
 #include <iostream>
+#include <sstream>
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <new>
+
+// Static tracepoints of the pcas provider for perf and bpftrace, which are a single nop until a tracer attaches
+// They are compiled in on Linux when <sys/sdt.h> is installed (systemtap-sdt-dev), define PCAS_NO_SDT to leave them out
+// The probes and example scripts are listed in bpftrace/README
+#if defined(__linux__) && !defined(PCAS_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PCAS_SDT
+#endif
+#endif
+
+#ifdef PCAS_SDT
+#define PCAS_TRACE1(probe, a) DTRACE_PROBE1(pcas, probe, a)
+#define PCAS_TRACE2(probe, a, b) DTRACE_PROBE2(pcas, probe, a, b)
+#define PCAS_TRACE3(probe, a, b, c) DTRACE_PROBE3(pcas, probe, a, b, c)
+#else
+#define PCAS_TRACE1(probe, a)
+#define PCAS_TRACE2(probe, a, b)
+#define PCAS_TRACE3(probe, a, b, c)
+#endif
+
+
+// SSE2 kernels for array change detection, other architectures use the scalar loops
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCAS_SSE2
+#include <emmintrin.h>
+#endif
 
 
 // Map between PV data type and PCAS architecture­-independent type
@@ -24,6 +62,16 @@
 // };
 
 
+// Change detection of array PVs against the last posted snapshots
+// With absolute or relative mode, a deadband of 0 falls back to the exact compare
+enum DeadbandMode {
+    deadbandAlways = 0,     // Every update is posted
+    deadbandExact = 1,      // Posted if any byte changed
+    deadbandAbsolute = 2,   // Posted if any element changed by more than mdel or adel
+    deadbandRelative = 3    // Posted if any element changed by more than mdel or adel times the last value
+};
+
+
 // PV definition
 typedef struct pvDef {
     char *name;
@@ -43,6 +91,13 @@ typedef struct pvDef {
     double mdel;
     double adel;
     bool soft;
+    int maxReads;
+    double readTimeout;
+    int maxWrites;
+    int writeQueue;
+    double writeTimeout;
+    int deadband;
+    double maxRate;
     void *value;
 } pvDef;
 
@@ -55,6 +110,13 @@ typedef struct SimpleValue {
 } SimpleValue;
 
 
+// Parameter descriptor for batch update, the value is located at offset in the packed buffer
+typedef struct SimpleParam {
+    char *name;
+    int offset;
+} SimpleParam;
+
+
 // The callback to read data from Node.js to C++
 typedef void (*ReadCallback)(const char*, SimpleValue*);
 
@@ -63,8 +125,28 @@ typedef void (*ReadCallback)(const char*, SimpleValue*);
 typedef void (*WriteCallback)(const char*, SimpleValue*);
 
 
-// Get EPICS timestamp
-epicsTimeStamp * getEPICSTimeStamp();
+// The callback to start an asynchronous read in Node.js, which is completed later by completeRead() with the same request id
+typedef void (*AsyncReadCallback)(const char*, int);
+
+
+// The callback to start an asynchronous write in Node.js, which is completed later by completeWrite() with the same request id
+typedef void (*AsyncWriteCallback)(const char*, SimpleValue*, int);
+
+
+// Descriptor of a PV read in a scan group, Node.js fills the value buffer in place
+typedef struct SimpleRead {
+    const char *name;
+    int handle;
+    SimpleValue value;
+} SimpleRead;
+
+
+// The callback to read all PVs due in the same scan tick from Node.js to C++ in one call
+typedef void (*GroupReadCallback)(SimpleRead*, int);
+
+
+// The callback to wake up Node.js when requests are queued, it must return without waiting for Node.js
+typedef void (*WakeupCallback)();
 
 
 // Alarm condition strings
@@ -103,9 +185,69 @@ const std::string SeverityStrings[] = {
 };
 
 
+// Statistics of the buffer pool
+typedef struct PoolStats {
+    epicsUInt64 allocs;
+    epicsUInt64 frees;
+    epicsUInt64 hits;
+    epicsUInt64 misses;
+    epicsUInt64 bytesInUse;
+    epicsUInt64 bytesCached;
+} PoolStats;
+
+
+// Descriptor of a slot region, which JS maps as typed arrays
+typedef struct SlotInfo {
+    void *values;
+    int *seqs;
+    int count;
+    int elementSize;
+} SlotInfo;
+
+
+// Block header of the buffer pool, which keeps the payload aligned for double
+typedef union PoolHeader {
+    struct {
+        union PoolHeader *next;
+        size_t size;
+        int sizeClass;
+    } block;
+    double align;
+} PoolHeader;
+
+
+// Free list and counters of one size class, the last class holds oversized blocks which are not cached
+typedef struct PoolClass {
+    PoolHeader *freeList;
+    size_t cached;
+    epicsUInt64 allocs;
+    epicsUInt64 frees;
+    epicsUInt64 hits;
+    epicsUInt64 misses;
+    epicsUInt64 bytesInUse;
+} PoolClass;
+
+
+// Size-class pool for value buffers and the small objects allocated on every read, write and post
+// Freed blocks are kept on the free list of their power-of-two class, so steady-state updates of numeric and enum PVs
+// do not touch the heap, while each class is locked by its own mutex
+class BufferPool {
+public:
+    static void * alloc(size_t size);
+    static void release(void *ptr);
+    static void getStats(PoolStats *stats);
+private:
+    static int sizeClassOf(size_t size);
+    static PoolClass classes[];
+    static epicsMutex locks[];
+};
+
+
 // Data structure for value
 class Value {
 public:
+    static void * operator new(size_t size);
+    static void operator delete(void *ptr);
     Value();
     Value(aitEnum type, int count);
     Value(aitEnum type, int count, void *buffer);
@@ -126,13 +268,55 @@ private:
 };
 
 
+// Immutable value buffer shared by the parameter library, client reads and posted events without copying
+// A new buffer is published on every update, and the last reference frees it
+class ValueBuffer {
+public:
+    static void * operator new(size_t size);
+    static void operator delete(void *ptr);
+    ValueBuffer(void *data);
+    void * getData();
+    void reference();
+    void release();
+private:
+    ~ValueBuffer();
+    void *data;
+    int refs;
+};
+
+
+// Consistent copy of a parameter taken for posting, the value or a reference to the shared buffer is owned by the copy
+typedef struct Snapshot {
+    Value *value;
+    ValueBuffer *buffer;
+    epicsAlarmCondition alarm;
+    epicsAlarmSeverity severity;
+    epicsTimeStamp time;
+    unsigned int mask;
+} Snapshot;
+
+
+// Counters of update events of a PV, a coalesced update was merged into a later post instead of posted by itself
+typedef struct PostStats {
+    epicsUInt64 posted;
+    epicsUInt64 coalesced;
+} PostStats;
+
+
 // Data structure for parameter library
+// Writers are serialized by a mutex per PV, and readers of scalars and strings copy without locking under a sequence counter
+// Readers of arrays take a reference to the shared buffer under the mutex and copy it after unlocking, since the writer may free
+// a buffer nobody references
 class Data {
 public:
     Data();
+    ~Data();
     void initValue(aitEnum type, int count);
     void initValue(aitEnum type, int count, void *buffer);
     void copyValue(Value *value);
+    void adoptValue(Value *value);
+    bool isShared();
+    ValueBuffer * acquireBuffer(epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time);
     void setValue(Value *value);
     Value * getValue();
     void setAlarm(epicsAlarmCondition alarm);
@@ -146,41 +330,326 @@ public:
     void setTimeStamp(epicsTimeStamp *time);
     void setTimeStampToCurrent();
     epicsTimeStamp * getTimeStamp();
+    void beginUpdate();
+    void endUpdate();
+    void readValue(Value *value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time);
+    bool takeUpdate(Snapshot *snapshot, double interval);
+    bool hasUpdate(double interval, double *wait);
+    void getPostStats(PostStats *stats);
+    bool beginPost();
+    void endPost();
     friend std::ostream & operator << (std::ostream &out, const Data &data);
 private:
+    void copyTo(Value *value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity, epicsTimeStamp *time);
     Value *value;
+    ValueBuffer *shared;
     bool flag;
     epicsAlarmCondition alarm;
     epicsAlarmSeverity severity;
     bool udf;
     unsigned int mask;
-    epicsTimeStamp *time;
+    epicsTimeStamp time;
+    epicsMutex mutex;
+    int depth;
+    int seq;
+    int posting;
+    bool raised;
+    int updates;
+    epicsTime lastPost;
+    epicsUInt64 posted;
+    epicsUInt64 coalesced;
+};
+
+
+class SimplePV;
+class PVInfo;
+class ServerStats;
+
+
+// Entry of the PV registry, which keeps the PV instance, PV info and parameter library together
+// Entries with a raised update flag are linked by handle into the dirty stack of the driver
+// The log level of an entry overrides the debug level for that PV, -1 follows the debug level
+// A removed entry keeps its name and handle, while its PV, info and data are destroyed once no reader can see them,
+// and its index is reused once it has left the dirty stack
+// The handle tags the index of the entry with the generation of that index, so a stale handle of a reused index is rejected
+typedef struct PVEntry {
+    std::string name;
+    int handle;
+    SimplePV *pv;
+    PVInfo *info;
+    Data *data;
+    int nextDirty;
+    int queued;
+    int slotRegion;
+    int slot;
+    int logLevel;
+    int removed;
+} PVEntry;
+
+
+// Counters of name resolution for client searches
+typedef struct SearchStats {
+    epicsUInt64 hits;
+    epicsUInt64 misses;
+    epicsUInt64 filterRejects;
+    int names;
+    int indexSize;
+    int filterBits;
+} SearchStats;
+
+
+// Slot of the open addressing hash index, position is the index of the entry in the table
+typedef struct IndexSlot {
+    epicsUInt32 hash;
+    int position;
+} IndexSlot;
+
+
+// Table of the PV registry, the index of a removed PV is reused by a later add once its entry is recycled
+// A published table is never changed, an update copies it and publishes the copy
+typedef struct RegistryTable {
+    std::vector<PVEntry*> entries;
+    std::vector<IndexSlot> index;
+    std::vector<epicsUInt64> filter;
+    int names;
+} RegistryTable;
+
+
+// Epoch of a thread reading the registry, 0 while the thread is outside a read section
+typedef struct RegistryReader {
+    struct RegistryReader *next;
+    int epoch;
+    int depth;
+} RegistryReader;
+
+
+// Table replaced by an update, together with the entries removed by it, whose PVs are destroyed after the grace period
+// of epoch, and the recycled entries replaced by it, which are freed after the grace period
+typedef struct RetiredTable {
+    int epoch;
+    RegistryTable *table;
+    std::vector<PVEntry*> entries;
+    std::vector<PVEntry*> replaced;
+} RetiredTable;
+
+
+// PV registry owned by the server and shared by the driver and the C interface
+// Names are resolved with a precomputed hash index, and a bloom filter rejects names of other servers without probing the index
+// Lookups never lock, updates are serialized by a mutex and publish a new table, and readers on threads other than
+// the server thread hold a read section, so a replaced table or removed PV is only freed once every reader has left
+class PVRegistry {
+public:
+    PVRegistry();
+    void beginUpdate();
+    void endUpdate();
+    PVEntry * add(const char *name, SimplePV *pv, PVInfo *info);
+    PVEntry * remove(const char *name);
+    void reclaim(std::vector<PVEntry*> &released);
+    void enter();
+    void exit();
+    int find(const char *name);
+    int search(const char *name);
+    PVEntry * get(int handle);
+    PVEntry * get(const char *name);
+    PVEntry * at(int handle);
+    PVEntry * entryAt(int index);
+    int size();
+    void getSearchStats(SearchStats *stats);
+    static epicsUInt64 hashName(const char *name);
+private:
+    RegistryTable * current();
+    RegistryReader * reader();
+    bool passed(int retiredEpoch);
+    void publish();
+    static bool mayContain(RegistryTable *table, epicsUInt64 hash);
+    static int probe(RegistryTable *table, const char *name, epicsUInt64 hash);
+    static void insertIndex(RegistryTable *table, int position, epicsUInt64 hash);
+    static void insertFilter(RegistryTable *table, epicsUInt64 hash);
+    static void rebuild(RegistryTable *table);
+    EpicsAtomicPtrT table;
+    RegistryTable *draft;
+    int updateDepth;
+    std::vector<PVEntry*> removed;
+    std::vector<PVEntry*> replaced;
+    std::vector<PVEntry*> dead;
+    std::vector<int> freeIndexes;
+    std::deque<RetiredTable> retired;
+    epicsMutex writeLock;
+    epicsThreadPrivateId readerKey;
+    EpicsAtomicPtrT readers;
+    int epoch;
+    epicsUInt64 hits;
+    epicsUInt64 misses;
+    epicsUInt64 filterRejects;
+};
+
+
+// Read section of the registry for the lifetime of the guard, sections nest
+class RegistryReadGuard {
+public:
+    RegistryReadGuard(PVRegistry &registry);
+    ~RegistryReadGuard();
+private:
+    PVRegistry &registry;
+};
+
+
+// Value slots of scalar PVs of one type in a contiguous region, which JS writes into directly and commits into the parameter library
+// Each slot has a sequence counter which is odd while a write is in progress, so a commit never takes a half-written value
+class SlotRegion {
+public:
+    SlotRegion(aitEnum type);
+    int add(int handle);
+    void allocate(PVRegistry &registry);
+    void getInfo(SlotInfo *info);
+    int size();
+    int getHandle(int slot);
+    bool take(int slot, void *buffer, bool force);
+    static int regionOf(aitEnum type);
+private:
+    aitEnum type;
+    int elementSize;
+    std::vector<int> handles;
+    std::vector<char> values;
+    std::vector<char> committed;
+    std::vector<int> seqs;
+};
+
+
+// Kind of a request queued for Node.js
+enum RequestKind {
+    requestRead = 0,    // Client read, completed by completeRead()
+    requestWrite = 1,   // Client write, completed by completeWrite()
+    requestScan = 2     // Scan tick of a group, completed by completeScan()
+};
+
+
+// Request from an EPICS thread to Node.js, which is linked into the request queue
+typedef struct Request {
+    struct Request *next;
+    RequestKind kind;
+    int id;
+    int handle;
+    Value *value;
+    SimpleRead *reads;
+    int count;
+    epicsTime queued;
+} Request;
+
+
+// Descriptor of a drained request, the name, value and reads stay valid until the next drain
+typedef struct RequestInfo {
+    int kind;
+    int id;
+    const char *name;
+    SimpleValue value;
+    SimpleRead *reads;
+    int count;
+} RequestInfo;
+
+
+// Statistics of the request queue, the wait is the time from push to drain in seconds
+typedef struct RequestStats {
+    int depth;
+    int maxDepth;
+    epicsUInt64 enqueued;
+    epicsUInt64 drained;
+    epicsUInt64 batches;
+    int maxBatch;
+    double meanWait;
+    double maxWait;
+} RequestStats;
+
+
+// Queue of requests from the scan workers and the server thread to Node.js
+// Producers push onto a lock-free stack, Node.js takes the whole stack at once and handles it in batches
+// Only the first push after Node.js ran out of requests wakes it up, so a burst of requests costs one wakeup
+// Kinds is a bit mask of the request kinds served by Node.js, the other kinds keep the direct callbacks
+class RequestQueue {
+public:
+    RequestQueue(PVRegistry &registry);
+    void installWakeupCallback(WakeupCallback wakeupCallback, int kinds);
+    bool isEnabled(RequestKind kind);
+    void push(Request *request);
+    int drain(RequestInfo *infos, int max);
+    void getStats(RequestStats *stats);
+private:
+    Request * pop();
+    PVRegistry &registry;
+    WakeupCallback wakeupCallback;
+    int kinds;
+    EpicsAtomicPtrT head;
+    int armed;
+    int depth;
+    int maxDepth;
+    Request *pending;
+    std::vector<Request *> batch;
+    epicsUInt64 drained;
+    epicsUInt64 batches;
+    int maxBatch;
+    double totalWait;
+    double maxWait;
 };
 
 
 // Driver for the server tool
 class Driver {
 public:
-    Driver();
+    Driver(PVRegistry &registry);
+    void addPV(PVEntry *entry);
     void installCallback(ReadCallback readCallback, WriteCallback writeCallback);
     void installReadCallback(ReadCallback readCallback);
     void installWriteCallback(WriteCallback writeCallback);
+    void installGroupReadCallback(GroupReadCallback groupReadCallback);
+    void installAsyncReadCallback(AsyncReadCallback asyncReadCallback);
+    void installAsyncWriteCallback(AsyncWriteCallback asyncWriteCallback);
+    void installWakeupCallback(WakeupCallback wakeupCallback, int kinds);
     bool hasReadCallback();
     bool hasWriteCallback();
+    bool hasGroupReadCallback();
+    bool hasAsyncReadCallback();
+    bool hasAsyncWriteCallback();
+    RequestQueue & getRequests();
     ReadCallback getReadCallback();
     WriteCallback getWriteCallback();
-    Value * getParam(std::string name);
-    void setParam(std::string name, Value *value);
-    void setParamStatus(std::string name, epicsAlarmCondition alarm, epicsAlarmSeverity severity);
-    Data * getParamDB(std::string name);
-    Value * read(std::string name);
-    bool write(std::string name, Value *value);
+    Value * getParam(PVEntry *entry);
+    void getParam(PVEntry *entry, void *buffer);
+    void setParam(PVEntry *entry, Value *value);
+    void setParam(PVEntry *entry, void *buffer);
+    int setParams(SimpleParam *params, int count, char *buffer);
+    void setParamStatus(PVEntry *entry, epicsAlarmCondition alarm, epicsAlarmSeverity severity);
+    void setParamDouble(int handle, double value);
+    void setParamInt32(int handle, int value);
+    double getParamDouble(int handle);
+    int getParamInt32(int handle);
+    Value * read(PVEntry *entry);
+    void groupRead(SimpleRead *reads, int count);
+    void asyncRead(PVEntry *entry, int id);
+    bool write(PVEntry *entry, Value *value);
+    void asyncWrite(PVEntry *entry, int id, Value *value);
     void updatePVs();
-    void updatePV(std::string name);
+    void updatePV(PVEntry *entry);
+    void postPV(PVEntry *entry);
+    void setAutoUpdate(double period);
+    double getAutoUpdate();
+    void getSlotInfo(int region, SlotInfo *info);
+    int commit(int *handles, int count);
+    int commitAll();
+    void _setParam(PVEntry *entry, Value *value, bool adopt = false);
 private:
-    std::map<std::string, Data*> pvDB;
+    void raiseFlag(PVEntry *entry);
+    int drainDirty();
+    bool commitSlot(PVEntry *entry, bool force);
+    PVRegistry &registry;
+    std::vector<SlotRegion *> slots;
+    RequestQueue requests;
+    int dirtyHead;
+    double autoUpdatePeriod;
     ReadCallback readCallback;
     WriteCallback writeCallback;
+    GroupReadCallback groupReadCallback;
+    AsyncReadCallback asyncReadCallback;
+    AsyncWriteCallback asyncWriteCallback;
 };
 
 
@@ -188,6 +657,7 @@ private:
 class PVInfo {
 public:
     PVInfo(pvDef *pv);
+    ~PVInfo();
     std::string getName();
     double getHopr();
     double getLopr();
@@ -200,9 +670,18 @@ public:
     Value* getValue();
     double getScan();
     bool getSoft();
+    int getMaxReads();
+    double getReadTimeout();
+    int getMaxWrites();
+    int getWriteQueue();
+    double getWriteTimeout();
+    double getMaxRate();
+    double getPostInterval();
     std::vector<std::string> getEnums();
+    aitString * getEnumStrings();
     void validateLimit();
     unsigned int checkValue(Value *newValue);
+    bool arrayChanged(Value *last, void *buffer, double threshold);
     void checkAlarm(Value *newValue, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity);
     void _checkNumericAlarm(double value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity);
     void _checkEnumAlarm(int value, epicsAlarmCondition *alarm, epicsAlarmSeverity *severity);
@@ -211,6 +690,7 @@ private:
     std::string name;
     double scan;
     std::vector<std::string> enums;
+    aitString *enumStrings;
     std::vector<epicsAlarmSeverity> states;
     int prec;
     std::string unit;
@@ -223,6 +703,13 @@ private:
     double mdel;
     double adel;
     bool soft;
+    int maxReads;
+    double readTimeout;
+    int maxWrites;
+    int writeQueue;
+    double writeTimeout;
+    DeadbandMode deadband;
+    double maxRate;
     bool valid_low_high;
     bool valid_lolo_hihi;
     Value *value;
@@ -231,8 +718,23 @@ private:
 };
 
 
+// Metadata of a PV put into every DBR_CTRL post, which is converted once when the PV is created instead of on each post
+typedef struct CtrlCache {
+    aitString units;
+    double lopr;
+    double hopr;
+    double lowWarning;
+    double highWarning;
+    double lowAlarm;
+    double highAlarm;
+    int precision;
+    aitString *enums;
+    int enumCount;
+} CtrlCache;
+
+
 // PV instance for the server tool
-class SimplePV: public casPV
+class SimplePV: public casPV, public epicsTimerNotify
 {
     public:
         SimplePV();
@@ -260,17 +762,40 @@ class SimplePV: public casPV
         virtual aitIndex maxBound(unsigned dimension) const;
         virtual void destroy();
         PVInfo *getInfo();
-        void updateValue(Data *data);
+        void setEntry(PVEntry *entry);
+        int getHandle();
+        PVEntry *getEntry();
+        bool useAsyncRead();
+        void completeRead(casAsyncReadIO *io, gdd &prototype);
+        void cancelRead();
+        bool useAsyncWrite();
+        void startWrite(int id);
+        void completeWrite(casAsyncWriteIO *io, caStatus status);
+        void updateValue(Snapshot *snapshot);
+        void schedulePost(double delay);
+        virtual expireStatus expire(const epicsTime &currentTime);
         void myPostEvent(int mask, gdd &value);
         Value * getValueFromGDD(const gdd *pGDD);
         void putValueToGDD(gdd *pGDD, Value *value);
+        void putBufferToGDD(gdd *pGDD, ValueBuffer *buffer);
         void putGDDToGDD(gdd *pGDD, gdd *value);
+        virtual casChannel *createChannel(const casCtx &ctx, const char * const pUserName, const char * const pHostName);
     private:
+        void buildCtrlCache();
+        void putCtrlLimits(gdd *gddCtrl);
         static gddAppFuncTable<SimplePV> ft;
         static bool initialized;
         bool interest;
         std::string name;
         PVInfo *info;
+        int handle;
+        PVEntry *entry;
+        int outstandingReads;
+        int activeWrites;
+        std::deque<int> queuedWrites;
+        CtrlCache ctrlCache;
+        epicsTimer *postTimer;
+        int trailing;
 };
 
 
@@ -281,12 +806,319 @@ public:
     virtual ~SimpleServer();
     virtual pvExistReturn pvExistTest(const casCtx &ctx, const caNetAddr &clientAddress, const char *pPVAliasName);
     virtual pvAttachReturn pvAttach(const casCtx &ctx, const char *pPVAliasName);
-    void addPV(const char *name, casPV *pv);
-    void createSinglePV(pvDef *pvdef);
+    PVEntry * addPV(const char *name, SimplePV *pv);
+    PVEntry * createSinglePV(pvDef *pvdef);
+    void reclaim();
     void process(double delay);
-    std::map<std::string, casPV*> getPVList();
+    PVRegistry & getRegistry();
+    void enableStats(const char *prefix, double period);
+    ServerStats * getStats();
+private:
+    PVRegistry registry;
+    ServerStats *stats;
+};
+
+
+// Outstanding asynchronous read or write, which is completed by Node.js or expired by the timeout
+typedef struct AsyncRequest {
+    int id;
+    int handle;
+    bool write;
+    bool started;
+    casAsyncReadIO *readIO;
+    casAsyncWriteIO *writeIO;
+    gdd *prototype;
+    double timeout;
+    epicsTime created;
+    epicsTime deadline;
+    bool completed;
+    Value *value;
+    epicsAlarmCondition alarm;
+    epicsAlarmSeverity severity;
+} AsyncRequest;
+
+
+// Asynchronous read handed to the server library, the server destroys it after completion or when the client goes away
+class SimpleAsyncReadIO: public casAsyncReadIO {
+public:
+    SimpleAsyncReadIO(const casCtx &ctx, int id);
+private:
+    virtual void destroy();
+    int id;
+};
+
+
+// Asynchronous write handed to the server library, which completes put callback requests of the clients
+class SimpleAsyncWriteIO: public casAsyncWriteIO {
+public:
+    SimpleAsyncWriteIO(const casCtx &ctx, int id);
+private:
+    virtual void destroy();
+    int id;
+};
+
+
+// Manager of outstanding asynchronous IO
+// Requests may be completed from any thread, the completions are posted to the clients on the server thread
+class AsyncIOManager {
+public:
+    AsyncIOManager(PVRegistry &registry);
+    int addRead(PVEntry *entry, const casCtx &ctx, gdd &prototype);
+    int addWrite(PVEntry *entry, const casCtx &ctx, Value *value);
+    void removePV(int handle);
+    Value * startWrite(int id);
+    bool completeRead(int id, Value *value, epicsAlarmCondition alarm, epicsAlarmSeverity severity);
+    bool completeWrite(int id, epicsAlarmCondition alarm, epicsAlarmSeverity severity);
+    void cancel(int id);
+    void process();
+private:
+    AsyncRequest * newRequest(PVEntry *entry, bool write);
+    void finishRead(AsyncRequest *request);
+    void finishWrite(AsyncRequest *request);
+    PVRegistry &registry;
+    std::map<int, AsyncRequest*> pending;
+    epicsMutex lock;
+    int nextId;
+};
+
+
+// Wake up the server thread blocked in fdManager::process() from other threads through a loopback datagram socket
+class ServerWakeup: public fdReg {
+public:
+    ServerWakeup(SOCKET sock);
+    virtual ~ServerWakeup();
+    static ServerWakeup * create();
+    void signal();
+private:
+    virtual void callBack();
+    SOCKET sock;
+    int signaled;
+};
+
+
+// PVs sharing the same scan period, which are scanned together on each tick
+// PVs joining or leaving a busy group wait until its tick is done, and the reads are rebuilt on the next tick
+// A tick queued for Node.js has an id and a deadline, after which it times out and its buffers are abandoned
+typedef struct ScanGroup {
+    int index;
+    double period;
+    std::vector<int> handles;
+    epicsTime deadline;
+    bool busy;
+    epicsUInt64 ticks;
+    epicsUInt64 missed;
+    double maxLag;
+    std::vector<SimpleRead> reads;
+    std::vector<Value*> readValues;
+    bool stale;
+    std::vector<int> joining;
+    std::vector<int> leaving;
+    int tick;
+    epicsTime tickDeadline;
+    bool timedOut;
+    epicsUInt64 timeouts;
+} ScanGroup;
+
+
+// Read descriptors and value buffers of a timed out tick, which Node.js may still write until it completes the tick
+typedef struct ScanTick {
+    std::vector<SimpleRead> reads;
+    std::vector<Value*> values;
+} ScanTick;
+
+
+// Statistics of the scan scheduler
+typedef struct ScanStats {
+    int groups;
+    int workers;
+    epicsUInt64 ticks;
+    epicsUInt64 missed;
+    epicsUInt64 timeouts;
+    double maxLag;
+} ScanStats;
+
+
+// Scan scheduler for PVs whose scan field is greater than zero
+// A dispatcher thread keeps the groups in a heap ordered by deadline and hands due groups to a small worker pool
+class ScanScheduler {
+public:
+    ScanScheduler(PVRegistry &registry, int workers);
+    void addPV(int handle, double period);
+    void removePV(int handle, double period);
+    void setTimeout(double timeout);
+    void start();
+    void getStats(ScanStats *stats);
+    bool completeGroup(int id, epicsAlarmCondition alarm, epicsAlarmSeverity severity);
+private:
+    static void dispatcherThread(void *arg);
+    static void workerThread(void *arg);
+    static bool laterDeadline(const ScanGroup *a, const ScanGroup *b);
+    void applyChanges(ScanGroup *group);
+    void expireTick(ScanGroup *group);
+    void dispatch();
+    void work();
+    bool scanGroup(ScanGroup *group);
+    void timeoutGroup(ScanGroup *group);
+    void groupReadGroup(ScanGroup *group);
+    void prepareReads(ScanGroup *group);
+    void applyReads(ScanGroup *group);
+    PVRegistry &registry;
+    std::map<double, ScanGroup*> groups;
+    std::vector<ScanGroup*> groupList;
+    std::vector<ScanGroup*> heap;
+    std::deque<ScanGroup*> queue;
+    epicsMutex lock;
+    epicsEvent dispatchEvent;
+    epicsEvent workEvent;
+    int workers;
+    double timeout;
+    int nextTick;
+    std::map<int, ScanTick> abandoned;
+};
+
+
+// Number of buckets of the latency histograms, bucket i counts latencies from 2^i to 2^(i+1) microseconds, the first starts at 0 and the last is open
+#define STATS_BUCKETS 16
+
+
+// Counters of one thread, which are only written by their thread and summed by the server thread without locking
+// All counters only grow, so the server thread publishes the difference from its previous sum
+typedef struct StatsCounters {
+    struct StatsCounters *next;
+    epicsUInt64 sets;
+    epicsUInt64 posts;
+    epicsUInt64 reads;
+    epicsUInt64 writes;
+    epicsUInt64 readBuckets[STATS_BUCKETS];
+    epicsUInt64 writeBuckets[STATS_BUCKETS];
+    double readTime;
+    double writeTime;
+    epicsUInt64 scanTicks;
+    double scanLag;
+    epicsUInt64 updates;
+    double updateTime;
+} StatsCounters;
+
+
+// Statistics of the server published as PVs under a prefix, which is enabled by SimpleServer::enableStats()
+// Hot paths only touch the counters of their own thread, and the server thread aggregates them every period
+// Clients, channels and monitored PVs change on the server thread only and are kept here directly
+class ServerStats {
+public:
+    ServerStats(SimpleServer &server, const char *prefix, double period);
+    static StatsCounters * local();
+    static void recordLatency(epicsUInt64 *buckets, double *total, double seconds);
+    void addChannel(const std::string &client);
+    void removeChannel(const std::string &client);
+    void addMonitor();
+    void removeMonitor();
+    double publish();
+private:
+    void sum(StatsCounters *totals);
+    void setValue(int index, double value);
+    void setArray(int index, double *values);
+    static epicsThreadPrivateId key;
+    static EpicsAtomicPtrT threads;
+    SimpleServer &server;
+    std::vector<int> handles;
+    std::map<std::string, int> clients;
+    int channels;
+    int monitors;
+    double period;
+    epicsTime lastPublish;
+    StatsCounters previous;
+    unsigned eventsPosted;
+};
+
+
+// Channel of a client, which is counted in the server statistics while it is connected
+class SimpleChannel: public casChannel {
+public:
+    SimpleChannel(const casCtx &ctx, const char *userName, const char *hostName);
+    virtual ~SimpleChannel();
+private:
+    std::string client;
+};
+
+
+// Events recorded by the logger
+enum LogEvent {
+    logGetParam = 0,
+    logSetParam,
+    logSetStatus,
+    logRead,
+    logGroupRead,
+    logAsyncRead,
+    logWrite,
+    logAsyncWrite,
+    logPost,
+    logCancel,
+    logReadTimeout,
+    logWriteTimeout,
+    logScanTimeout,
+    logUnknownRead,
+    logUnknownWrite,
+    logUnknownScan,
+    logDrain,
+    logEventCount
+};
+
+
+// Number of records in the ring of the logger, a power of two
+#define LOG_RING_SIZE 16384
+
+
+// Bytes of the value kept in a log record, which hold one string or the first elements of an array
+#define LOG_VALUE_BYTES 40
+
+
+// Binary record written by the hot paths, the PV name and the text are only produced by the logger thread
+// The sequence of a slot tells whether it is free for the producer or ready for the logger thread
+typedef struct LogRecord {
+    int seq;
+    int event;
+    int handle;
+    int id;
+    int type;
+    int count;
+    int alarm;
+    int severity;
+    epicsTimeStamp time;
+    union {
+        char bytes[LOG_VALUE_BYTES];
+        double align;
+    } value;
+} LogRecord;
+
+
+// Logger replacing the debug output of the hot paths
+// Any thread claims a record of a bounded ring without locking, and a full ring drops the record instead of waiting
+// A background thread formats the records and writes them to stdout or a file
+class Logger {
+public:
+    Logger();
+    void start();
+    void setOutput(const char *path);
+    static int setLevel(PVRegistry &registry, const char *pattern, int level);
+    void log(LogEvent event, int handle, int id);
+    void logValue(LogEvent event, int handle, int id, aitEnum type, int count, void *buffer);
+    void logStatus(LogEvent event, int handle, int alarm, int severity);
 private:
-    std::map<std::string, casPV*> pvList;
+    static void loggerThread(void *arg);
+    LogRecord * claim(int *pos);
+    void publish(LogRecord *record, int pos);
+    void run();
+    int flush();
+    void format(LogRecord *record);
+    std::vector<LogRecord> records;
+    int tail;
+    int head;
+    int dropped;
+    int reported;
+    bool started;
+    FILE *output;
+    epicsMutex outputLock;
+    epicsEvent event;
 };
 
 